@@ -180,7 +180,8 @@ double FDadvection::PDE_Source(double x, double y, double t)
 
 
 FDadvection::FDadvection(MPI_Comm globComm, bool pit, bool M_exists, int timeDisc, int numTimeSteps, double dt): 
-    SpaceTimeMatrix(globComm, pit, M_exists, timeDisc, numTimeSteps, dt)
+    SpaceTimeMatrix(globComm, pit, M_exists, timeDisc, numTimeSteps, dt),
+                        m_L({}), m_U0({}), m_G({})
 {
     
 }
@@ -190,7 +191,8 @@ FDadvection::FDadvection(MPI_Comm globComm, bool pit, bool M_exists, int timeDis
                         double dt, int dim, int refLevels, int order, int problemID, std::vector<int> px): 
     SpaceTimeMatrix(globComm, pit, M_exists, timeDisc, numTimeSteps, dt),
                         m_dim{dim}, m_refLevels{refLevels}, m_problemID{problemID}, m_px{px},
-                        m_periodic(false), m_inflow(false), m_PDE_soln_implemented(false)
+                        m_periodic(false), m_inflow(false), m_PDE_soln_implemented(false),
+                        m_L({}), m_U0({}), m_G({})
 {    
     /* ----------------------------------------------------------------------------------------------------- */
     /* --- Check specified proc distribution is consistent with the number of procs passed by base class --- */
@@ -427,7 +429,87 @@ FDadvection::FDadvection(MPI_Comm globComm, bool pit, bool M_exists, int timeDis
 
 FDadvection::~FDadvection()
 {
+    // Free storage held for lending to the solver
+    ReleaseBuffer(m_L.rowptr);
+    ReleaseBuffer(m_L.colinds);
+    ReleaseBuffer(m_L.data);
+    ReleaseBuffer(m_U0.data);
+    ReleaseBuffer(m_G.data);
+}
+
+
+/* Spatial discretizations handing over or lending their storage. 
+
+NOTES:
+    -A time-independent L is computed once, together with the initial guess U0 (which 
+        is the same at all times), and is then lent to the solver on every call. The 
+        same holds for a time-independent G.
+    -Time-dependent L and G are computed afresh at each call and handed over.
+*/
+void FDadvection::getSpatialDiscretizationL(const MPI_Comm &spatialComm, CSR_buffer &L, 
+                                              Vector_buffer &U0, bool getU0, 
+                                              int &localMinRow, int &localMaxRow, 
+                                              int &spatialDOFs, double t, int &bsize)
+{
+    if (m_L_isTimedependent) {
+        SpaceTimeMatrix::getSpatialDiscretizationL(spatialComm, L, U0, getU0, localMinRow, 
+                                                    localMaxRow, spatialDOFs, t, bsize);
+        return;
+    }
+    
+    if (!m_L.data) getSpatialDiscretizationL(spatialComm, m_L.rowptr, m_L.colinds, m_L.data, 
+                                                m_U0.data, true, localMinRow, localMaxRow, 
+                                                spatialDOFs, t, bsize);
+    L           = m_L;
+    if (getU0) U0 = m_U0;
+    spatialDOFs = m_spatialDOFs;
+    localMinRow = m_localMinRow;                    // First row on proc
+    localMaxRow = m_localMinRow + m_onProcSize - 1; // Last row on proc
+}
+
+void FDadvection::getSpatialDiscretizationL(CSR_buffer &L, Vector_buffer &U0, bool getU0, 
+                                              int &spatialDOFs, double t, int &bsize)
+{
+    if (m_L_isTimedependent) {
+        SpaceTimeMatrix::getSpatialDiscretizationL(L, U0, getU0, spatialDOFs, t, bsize);
+        return;
+    }
+    
+    if (!m_L.data) getSpatialDiscretizationL(m_L.rowptr, m_L.colinds, m_L.data, 
+                                                m_U0.data, true, spatialDOFs, t, bsize);
+    L           = m_L;
+    if (getU0) U0 = m_U0;
+    spatialDOFs = m_spatialDOFs;
+}
+
+void FDadvection::getSpatialDiscretizationG(const MPI_Comm &spatialComm, Vector_buffer &G, 
+                                              int &localMinRow, int &localMaxRow, 
+                                              int &spatialDOFs, double t)
+{
+    if (m_G_isTimedependent) {
+        SpaceTimeMatrix::getSpatialDiscretizationG(spatialComm, G, localMinRow, localMaxRow, 
+                                                    spatialDOFs, t);
+        return;
+    }
     
+    if (!m_G.data) getSpatialDiscretizationG(spatialComm, m_G.data, localMinRow, localMaxRow, 
+                                                spatialDOFs, t);
+    G           = m_G;
+    spatialDOFs = m_spatialDOFs;
+    localMinRow = m_localMinRow;                    // First row on proc
+    localMaxRow = m_localMinRow + m_onProcSize - 1; // Last row on proc
+}
+
+void FDadvection::getSpatialDiscretizationG(Vector_buffer &G, int &spatialDOFs, double t)
+{
+    if (m_G_isTimedependent) {
+        SpaceTimeMatrix::getSpatialDiscretizationG(G, spatialDOFs, t);
+        return;
+    }
+    
+    if (!m_G.data) getSpatialDiscretizationG(m_G.data, spatialDOFs, t);
+    G           = m_G;
+    spatialDOFs = m_spatialDOFs;
 }
 
 
@@ -502,11 +584,11 @@ void FDadvection::get2DSpatialDiscretizationL(const MPI_Comm &spatialComm, int *
     localMinRow   = m_localMinRow;                   // First row on proc
     localMaxRow   = localMinRow + m_onProcSize - 1;  // Last row on proc 
     int L_nnz     = (xStencilNnz + yStencilNnz - 1) * m_onProcSize; // Nnz on proc. Discretization of x- and y-derivatives at point i,j will both use i,j in their stencils (hence the -1)
-    L_rowptr      = new int[m_onProcSize + 1];
-    L_colinds     = new int[L_nnz];
-    L_data        = new double[L_nnz];
+    AllocBuffer(L_rowptr, m_onProcSize + 1);
+    AllocBuffer(L_colinds, L_nnz);
+    AllocBuffer(L_data, L_nnz);
     L_rowptr[0]   = 0;
-    if (getU0) U0 = new double[m_onProcSize]; // Initial guesss at solution
+    if (getU0) AllocBuffer(U0, m_onProcSize); // Initial guesss at solution
     int rowcount  = 0;
     int dataInd   = 0;
     
@@ -690,13 +772,13 @@ void FDadvection::get2DSpatialDiscretizationL(int *&L_rowptr,
     int localMinRow = 0;
     int localMaxRow = m_spatialDOFs - 1;
     int L_nnz       = (xStencilNnz + yStencilNnz - 1) * m_onProcSize; // Nnz on proc. Discretization of x- and y-derivatives at point i,j will both use i,j in their stencils (hence the -1)
-    L_rowptr        = new int[m_onProcSize + 1];
-    L_colinds       = new int[L_nnz];
-    L_data          = new double[L_nnz];
+    AllocBuffer(L_rowptr, m_onProcSize + 1);
+    AllocBuffer(L_colinds, L_nnz);
+    AllocBuffer(L_data, L_nnz);
     int rowcount    = 0;
     int dataInd     = 0;
     L_rowptr[0]     = 0;
-    if (getU0) U0   = new double[m_onProcSize]; // Initial guesss at solution
+    if (getU0) AllocBuffer(U0, m_onProcSize); // Initial guesss at solution
 
 
     /* ---------------------------------------------------------------- */
@@ -938,13 +1020,13 @@ void FDadvection::get1DSpatialDiscretizationL(const MPI_Comm &spatialComm, int *
     localMaxRow  = m_localMinRow + m_onProcSize - 1; // Last row on proc
     spatialDOFs  = m_spatialDOFs;
     int L_nnz    = xStencilNnz * m_onProcSize;  // Nnz on proc. This is a bound. Will be slightly less than this for inflow/outflow boudaries
-    L_rowptr     = new int[m_onProcSize + 1];
-    L_colinds    = new int[L_nnz];
-    L_data       = new double[L_nnz];
+    AllocBuffer(L_rowptr, m_onProcSize + 1);
+    AllocBuffer(L_colinds, L_nnz);
+    AllocBuffer(L_data, L_nnz);
     int rowcount = 0;
     int dataInd  = 0;
     L_rowptr[0]  = 0;
-    if (getU0) U0 = new double[m_onProcSize]; // Initial guesss at solution    
+    if (getU0) AllocBuffer(U0, m_onProcSize); // Initial guesss at solution    
     
     /* ---------------------------------------------------------------- */
     /* ------ Get components required to approximate derivatives ------ */
@@ -1182,7 +1264,7 @@ void FDadvection::GetGridFunction(void * GridFunction,
                                     int &spatialDOFs)
 {
     spatialDOFs = m_spatialDOFs;
-    B = new double[m_spatialDOFs];
+    AllocBuffer(B, m_spatialDOFs);
     
     // One spatial dimension
     if (m_dim == 1) {
@@ -1221,7 +1303,7 @@ void FDadvection::GetGridFunction(void * GridFunction,
     localMinRow  = m_localMinRow;                    // First row on process
     localMaxRow  = m_localMinRow + m_onProcSize - 1; // Last row on process
     int rowcount = 0;
-    B            = new double[m_onProcSize]; 
+    AllocBuffer(B, m_onProcSize); 
 
     // One spatial dimension
     if (m_dim == 1) {
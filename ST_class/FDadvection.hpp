@@ -61,6 +61,9 @@ private:
     std::vector<int>    m_nxOnProcBnd;          /* Number of DOFs in each direction on procs on BOUNDARY of proc domain */
     std::vector<int>    m_neighboursLocalMinRow;/* Global index of first DOF owned by neighbouring procs */
     std::vector<int>    m_neighboursNxOnProc;   /* Number of DOFs in each direction owned by neighbouring procs */
+    CSR_buffer          m_L;                    /* L, if time independent, held for lending to solver */
+    Vector_buffer       m_U0;                   /* Initial guess at solution, held with L */
+    Vector_buffer       m_G;                    /* G, if time independent, held for lending to solver */
     
     int div_ceil(int numerator, int denominator);
 
@@ -79,6 +82,17 @@ private:
     void getSpatialDiscretizationL(int* &L_rowptr, int* &L_colinds, double* &L_data,
                                     double* &U0, bool getU0, int &spatialDOFs,
                                     double t, int &bsize);                                            
+    
+    // Lend L and G if they are time independent; otherwise hand them over                                       
+    void getSpatialDiscretizationG(const MPI_Comm &spatialComm, Vector_buffer &G, 
+                                    int &localMinRow, int &localMaxRow, int &spatialDOFs, double t);                               
+    void getSpatialDiscretizationL(const MPI_Comm &spatialComm, CSR_buffer &L, 
+                                    Vector_buffer &U0, bool getU0, 
+                                    int &localMinRow, int &localMaxRow, int &spatialDOFs,
+                                    double t, int &bsize);                                            
+    void getSpatialDiscretizationG(Vector_buffer &G, int &spatialDOFs, double t); 
+    void getSpatialDiscretizationL(CSR_buffer &L, Vector_buffer &U0, bool getU0, 
+                                    int &spatialDOFs, double t, int &bsize);                                            
                                          
     /* Uses spatial parallelism */                                
     void get2DSpatialDiscretizationL(const MPI_Comm &spatialComm, 
@@ -3,7 +3,9 @@
 #include <map>
 #include <vector>
 #include <algorithm>
+#include <cstdio>
 #include "SpaceTimeMatrix.hpp"
+#include "krylov.h" // Generic Krylov interface, for matrix-free GMRES
 #include <iomanip> // Need this for std::setprecision
 #include <cmath> // OAK: I have to include this... There is some ambiguity with "abs". 
 // Something to do with how new OSX is setup now. But on stack exchage some people say this 
@@ -17,6 +19,11 @@
 //      - namespace for RK tableaux/AMG parameters? Keep structs separate from class? 
 
 
+/* Names of timed phases, indexed by TIMER_* */
+static const char * timerNames[NUM_TIMERS] = {"spatial_disc", "st_assembly", "ij_assembly", 
+                                              "solver_setup", "solve", "mass_solve", "starting_values"};
+
+
 /* Get discretization error for solution at final time T = nt*dt. 
     Boolean return value indicates whether discretization error was set on the given process.
     
@@ -36,9 +43,9 @@ bool SpaceTimeMatrix::GetDiscretizationError(double &e2norm)
     
     // Get PDE solution at final time on spatial communicator
     if (m_useSpatialParallel) {
-        got_uexact = GetExactPDESolution(m_spatialComm, uexact, spaceLocalMinRow, spaceLocalMaxRow, spatialDOFs, m_dt*m_nt);
+        got_uexact = GetExactPDESolution(m_spatialComm, uexact, spaceLocalMinRow, spaceLocalMaxRow, spatialDOFs, m_t0 + m_dt*m_nt);
     } else {
-        got_uexact = GetExactPDESolution(uexact, spatialDOFs, m_dt*m_nt);
+        got_uexact = GetExactPDESolution(uexact, spatialDOFs, m_t0 + m_dt*m_nt);
         spaceLocalMinRow = 0;
         spaceLocalMaxRow = spatialDOFs - 1;
     }
@@ -308,29 +315,559 @@ void SpaceTimeMatrix::getSpatialDiscretizationG(double* &G, int &spatialDOFs, do
     std::cout << "WARNING: The `getSpatialDiscretizationG' has not been implemented in the derived spatial discretization class" << '\n';
     MPI_Finalize();
     exit(1);
+}
+
+
+/* Spatial discretizations handing over or lending their storage. 
+
+NOTES:
+    -These default implementations hand over the arrays allocated by the raw-pointer 
+        versions of these functions. A spatial discretization that holds its storage 
+        (e.g., a time-independent L) can override them to lend it instead. 
+    -U0 is only set if getU0 is true.
+*/
+void SpaceTimeMatrix::getSpatialDiscretizationL(const MPI_Comm &spatialComm, CSR_buffer &L, 
+                                            Vector_buffer &U0, bool getU0, 
+                                            int &localMinRow, int &localMaxRow, 
+                                            int &spatialDOFs,
+                                            double t, int &bsize)  
+{
+    getSpatialDiscretizationL(spatialComm, L.rowptr, L.colinds, L.data, U0.data, getU0, 
+                                localMinRow, localMaxRow, spatialDOFs, t, bsize);
+    L.owned  = true;
+    U0.owned = getU0;
+}                                                                            
+void SpaceTimeMatrix::getSpatialDiscretizationG(const MPI_Comm &spatialComm, Vector_buffer &G, 
+                                            int &localMinRow, int &localMaxRow,
+                                            int &spatialDOFs, double t)
+{
+    getSpatialDiscretizationG(spatialComm, G.data, localMinRow, localMaxRow, spatialDOFs, t);
+    G.owned = true;
+}   
+void SpaceTimeMatrix::getSpatialDiscretizationL(CSR_buffer &L, 
+                                            Vector_buffer &U0, bool getU0, 
+                                            int &spatialDOFs,
+                                            double t, int &bsize)  
+{
+    getSpatialDiscretizationL(L.rowptr, L.colinds, L.data, U0.data, getU0, spatialDOFs, t, bsize);
+    L.owned  = true;
+    U0.owned = getU0;
+}                                                        
+void SpaceTimeMatrix::getSpatialDiscretizationG(Vector_buffer &G, int &spatialDOFs, double t)
+{
+    getSpatialDiscretizationG(G.data, spatialDOFs, t);
+    G.owned = true;
+}
+
+
+/* Release storage passed from a spatial discretization: Owned storage is deleted, 
+    borrowed storage is left alone. Pointers are reset in both cases. */
+void SpaceTimeMatrix::FreeBuffer(CSR_buffer &A)
+{
+    if (A.owned) {
+        ReleaseBuffer(A.rowptr);
+        ReleaseBuffer(A.colinds);
+        ReleaseBuffer(A.data);
+    }
+    A.rowptr  = NULL;
+    A.colinds = NULL;
+    A.data    = NULL;
+    A.owned   = false;
+}
+void SpaceTimeMatrix::FreeBuffer(Vector_buffer &x)
+{
+    if (x.owned) ReleaseBuffer(x.data);
+    x.data  = NULL;
+    x.owned = false;
+}
+
+
+/* Take ownership of the storage in x, returning an array of the given size that 
+    the caller must delete[]. Borrowed storage is copied. */
+double * SpaceTimeMatrix::TakeBuffer(Vector_buffer &x, int size)
+{
+    double * data = x.data;
+    if (!x.owned) {
+        data = new double[size];
+        std::copy(x.data, x.data + size, data);
+    }
+    x.data  = NULL;
+    x.owned = false;
+    return data;
+}
+
+
+/* Allocate a transient buffer of (at least) the given size. While the pool is active, 
+    the buffer is taken from the pool if one of the same size class is free. 
+
+NOTES:
+    -Size classes are powers of 2, so that the varying sizes of, e.g., L at different 
+        times map onto a few buffers.
+    -Buffers are always allocated with new[], so they may be freed with delete[] by 
+        code unaware of the pool, e.g., a receiver of storage handed over by a spatial 
+        discretization. Only buffers freed with ReleaseBuffer are recycled, though.
+*/
+void SpaceTimeMatrix::AllocBuffer(int * &x, int size)
+{
+    if (!m_pool_active) {
+        x = new int[size];
+        return;
+    }
+    
+    int sizeClass = 1;
+    while (sizeClass < size) sizeClass *= 2;
+    
+    m_pool_requests++;
+    std::vector<int *> &pool = m_pool_int[sizeClass];
+    if (!pool.empty()) {
+        x = pool.back();
+        pool.pop_back();
+        m_pool_hits++;
+    } else {
+        x = new int[sizeClass];
+        m_pool_bytes += sizeClass * sizeof(int);
+    }
+    m_pool_sizeClass[x] = sizeClass;
+}
+void SpaceTimeMatrix::AllocBuffer(double * &x, int size)
+{
+    if (!m_pool_active) {
+        x = new double[size];
+        return;
+    }
+    
+    int sizeClass = 1;
+    while (sizeClass < size) sizeClass *= 2;
+    
+    m_pool_requests++;
+    std::vector<double *> &pool = m_pool_double[sizeClass];
+    if (!pool.empty()) {
+        x = pool.back();
+        pool.pop_back();
+        m_pool_hits++;
+    } else {
+        x = new double[sizeClass];
+        m_pool_bytes += sizeClass * sizeof(double);
+    }
+    m_pool_sizeClass[x] = sizeClass;
+}
+
+
+/* Release a buffer obtained with AllocBuffer (or new[]): Buffers handed out by the pool 
+    are returned to it, all others are deleted. */
+void SpaceTimeMatrix::ReleaseBuffer(int * &x)
+{
+    if (!x) return;
+    std::map<void *, int>::iterator it = m_pool_sizeClass.find(x);
+    if (it == m_pool_sizeClass.end()) {
+        delete[] x;
+    } else {
+        m_pool_int[it->second].push_back(x);
+        m_pool_sizeClass.erase(it);
+    }
+    x = NULL;
+}
+void SpaceTimeMatrix::ReleaseBuffer(double * &x)
+{
+    if (!x) return;
+    std::map<void *, int>::iterator it = m_pool_sizeClass.find(x);
+    if (it == m_pool_sizeClass.end()) {
+        delete[] x;
+    } else {
+        m_pool_double[it->second].push_back(x);
+        m_pool_sizeClass.erase(it);
+    }
+    x = NULL;
+}
+
+
+/* Free all buffers held by the pool. Buffers still in use become ordinary new[] 
+    allocations, which are deleted when released. */
+void SpaceTimeMatrix::ClearBufferPool()
+{
+    std::map<int, std::vector<int *> >::iterator it_int;
+    for (it_int = m_pool_int.begin(); it_int != m_pool_int.end(); it_int++) {
+        for (size_t i = 0; i < it_int->second.size(); i++) delete[] it_int->second[i];
+    }
+    std::map<int, std::vector<double *> >::iterator it_double;
+    for (it_double = m_pool_double.begin(); it_double != m_pool_double.end(); it_double++) {
+        for (size_t i = 0; i < it_double->second.size(); i++) delete[] it_double->second[i];
+    }
+    m_pool_int.clear();
+    m_pool_double.clear();
+    m_pool_sizeClass.clear();
+}
+
+
+/* Print number of buffers requested from pool, how many of these were recycled, and 
+    bytes the pool allocated from the system, summed over all processes */
+void SpaceTimeMatrix::ReportBufferPool()
+{
+    double localCounts[3] = {(double) m_pool_requests, (double) m_pool_hits, m_pool_bytes};
+    double globalCounts[3];
+    MPI_Reduce(localCounts, globalCounts, 3, MPI_DOUBLE, MPI_SUM, 0, m_globComm);
+    if (m_globRank == 0) {
+        std::cout << "Transient buffer pool: requests = " << (long) globalCounts[0] 
+                    << ", recycled = " << (long) globalCounts[1] 
+                    << ", bytes allocated = " << globalCounts[2] << "\n";
+    }
 }                                                                          
 
 
+/* ----------------------------------------------------------------------------- */
+/* ---------------- Checkpointing of sequential time-stepping ---------------- */
+/* ----------------------------------------------------------------------------- */
+
+/* Write a checkpoint to files with the given prefix every rate time steps (never if rate == 0), 
+    and/or resume time-stepping from the most recent checkpoint with this prefix */
+void SpaceTimeMatrix::SetCheckpointing(std::string prefix, int rate, bool restart)
+{
+    m_checkpoint_prefix = prefix;
+    m_checkpoint_rate   = rate;
+    m_restart           = restart;
+}
+
+
+/* Write checkpoint holding vectors x at time t after step time steps, with dt_next the 
+    size of the next step
+
+NOTES:
+    -Each process writes a Checkpoint_header followed by its rows of each vector to the 
+        binary file <prefix>.<slot>.<rank>. Slots 0 and 1 are alternated so that the 
+        previous checkpoint survives if this one is only partially written.
+    -Once every process has written its file, <prefix>.latest is replaced with the slot 
+        and step of this checkpoint.
+    -Failing to write a checkpoint is reported, but time-stepping continues.
+*/
+void SpaceTimeMatrix::WriteCheckpoint(const std::vector<HYPRE_ParVector> &x, 
+                                      int    step, 
+                                      double t, 
+                                      double dt_next)
+{
+    int slot = m_checkpoint_count % 2;
+    
+    Checkpoint_header header;
+    header.magic      = CHECKPOINT_MAGIC;
+    header.timeDisc   = m_timeDisc;
+    header.nt         = m_nt;
+    header.dt         = m_dt;
+    header.step       = step;
+    header.t          = t;
+    header.dt_next    = dt_next;
+    header.numVectors = x.size();
+    header.globalSize = hypre_ParVectorGlobalSize((hypre_ParVector *) x[0]);
+    header.ilower     = hypre_ParVectorFirstIndex((hypre_ParVector *) x[0]);
+    header.iupper     = header.ilower + hypre_VectorSize(hypre_ParVectorLocalVector((hypre_ParVector *) x[0])) - 1;
+    header.numFiles   = m_spatialCommSize;
+    int onProcSize    = header.iupper - header.ilower + 1;
+    
+    // Write header and then rows of each vector this process owns
+    std::string filename = m_checkpoint_prefix + "." + std::to_string(slot) + "." + std::to_string(m_spatialRank);
+    int    written = 0;
+    FILE * file    = fopen(filename.c_str(), "wb");
+    if (file) {
+        written = (fwrite(&header, sizeof(Checkpoint_header), 1, file) == 1);
+        for (size_t i = 0; i < x.size(); i++) {
+            double * data = hypre_VectorData(hypre_ParVectorLocalVector((hypre_ParVector *) x[i]));
+            written = written && (fwrite(data, sizeof(double), onProcSize, file) == (size_t) onProcSize);
+        }
+        written = (fclose(file) == 0) && written;
+    }
+    
+    // Point to this checkpoint only once all processes have written their rows
+    MPI_Allreduce(MPI_IN_PLACE, &written, 1, MPI_INT, MPI_MIN, m_spatialComm);
+    if (written && m_spatialRank == 0) {
+        std::string latest = m_checkpoint_prefix + ".latest";
+        std::ofstream latestFile(latest + ".tmp");
+        latestFile << slot << " " << step << "\n";
+        latestFile.close();
+        written = !latestFile.fail() && (std::rename((latest + ".tmp").c_str(), latest.c_str()) == 0);
+    }
+    MPI_Bcast(&written, 1, MPI_INT, 0, m_spatialComm);
+    
+    if (!written) {
+        if (m_spatialRank == 0) std::cout << "WARNING: Failed to write checkpoint at time step " << step << " to " << m_checkpoint_prefix << '\n';
+        return;
+    }
+    if (m_solver_parameters.printLevel > 0 && m_spatialRank == 0) {
+        std::cout << "Checkpoint written at time step " << step << ", t = " << t << '\n';
+    }
+    m_checkpoint_count += 1;
+}
+
+
+/* Read vectors x at time t after step time steps, and the size of the next step, dt_next, 
+    from the most recent checkpoint. Returns false if there is no checkpoint to resume from.
+
+NOTES:
+    -x must be initialized. Rows of x may be partitioned differently across processes 
+        than when the checkpoint was written; each process reads its rows from whichever 
+        files hold them.
+    -The checkpoint must have been written by the same time-integration scheme with the 
+        same dt and number of spatial DOFs, otherwise we quit. nt may differ, so that a 
+        run can be extended.
+*/
+bool SpaceTimeMatrix::ReadCheckpoint(const std::vector<HYPRE_ParVector> &x, 
+                                     int    &step, 
+                                     double &t, 
+                                     double &dt_next)
+{
+    // Get slot and step of most recent checkpoint
+    int latest[2] = {-1, -1};
+    if (m_spatialRank == 0) {
+        std::ifstream latestFile(m_checkpoint_prefix + ".latest");
+        if (!(latestFile >> latest[0] >> latest[1])) latest[0] = -1;
+    }
+    MPI_Bcast(latest, 2, MPI_INT, 0, m_spatialComm);
+    if (latest[0] < 0) {
+        if (m_spatialRank == 0) std::cout << "No checkpoint " << m_checkpoint_prefix << ".latest to restart from; starting from t = 0\n";
+        return false;
+    }
+    
+    int globalSize = hypre_ParVectorGlobalSize((hypre_ParVector *) x[0]);
+    int ilower     = hypre_ParVectorFirstIndex((hypre_ParVector *) x[0]);
+    int onProcSize = hypre_VectorSize(hypre_ParVectorLocalVector((hypre_ParVector *) x[0]));
+    int iupper     = ilower + onProcSize - 1;
+    
+    // Copy rows this process owns out of each file, stopping once all of them are found
+    Checkpoint_header header;
+    std::string filename = m_checkpoint_prefix + "." + std::to_string(latest[0]) + ".";
+    int numFiles = 1; // Number of files is read from header of first file
+    int rowsRead = 0;
+    int valid    = 1;
+    for (int fileInd = 0; fileInd < numFiles && rowsRead < onProcSize && valid; fileInd++) {
+        FILE * file = fopen((filename + std::to_string(fileInd)).c_str(), "rb");
+        valid = (file != NULL) && (fread(&header, sizeof(Checkpoint_header), 1, file) == 1)
+                    && header.magic == CHECKPOINT_MAGIC && header.step == latest[1]
+                    && header.timeDisc == m_timeDisc && std::abs(header.dt - m_dt) <= 1e-12 * m_dt
+                    && header.globalSize == globalSize && header.numVectors == (int) x.size();
+        if (valid) {
+            if (fileInd == 0) numFiles = header.numFiles;
+            
+            // Rows in both this file and this process
+            int lo       = std::max(ilower, header.ilower);
+            int hi       = std::min(iupper, header.iupper);
+            int fileSize = header.iupper - header.ilower + 1;
+            for (size_t i = 0; i < x.size() && lo <= hi && valid; i++) {
+                double * data   = hypre_VectorData(hypre_ParVectorLocalVector((hypre_ParVector *) x[i]));
+                long     offset = sizeof(Checkpoint_header) + sizeof(double) * ((long) i * fileSize + lo - header.ilower);
+                valid = (fseek(file, offset, SEEK_SET) == 0) 
+                            && (fread(data + lo - ilower, sizeof(double), hi - lo + 1, file) == (size_t) (hi - lo + 1));
+            }
+            if (lo <= hi) rowsRead += hi - lo + 1;
+        }
+        if (file) fclose(file);
+    }
+    valid = valid && (rowsRead == onProcSize);
+    
+    MPI_Allreduce(MPI_IN_PLACE, &valid, 1, MPI_INT, MPI_MIN, m_spatialComm);
+    if (!valid) {
+        if (m_spatialRank == 0) std::cout << "WARNING: Checkpoint " << filename << "* is missing, corrupt, or incompatible with this discretization" << '\n';
+        MPI_Finalize();
+        exit(1);
+    }
+    
+    step    = header.step;
+    t       = header.t;
+    dt_next = header.dt_next;
+    m_checkpoint_count = latest[0] + 1; // Next checkpoint goes in the other slot 
+    if (m_spatialRank == 0) std::cout << "Restarting from checkpoint at time step " << step << ", t = " << t << '\n';
+    return true;
+}
+
+
+/* Populate member vectors m_u_multi, m_u_multi_ij from the most recent checkpoint of a 
+    multistep scheme and set m_step0 so that time-stepping resumes from it. Returns false if 
+    there is no checkpoint to resume from. 
+
+NOTES:
+    -BDF checkpoints hold the s most recent solutions; AB checkpoints hold the s-1 most 
+        recent values of f, followed by the most recent solution.
+*/
+bool SpaceTimeMatrix::ReadMultistepCheckpoint()
+{
+    // Initialize s vectors with the layout of the initial condition
+    HYPRE_ParVector u0;   
+    HYPRE_IJVector  u0ij;
+    GetHypreInitialCondition(u0, u0ij);
+    m_u_multi.resize(m_s_multi - 1);
+    m_u_multi_ij.resize(m_s_multi - 1);
+    InitializeHypreVectors(u0, u0ij, m_u_multi, m_u_multi_ij);
+    m_u_multi.push_back(u0);
+    m_u_multi_ij.push_back(u0ij);
+    
+    int    step;
+    double t;
+    double dt_next;
+    if (!ReadCheckpoint(m_u_multi, step, t, dt_next)) {
+        for (size_t i = 0; i < m_u_multi_ij.size(); i++) HYPRE_IJVectorDestroy(m_u_multi_ij[i]);
+        m_u_multi.clear();
+        m_u_multi_ij.clear();
+        return false;
+    }
+    
+    m_t0    = 0.0;
+    m_step0 = step - (m_s_multi - 1);
+    return true;
+}
+
+
+/* ----------------------------------------------------------------------------- */
+/* ------------ Output of solution snapshots during time-stepping ------------ */
+/* ----------------------------------------------------------------------------- */
+
+/* Write the solution to files with the given prefix every rate time steps (never if rate == 0) */
+void SpaceTimeMatrix::SetSnapshotOutput(std::string prefix, int rate)
+{
+    m_snapshot_prefix = prefix;
+    m_snapshot_rate   = rate;
+}
+
+
+/* Write rows ilower,...,iupper of solution to file in the same format as HYPRE_IJVectorPrint. 
+    This is run on a background thread, so must not call MPI or hypre. */
+static void WriteSnapshotBuffer(const Snapshot_buffer * buffer) 
+{
+    FILE * file = fopen(buffer->filename.c_str(), "w");
+    if (!file) {
+        std::cout << "WARNING: Cannot open snapshot file " << buffer->filename << '\n';
+        return;
+    }
+    fprintf(file, "%d %d\n", buffer->ilower, buffer->iupper);
+    for (int i = 0; i < buffer->iupper - buffer->ilower + 1; i++) {
+        fprintf(file, "%d %.14e\n", buffer->ilower + i, buffer->data[i]);
+    }
+    fclose(file);
+}
+
+
+/* Write snapshot of solution u at time t after step time steps to <prefix>.<step>.<rank>
+
+NOTES:
+    -u is copied into one of two buffers, which a background thread then writes to file. 
+        The next snapshot is copied into the other buffer, so time-stepping only waits on 
+        the writer if a buffer is reused before it has been written; i.e., if writing a 
+        snapshot takes longer than taking 2*m_snapshot_rate time steps.
+    -Call FinishSnapshots() to wait for all snapshots to be written.
+*/
+void SpaceTimeMatrix::WriteSnapshot(HYPRE_ParVector u, int step, double t)
+{
+    Snapshot_buffer &buffer = m_snapshot_buffer[m_snapshot_count % 2];
+    
+    // Wait for previous snapshot held in this buffer to be written
+    double waitStart = MPI_Wtime();
+    if (buffer.writer.joinable()) buffer.writer.join();
+    m_snapshot_wait_time += MPI_Wtime() - waitStart;
+    
+    // Copy u into buffer
+    double copyStart = MPI_Wtime();
+    hypre_Vector * u_local = hypre_ParVectorLocalVector((hypre_ParVector *) u);
+    int onProcSize = hypre_VectorSize(u_local);
+    if (buffer.capacity < onProcSize) {
+        delete[] buffer.data;
+        buffer.data     = new double[onProcSize];
+        buffer.capacity = onProcSize;
+    }
+    std::copy(hypre_VectorData(u_local), hypre_VectorData(u_local) + onProcSize, buffer.data);
+    buffer.ilower = hypre_ParVectorFirstIndex((hypre_ParVector *) u);
+    buffer.iupper = buffer.ilower + onProcSize - 1;
+    
+    char rankSuffix[16];
+    snprintf(rankSuffix, sizeof(rankSuffix), ".%05d", m_spatialRank);
+    buffer.filename = m_snapshot_prefix + "." + std::to_string(step) + rankSuffix;
+    m_snapshot_copy_time += MPI_Wtime() - copyStart;
+    
+    // Write buffer in background
+    buffer.writer = std::thread(WriteSnapshotBuffer, &buffer);
+    
+    m_snapshot_times.push_back(std::make_pair(step, t));
+    m_snapshot_count += 1;
+}
+
+
+/* Wait for all snapshots to be written, free buffers, and write list of the steps and times 
+    of all snapshots to <prefix>.times */
+void SpaceTimeMatrix::FinishSnapshots()
+{
+    if (m_snapshot_count == 0) return;
+    
+    double waitStart = MPI_Wtime();
+    for (int i = 0; i < 2; i++) {
+        if (m_snapshot_buffer[i].writer.joinable()) m_snapshot_buffer[i].writer.join();
+        delete[] m_snapshot_buffer[i].data;
+        m_snapshot_buffer[i].data     = NULL;
+        m_snapshot_buffer[i].capacity = 0;
+    }
+    m_snapshot_wait_time += MPI_Wtime() - waitStart;
+    
+    if (m_spatialRank == 0) {
+        std::ofstream timesFile(m_snapshot_prefix + ".times");
+        timesFile << std::setprecision(16);
+        for (size_t i = 0; i < m_snapshot_times.size(); i++) {
+            timesFile << m_snapshot_times[i].first << " " << m_snapshot_times[i].second << "\n";
+        }
+        timesFile.close();
+        
+        std::cout << "Snapshots written = " << m_snapshot_count << ": copy time = " << m_snapshot_copy_time 
+                    << "s, time waiting for writes = " << m_snapshot_wait_time << "s\n";
+    }
+    m_snapshot_count = 0;
+    m_snapshot_times.clear();
+    m_snapshot_copy_time = 0.0;
+    m_snapshot_wait_time = 0.0;
+}
+
+
 
 
 SpaceTimeMatrix::SpaceTimeMatrix(MPI_Comm globComm, bool pit, bool M_exists, 
                                     int timeDisc, int nt, double dt)
     : m_globComm{globComm}, m_pit{pit}, m_M_exists{M_exists}, m_timeDisc{timeDisc}, m_nt{nt}, m_dt{dt},
       m_solverComm(NULL), m_solver(NULL), m_gmres(NULL), m_pcg(NULL), m_bij(NULL), m_xij(NULL), m_Aij(NULL),
-      m_u_multi({}), m_u_multi_ij({}),
-      m_Mij(NULL), m_invMij(NULL), m_iterative(true), 
+      m_A_s(NULL), m_binv_A(NULL), m_matrixFree(false), m_blockFS(),
+      m_u_multi({}), m_u_multi_ij({}), m_t0(0.0),
+      m_M(NULL), m_Mij(NULL), m_invM(NULL), m_invMij(NULL), m_iterative(true), 
+      m_solverRebuilt(false), m_setup_time(0), m_solve_time(0), 
+      m_solve_count(0), m_total_iters(0), m_max_res_norm(0),
+      m_rebuild_due(false), m_rebuild_baseIters(-1), m_rebuild_baseRate(0), 
+      m_rebuild_baseSolveTime(0), m_rebuild_setupTime(0), m_rebuild_staleTime(0),
+      m_massPrecond({}), m_massBsize(1), m_massEigMin(0), m_massEigMax(0), m_massChebyIters(0),
+      m_massWork({}), m_massWork_ij({}),
       m_RK(false), m_ERK(false), m_DIRK(false), m_SDIRK(false),
+      m_bhat_butcher({}), m_bhat_order(0), m_accepted_steps(0), m_rejected_steps(0),
       m_multi(false), m_AB(false), m_AM(false), m_BDF(false), 
       m_a_multi({}), m_b_multi({}), 
       m_M_rowptr(NULL), m_M_colinds(NULL), m_M_data(NULL), m_rebuildSolver(false),
       m_spatialComm(NULL), m_L_isTimedependent(true), m_G_isTimedependent(true),
       m_bsize(1), m_hmin(-1), m_hmax(-1),
-      m_M_localMinRow(-1), m_M_localMaxRow(-1),  m_rebuildMass(true)
+      m_M_localMinRow(-1), m_M_localMaxRow(-1),  m_rebuildMass(true),
+      m_L_cache({}), m_G_cache({}), m_cache_budget(256.0*1024*1024), 
+      m_cache_useCount(0), m_cache_hits(0), m_cache_misses(0), m_cache_pinned(false),
+      m_DIRK_cache({}), m_DIRK_budget(256.0*1024*1024), m_DIRK_useCount(0), m_DIRK_hits(0), m_DIRK_misses(0), m_DIRK_maxBytes(0),
+      m_pool_active(false), m_pool_requests(0), m_pool_hits(0), m_pool_bytes(0),
+      m_checkpoint_prefix("checkpoint"), m_checkpoint_rate(0), m_restart(false), m_checkpoint_count(0), m_step0(0),
+      m_snapshot_prefix("snapshot"), m_snapshot_rate(0), m_snapshot_count(0), m_snapshot_times({}),
+      m_snapshot_copy_time(0), m_snapshot_wait_time(0),
+      m_num_windows(1), m_window_u0(NULL), m_window_u0_size(0),
+      m_batch_u0({}), m_batch_u0_size(0), m_batch_b({}), m_batch_x({}), m_batch_iters({}), m_batch_res_norm({}),
+      m_batch_true_res_norm({}), m_batch_solve_time({}), m_batch_setup_time(0), m_batch_time(0)
 {
         
     // Get number of processes
     MPI_Comm_rank(m_globComm, &m_globRank);
     MPI_Comm_size(m_globComm, &m_numProc);
+    
+    for (int i = 0; i < 2; i++) {
+        m_snapshot_buffer[i].data     = NULL;
+        m_snapshot_buffer[i].capacity = 0;
+    }
+    
+    for (int i = 0; i < NUM_TIMERS; i++) {
+        m_phase_time[i] = 0.0;
+        m_phase_min[i]  = 0.0;
+        m_phase_max[i]  = 0.0;
+        m_phase_avg[i]  = 0.0;
+    }
 
 
     // Swap AM0 to BDF1 to simplify implementation of AM schemes.
@@ -351,9 +888,12 @@ SpaceTimeMatrix::SpaceTimeMatrix(MPI_Comm globComm, bool pit, bool M_exists,
         m_AB = true;
         SetABTableaux(); // Get AB coefficients
         
-        std::cout << "WARNING: AB TIME INTEGRATION NOT IMPLEMENTED" << '\n';
-        MPI_Finalize();
-        exit(1);
+        // Only sequential time-stepping is implemented
+        if (m_pit) {
+            std::cout << "WARNING: AB SPACE-TIME INTEGRATION NOT IMPLEMENTED" << '\n';
+            MPI_Finalize();
+            exit(1);
+        }
         
     // Adams--Moulton time integration
     } else if (m_timeDisc >= 20 && m_timeDisc < 30) {
@@ -560,17 +1100,34 @@ SpaceTimeMatrix::~SpaceTimeMatrix()
     // if (m_Mij)    HYPRE_IJMatrixDestroy(m_Mij);   
     // if (m_invMij) HYPRE_IJMatrixDestroy(m_invMij);   
     
+    ClearSpatialDiscretizationCache();
+    ClearDIRKCache();
+    ClearBufferPool();
+    FinishSnapshots();
+    if (m_window_u0) delete[] m_window_u0;
+    for (size_t i = 0; i < m_batch_u0.size(); i++) delete[] m_batch_u0[i];
+    for (size_t i = 0; i < m_batch_x.size(); i++) {
+        delete[] m_batch_b[i];
+        delete[] m_batch_x[i];
+    }
+    
     // TODO : destroy mass matrix member variables here...
 }
 
 /* General solve function, calls appropriate time integration routine */
 void SpaceTimeMatrix::Solve() {
     
+    // Solve space-time system for each of a batch of initial conditions
+    if (m_pit && !m_batch_u0.empty()) {
+        BatchSpaceTimeSolve();
+    
+    // Solve space-time system one window of time at a time
+    } else if (m_pit && m_num_windows > 1) {
+        WindowedSpaceTimeSolve();
+    
     // Solve space-time system
-    if (m_pit) {
+    } else if (m_pit) {
         
-        // TODO : Potentially wrap timer around this code block. This encompasses the entirety of the code 
-        // used to initialize multistep schemes.
         // Construct values to be inserted into RHS of space-time system to initialize a multistep scheme
         if (m_multi) {
             // Only have processes that need starting values actually obtain them
@@ -601,8 +1158,8 @@ void SpaceTimeMatrix::Solve() {
             MPI_Barrier(m_globComm);
         }
         
-        // Build the space-time matrix
-        BuildSpaceTimeMatrix(); 
+        // Build the space-time matrix, or only rewrite its values if it's been built before
+        RefreshSpaceTimeMatrix(); 
         
         // Call appropiate solver
         if (m_solver_parameters.use_gmres) {
@@ -617,62 +1174,461 @@ void SpaceTimeMatrix::Solve() {
     } else {
         TimeSteppingSolve();
     }
+    
+    ReduceTimers();
 }
 
 
-/* Destroy all HYPRE member variables; this is necessary if switching 
-    from time-stepping to space-time within an instance of the code.
- */
-void SpaceTimeMatrix::DestroyHypreMemberVariables() 
+/* Solve the space-time system over [0, T] in m_num_windows consecutive windows of m_nt 
+    time steps, the initial condition of each window being the solution at the end of 
+    the previous one. Memory, and the cost of solver setup, depend on m_nt rather than 
+    on the total number of time steps.
+
+NOTES:
+    -Only RK space-time systems are supported.
+    -The space-time matrix and its solver are built once. If L is time-independent, they 
+        are reused for all windows, with only the RHS vector rewritten; otherwise the values 
+        of the matrix are rewritten for each window and the solver rebuilt.
+    -On exit, m_t0 is the starting time of the last window, and m_x is the solution over it.
+*/
+void SpaceTimeMatrix::WindowedSpaceTimeSolve()
 {
-    if (m_solver) {
-        HYPRE_BoomerAMGDestroy(m_solver);
-        m_solver = NULL;
-    }
-    if (m_gmres) {
-        HYPRE_ParCSRGMRESDestroy(m_gmres);
-        m_gmres = NULL;
-    }
-    if (m_pcg) {
-        HYPRE_ParCSRPCGDestroy(m_pcg); 
-        m_pcg = NULL;
-    }   
-    if (m_Aij) {
-        HYPRE_IJMatrixDestroy(m_Aij);   // This destroys parCSR matrix too
-        m_Aij = NULL;
-    }
-    if (m_bij) {
-        HYPRE_IJVectorDestroy(m_bij);   // This destroys parVector too
-        m_bij = NULL;
-    }
-    if (m_xij) {
-        HYPRE_IJVectorDestroy(m_xij);
-        m_xij = NULL;
+    if (!m_RK) {
+        if (m_globRank == 0) std::cout << "WARNING: Windowed space-time solves only implemented for RK schemes" << '\n';
+        MPI_Finalize();
+        exit(1);
     }
-    if (m_Mij) {
-        HYPRE_IJMatrixDestroy(m_Mij);   
-        m_Mij = NULL;
+    
+    int    total_iters = 0;
+    int    max_iters   = 0;
+    int    rebuild_count = 0;   // Number of times solver is (re)built
+    double setup_time    = 0.0; // Total wall time of solver setups
+    double solve_time    = 0.0; // Total wall time of solves
+    
+    for (int window = 0; window < m_num_windows; window++) {
+        m_t0 = window * m_nt * m_dt; 
+        if (m_globRank == 0) {
+            std::cout << "\nSpace-time window " << window+1 << " of " << m_num_windows 
+                        << ": t in [" << m_t0 << ", " << m_t0 + m_nt * m_dt << "]\n";
+        }
+        
+        // Build the space-time system for the first window. Thereafter, the initial condition 
+        // has changed, and the matrix has too unless the spatial discretization is time-independent
+        if (window == 0 || m_L_isTimedependent) {
+            RefreshSpaceTimeMatrix();
+        } else {
+            RefreshSpaceTimeRHS();
+        }
+        
+        // Call appropiate solver
+        if (m_solver_parameters.use_gmres) {
+            SolveGMRES(); 
+        } else {
+            SolveAMG();
+        }
+        total_iters   += m_num_iters;
+        max_iters      = std::max(max_iters, m_num_iters);
+        rebuild_count += (int) m_solverRebuilt;
+        setup_time    += m_setup_time;
+        solve_time    += m_solve_time;
+        
+        // Ensure desired tolerance was reached, otherwise the next window starts from an inaccurate state
+        if (m_res_norm > m_solver_parameters.tol && m_globRank == 0) {
+            std::cout << "WARNING: Window " << window+1 << ": Tol after " << m_num_iters << " iters (max iterations) = " 
+                        << m_res_norm << " > desired tol = " << m_solver_parameters.tol << '\n';
+        }
+        
+        if (window < m_num_windows-1) SetNextWindowInitialCondition();
     }
-    if (m_invMij) { 
-        HYPRE_IJMatrixDestroy(m_invMij);  
-        m_invMij = NULL;
+    
+    if (m_globRank == 0) {
+        std::cout << "=============================================\n";
+        std::cout << "Summary of windowed space-time solves\n";
+        std::cout << "---------------------------------------------\n";
+        std::cout << "Number of windows = " << m_num_windows << " of nt = " << m_nt << " time steps\n";
+        std::cout << "Average number of iterations = " << (double) total_iters / m_num_windows << ", maximum = " << max_iters << '\n';
+        std::cout << "Number of solver rebuilds = " << rebuild_count << '\n';
+        std::cout << "Solver setup time = " << setup_time << "s, solve time = " << solve_time << "s\n";
     }
-    for (int i = 0; i < m_u_multi_ij.size(); i++) {
-        if (m_u_multi_ij[i]) {
-            HYPRE_IJVectorDestroy(m_u_multi_ij[i]);
-            m_u_multi_ij[i] = NULL;
+    
+    // Initial condition of the windows is no longer needed
+    delete[] m_window_u0;
+    m_window_u0      = NULL;
+    m_window_u0_size = 0;
+}
+
+
+/* Set m_window_u0 to be the solution at the final time of the current window, so that it's 
+    the initial condition of the next window. Every process gets the rows of the solution 
+    matching those of the spatial problem it holds.
+*/
+void SpaceTimeMatrix::SetNextWindowInitialCondition()
+{
+    double * x_data     = hypre_VectorData(hypre_ParVectorLocalVector((hypre_ParVector *) m_x));
+    int      onProcSize = hypre_VectorSize(hypre_ParVectorLocalVector((hypre_ParVector *) m_x));
+    
+    /* --- Spatial parallelism: Solution at final time is held by spatial communicator of last DOF --- */
+    if (m_useSpatialParallel) {
+        // Processes with the same rank on each spatial communicator hold the same rows of 
+        // the spatial problem: Broadcast from the one holding the last DOF to all the others 
+        MPI_Comm temporalComm;
+        int      root;
+        MPI_Comm_split(m_globComm, m_spatialRank, m_DOFInd, &temporalComm);
+        MPI_Comm_size(temporalComm, &root);
+        root -= 1; // Ranks are ordered by DOF index
+        
+        if (m_window_u0_size != onProcSize) {
+            delete[] m_window_u0;
+            m_window_u0      = new double[onProcSize];
+            m_window_u0_size = onProcSize;
+        }
+        if (m_DOFInd == m_nt * m_s_butcher - 1) std::copy(x_data, x_data + onProcSize, m_window_u0);
+        MPI_Bcast(m_window_u0, onProcSize, MPI_DOUBLE, root, temporalComm);
+        MPI_Comm_free(&temporalComm);
+        
+    /* --- No spatial parallelism: Solution at final time is the last rows on the last process --- */
+    } else {
+        int spatialDOFs = onProcSize / m_nDOFPerProc;
+        if (m_window_u0_size != spatialDOFs) {
+            delete[] m_window_u0;
+            m_window_u0      = new double[spatialDOFs];
+            m_window_u0_size = spatialDOFs;
         }
+        if (m_globRank == m_numProc-1) std::copy(x_data + onProcSize - spatialDOFs, x_data + onProcSize, m_window_u0);
+        MPI_Bcast(m_window_u0, spatialDOFs, MPI_DOUBLE, m_numProc-1, m_globComm);
     }
 }
 
 
-/* Given the s-starting values, m_u_multi, create the terms necessary to 
-put them straight into the RHS of the space-time linear system 
-
-NOTE:
-    -This also frees m_u_multi at its completion since this is no longer needed.
-*/
-void SpaceTimeMatrix::SetMultistepSpaceTimeRHSValues()
+/* Get initial condition of space-time system: The PDE initial condition, or, if solving in 
+    windows, the solution at the end of the previous window. No spatial parallelism. */
+void SpaceTimeMatrix::GetSpaceTimeInitialCondition(double * &u0, 
+                                                   int      &spatialDOFs)
+{
+    if (!m_window_u0) {
+        getInitialCondition(u0, spatialDOFs);
+        return;
+    }
+    spatialDOFs = m_window_u0_size;
+    u0          = new double[spatialDOFs];
+    std::copy(m_window_u0, m_window_u0 + spatialDOFs, u0);
+}
+
+
+/* Get initial condition of space-time system: The PDE initial condition, or, if solving in 
+    windows, the solution at the end of the previous window. Uses spatial parallelism. 
+
+NOTES:
+    -If solving in windows, localMinRow, localMaxRow and spatialDOFs are not set, and so 
+        must be passed in with their values from the spatial discretization.
+*/
+void SpaceTimeMatrix::GetSpaceTimeInitialCondition(MPI_Comm   spatialComm, 
+                                                   double   * &u0, 
+                                                   int       &localMinRow, 
+                                                   int       &localMaxRow, 
+                                                   int       &spatialDOFs)
+{
+    if (!m_window_u0) {
+        getInitialCondition(spatialComm, u0, localMinRow, localMaxRow, spatialDOFs);
+        return;
+    }
+    u0 = new double[m_window_u0_size];
+    std::copy(m_window_u0, m_window_u0 + m_window_u0_size, u0);
+}
+
+
+/* Split [0, T] into numWindows windows of nt time steps, solving the space-time system 
+    on one window at a time */
+void SpaceTimeMatrix::SetTimeWindows(int numWindows)
+{
+    m_num_windows = std::max(numWindows, 1);
+}
+
+
+/* Set initial conditions of a batch of space-time systems, e.g., an ensemble, which Solve 
+    then solves in turn. u0[j] holds the rows of the jth initial condition that match those 
+    of the spatial problem on this process (all rows if there's no spatial parallelism; see 
+    GetInitialConditionRows). The data are copied. */
+void SpaceTimeMatrix::SetBatchInitialConditions(const std::vector<double *> &u0, 
+                                                int                          onProcSize)
+{
+    for (size_t i = 0; i < m_batch_u0.size(); i++) delete[] m_batch_u0[i];
+    m_batch_u0.resize(u0.size());
+    for (size_t i = 0; i < u0.size(); i++) {
+        m_batch_u0[i] = new double[onProcSize];
+        std::copy(u0[i], u0[i] + onProcSize, m_batch_u0[i]);
+    }
+    m_batch_u0_size = onProcSize;
+}
+
+
+/* Get the rows of the PDE initial condition matching those of the spatial problem on this 
+    process, e.g., to set up a batch of initial conditions. u0 is to be deleted by the caller. */
+void SpaceTimeMatrix::GetInitialConditionRows(double * &u0, 
+                                              int      &onProcSize)
+{
+    if (m_useSpatialParallel) {
+        int localMinRow, localMaxRow, spatialDOFs;
+        getInitialCondition(m_spatialComm, u0, localMinRow, localMaxRow, spatialDOFs);
+        onProcSize = localMaxRow - localMinRow + 1;
+    } else {
+        getInitialCondition(u0, onProcSize);
+    }
+}
+
+
+/* Solve the space-time system for each initial condition of the batch set by 
+    SetBatchInitialConditions. The space-time matrix is assembled, and the solver set up, 
+    for the first system only; for the others, only the RHS vector is rewritten.
+
+NOTES:
+    -Only RK space-time systems are supported, and they cannot be solved in windows.
+    -The local rows of the RHS vector and solution of each system are kept in m_batch_b and 
+        m_batch_x. On exit, m_x is the solution of the last system.
+    -The true residual norms of all systems are computed together at the end by one block 
+        matvec (unless the space-time matrix is applied matrix-free).
+*/
+void SpaceTimeMatrix::BatchSpaceTimeSolve()
+{
+    if (!m_RK) {
+        if (m_globRank == 0) std::cout << "WARNING: Batch space-time solves only implemented for RK schemes" << '\n';
+        MPI_Finalize();
+        exit(1);
+    }
+    if (m_num_windows > 1) {
+        if (m_globRank == 0) std::cout << "WARNING: Batch space-time solves cannot be solved in windows" << '\n';
+        MPI_Finalize();
+        exit(1);
+    }
+    
+    double batchStart = MPI_Wtime();
+    int    numRHS     = m_batch_u0.size();
+    for (size_t i = 0; i < m_batch_x.size(); i++) {
+        delete[] m_batch_b[i];
+        delete[] m_batch_x[i];
+    }
+    m_batch_b.assign(numRHS, NULL);
+    m_batch_x.assign(numRHS, NULL);
+    m_batch_iters.resize(numRHS);
+    m_batch_res_norm.resize(numRHS);
+    m_batch_solve_time.resize(numRHS);
+    
+    for (int rhs = 0; rhs < numRHS; rhs++) {
+        if (m_globRank == 0) std::cout << "\nBatch space-time system " << rhs+1 << " of " << numRHS << "\n";
+        
+        // The initial condition of the system replaces that of the PDE
+        m_window_u0      = m_batch_u0[rhs];
+        m_window_u0_size = m_batch_u0_size;
+        
+        // Build the space-time system for the first initial condition; thereafter only the RHS changes
+        if (rhs == 0) {
+            RefreshSpaceTimeMatrix();
+        } else {
+            RefreshSpaceTimeRHS();
+        }
+        
+        // Call appropiate solver
+        if (m_solver_parameters.use_gmres) {
+            SolveGMRES(); 
+        } else {
+            SolveAMG();
+        }
+        m_batch_iters[rhs]      = m_num_iters;
+        m_batch_res_norm[rhs]   = m_res_norm;
+        m_batch_solve_time[rhs] = m_solve_time;
+        if (rhs == 0) m_batch_setup_time = MPI_Wtime() - batchStart - m_solve_time;
+        
+        // Keep RHS vector and solution
+        double * b_data     = hypre_VectorData(hypre_ParVectorLocalVector((hypre_ParVector *) m_b));
+        double * x_data     = hypre_VectorData(hypre_ParVectorLocalVector((hypre_ParVector *) m_x));
+        int      onProcSize = hypre_VectorSize(hypre_ParVectorLocalVector((hypre_ParVector *) m_x));
+        m_batch_b[rhs] = new double[onProcSize];
+        m_batch_x[rhs] = new double[onProcSize];
+        std::copy(b_data, b_data + onProcSize, m_batch_b[rhs]);
+        std::copy(x_data, x_data + onProcSize, m_batch_x[rhs]);
+    }
+    m_window_u0      = NULL; // Belongs to m_batch_u0
+    m_window_u0_size = 0;
+    
+    if (m_matrixFree) {
+        m_batch_true_res_norm.assign(numRHS, -1.0);
+    } else {
+        BlockResidualNorms(m_A, m_batch_x, m_batch_b, m_batch_true_res_norm);
+    }
+    m_batch_time = MPI_Wtime() - batchStart;
+    
+    if (m_globRank == 0) {
+        double solve_time = 0.0;
+        for (int rhs = 0; rhs < numRHS; rhs++) solve_time += m_batch_solve_time[rhs];
+        std::cout << "=============================================\n";
+        std::cout << "Summary of batch space-time solves\n";
+        std::cout << "---------------------------------------------\n";
+        std::cout << "System  iters  rel res (solver)  rel res (true)  solve time\n";
+        for (int rhs = 0; rhs < numRHS; rhs++) {
+            std::cout << std::setw(6) << rhs+1 << std::setw(7) << m_batch_iters[rhs] << std::scientific << std::setprecision(3)
+                        << std::setw(18) << m_batch_res_norm[rhs] << std::setw(16) << m_batch_true_res_norm[rhs] 
+                        << std::setw(11) << m_batch_solve_time[rhs] << "s\n" << std::defaultfloat;
+        }
+        std::cout << "Assembly and solver setup time (once) = " << m_batch_setup_time << "s, total solve time = " 
+                    << solve_time << "s, total time = " << m_batch_time << "s\n";
+    }
+}
+
+
+/* Relative residual norms, ||B[v] - A*X[v]|| / ||B[v]||, of the vectors with local rows X[v] 
+    and B[v]. A is applied to all the vectors at once, so that the values needed from each 
+    neighbouring process are received in one message, and the entries of A are read once 
+    rather than once per vector. */
+void SpaceTimeMatrix::BlockResidualNorms(HYPRE_ParCSRMatrix           A, 
+                                         const std::vector<double *> &X, 
+                                         const std::vector<double *> &B, 
+                                         std::vector<double>         &res_norm)
+{
+    hypre_CSRMatrix * diag        = hypre_ParCSRMatrixDiag(A);
+    hypre_CSRMatrix * offd        = hypre_ParCSRMatrixOffd(A);
+    HYPRE_Int       * diag_i      = hypre_CSRMatrixI(diag);
+    HYPRE_Int       * diag_j      = hypre_CSRMatrixJ(diag);
+    HYPRE_Complex   * diag_data   = hypre_CSRMatrixData(diag);
+    HYPRE_Int       * offd_i      = hypre_CSRMatrixI(offd);
+    HYPRE_Int       * offd_j      = hypre_CSRMatrixJ(offd);
+    HYPRE_Complex   * offd_data   = hypre_CSRMatrixData(offd);
+    int               onProcSize  = hypre_CSRMatrixNumRows(diag);
+    int               numColsOffd = hypre_CSRMatrixNumCols(offd);
+    MPI_Comm          comm        = hypre_ParCSRMatrixComm(A);
+    int               k           = X.size();
+    
+    if (!hypre_ParCSRMatrixCommPkg(A)) hypre_MatvecCommPkgCreate(A);
+    hypre_ParCSRCommPkg * commPkg = hypre_ParCSRMatrixCommPkg(A);
+    int numSends = hypre_ParCSRCommPkgNumSends(commPkg);
+    int numRecvs = hypre_ParCSRCommPkgNumRecvs(commPkg);
+    
+    /* --- Exchange off-process values of all vectors: Entry v of column j is at j*k + v --- */
+    int sendSize = hypre_ParCSRCommPkgSendMapStart(commPkg, numSends);
+    std::vector<double> sendValues(sendSize * k);
+    std::vector<double> recvValues(numColsOffd * k);
+    for (int j = 0; j < sendSize; j++) {
+        int row = hypre_ParCSRCommPkgSendMapElmt(commPkg, j);
+        for (int v = 0; v < k; v++) sendValues[j*k + v] = X[v][row];
+    }
+    
+    std::vector<MPI_Request> requests(numRecvs + numSends);
+    for (int i = 0; i < numRecvs; i++) {
+        int start = hypre_ParCSRCommPkgRecvVecStart(commPkg, i);
+        int end   = hypre_ParCSRCommPkgRecvVecStart(commPkg, i+1);
+        MPI_Irecv(&recvValues[start*k], (end - start)*k, MPI_DOUBLE, 
+                    hypre_ParCSRCommPkgRecvProc(commPkg, i), 0, comm, &requests[i]);
+    }
+    for (int i = 0; i < numSends; i++) {
+        int start = hypre_ParCSRCommPkgSendMapStart(commPkg, i);
+        int end   = hypre_ParCSRCommPkgSendMapStart(commPkg, i+1);
+        MPI_Isend(&sendValues[start*k], (end - start)*k, MPI_DOUBLE, 
+                    hypre_ParCSRCommPkgSendProc(commPkg, i), 0, comm, &requests[numRecvs + i]);
+    }
+    
+    /* --- Residuals: On-process part is computed while messages are in flight --- */
+    std::vector<double> r(onProcSize * k);
+    for (int row = 0; row < onProcSize; row++) {
+        for (int v = 0; v < k; v++) r[row*k + v] = B[v][row];
+        for (int p = diag_i[row]; p < diag_i[row+1]; p++) {
+            for (int v = 0; v < k; v++) r[row*k + v] -= diag_data[p] * X[v][diag_j[p]];
+        }
+    }
+    if (numRecvs + numSends > 0) MPI_Waitall(numRecvs + numSends, requests.data(), MPI_STATUSES_IGNORE);
+    if (numColsOffd > 0) {
+        for (int row = 0; row < onProcSize; row++) {
+            for (int p = offd_i[row]; p < offd_i[row+1]; p++) {
+                for (int v = 0; v < k; v++) r[row*k + v] -= offd_data[p] * recvValues[offd_j[p]*k + v];
+            }
+        }
+    }
+    
+    // Norms of residuals and of B, with a single reduction
+    std::vector<double> sums(2*k, 0.0);
+    for (int row = 0; row < onProcSize; row++) {
+        for (int v = 0; v < k; v++) {
+            sums[v]   += r[row*k + v] * r[row*k + v];
+            sums[k+v] += B[v][row] * B[v][row];
+        }
+    }
+    MPI_Allreduce(MPI_IN_PLACE, sums.data(), 2*k, MPI_DOUBLE, MPI_SUM, comm);
+    res_norm.resize(k);
+    for (int v = 0; v < k; v++) {
+        res_norm[v] = (sums[k+v] > 0.0) ? std::sqrt(sums[v] / sums[k+v]) : std::sqrt(sums[v]);
+    }
+}
+
+
+/* Save solution of each system of a batch solve, the jth to filename_rhs<j> */
+void SpaceTimeMatrix::SaveBatchX(std::string filename)
+{
+    if (!m_xij || m_batch_x.empty()) {
+        std::cout << "WARNING: No batch solutions, cannot be printed!\n";
+        return;
+    }
+    int onProcSize = hypre_VectorSize(hypre_ParVectorLocalVector((hypre_ParVector *) m_x));
+    for (size_t rhs = 0; rhs < m_batch_x.size(); rhs++) {
+        SetHypreVectorValuesFromData(m_x, m_batch_x[rhs], onProcSize);
+        HYPRE_IJVectorPrint(m_xij, (filename + "_rhs" + std::to_string(rhs)).c_str());
+    }
+}
+
+
+/* Destroy all HYPRE member variables; this is necessary if switching 
+    from time-stepping to space-time within an instance of the code.
+ */
+void SpaceTimeMatrix::DestroyHypreMemberVariables() 
+{
+    if (m_solver) {
+        HYPRE_BoomerAMGDestroy(m_solver);
+        m_solver = NULL;
+    }
+    if (m_gmres) {
+        HYPRE_ParCSRGMRESDestroy(m_gmres);
+        m_gmres = NULL;
+    }
+    if (m_pcg) {
+        HYPRE_ParCSRPCGDestroy(m_pcg); 
+        m_pcg = NULL;
+    }   
+    ClearMassSolver();
+    if (m_Aij) {
+        HYPRE_IJMatrixDestroy(m_Aij);   // This destroys parCSR matrix too
+        m_Aij = NULL;
+    }
+    ClearBinvScaling();
+    ClearBlockForwardSubstitution();
+    if (m_bij) {
+        HYPRE_IJVectorDestroy(m_bij);   // This destroys parVector too
+        m_bij = NULL;
+    }
+    if (m_xij) {
+        HYPRE_IJVectorDestroy(m_xij);
+        m_xij = NULL;
+    }
+    if (m_Mij) {
+        HYPRE_IJMatrixDestroy(m_Mij);   
+        m_Mij = NULL;
+    }
+    if (m_invMij) { 
+        HYPRE_IJMatrixDestroy(m_invMij);  
+        m_invMij = NULL;
+    }
+    for (int i = 0; i < m_u_multi_ij.size(); i++) {
+        if (m_u_multi_ij[i]) {
+            HYPRE_IJVectorDestroy(m_u_multi_ij[i]);
+            m_u_multi_ij[i] = NULL;
+        }
+    }
+}
+
+
+/* Given the s-starting values, m_u_multi, create the terms necessary to 
+put them straight into the RHS of the space-time linear system 
+
+NOTE:
+    -This also frees m_u_multi at its completion since this is no longer needed.
+*/
+void SpaceTimeMatrix::SetMultistepSpaceTimeRHSValues()
 {
     if (m_AB) {
         std::cout << "WARNING: CODE TO CONSTRUCT RHS FOR AB NOT WRITTEN" << '\n';
@@ -685,15 +1641,18 @@ void SpaceTimeMatrix::SetMultistepSpaceTimeRHSValues()
     } else if (m_BDF) {
         
         // Compute vector that's multiplied by the mass matrix
+        std::vector<double>          coeffs;
+        std::vector<HYPRE_ParVector> terms;
         for (int n = 0; n <= m_s_multi - 1; n++) {            
             // This linear combination overwrites the start value it uses first, v[n]
-            for (int j = m_s_multi; j >= n+1; j--) {
-                if (j == m_s_multi) {
-                    HYPRE_ParVectorScale(-m_a_multi[m_s_multi-j], m_u_multi[n]); // v[n] <- -a[0] * v[n]
-                } else {
-                    HYPRE_ParVectorAxpy(-m_a_multi[m_s_multi-j], m_u_multi[n+m_s_multi-j], m_u_multi[n]); // v[n] <- v[n] + a[s-j] * v[j-1]
-                }
-            }    
+            // v[n] <- -a[0] * v[n] - \sum_{j=n+1}^{s-1} a[s-j] * v[j-1]
+            coeffs.clear();
+            terms.clear();
+            for (int j = m_s_multi-1; j >= n+1; j--) {
+                coeffs.push_back(-m_a_multi[m_s_multi-j]);
+                terms.push_back(m_u_multi[n+m_s_multi-j]);
+            }
+            LinearCombination(-m_a_multi[0], m_u_multi[n], coeffs, terms);
         }
         
         // Scale by mass matrix if one exists
@@ -755,6 +1714,14 @@ void SpaceTimeMatrix::SetMultistepSpaceTimeRHSValues()
 /* Call appropiate sequential time-stepping routine */
 void SpaceTimeMatrix::TimeSteppingSolve()
 {
+    if (m_solver_parameters.initial_guess < 0 || m_solver_parameters.initial_guess > 3) {
+        if (m_globRank == 0) std::cout << "WARNING: Initial guess option " << m_solver_parameters.initial_guess << " not recognised; must be 0, 1, 2, or 3" << '\n';
+        MPI_Finalize();
+        exit(1);
+    }
+    
+    m_step0 = 0;
+    
     /* Runge-Kutta routines: Integrate nt-1 steps from time=0 */
     if (m_RK) {
         m_t0 = 0.0; // Set global starting time to 0
@@ -777,8 +1744,8 @@ void SpaceTimeMatrix::TimeSteppingSolve()
     /* Multistep routines: Need to initialize first s steps using Runge-Kutta 
     integration, then integrate up to t_{nt-1} */
     } else if (m_multi) {     
-        // Populate member vectors with the s starting values we need
-        SetMultistepStartValues();
+        // Populate member vectors with the s starting values we need, unless resuming from a checkpoint
+        if (!m_restart || !ReadMultistepCheckpoint()) SetMultistepStartValues();
         
         /* Call appropiate multstep routine */
         if (m_AB) {
@@ -789,6 +1756,14 @@ void SpaceTimeMatrix::TimeSteppingSolve()
             BDFTimeSteppingSolve();
         }
     }
+    
+    // Wait for snapshots still being written
+    FinishSnapshots();
+    
+    // Cached DIRK systems and transient buffers are no longer needed
+    ClearDIRKCache();
+    ReportBufferPool();
+    ClearBufferPool();
 }
 
 
@@ -801,6 +1776,7 @@ NOTE:
 void SpaceTimeMatrix::SetMultistepStartValues() 
 {
     if (m_globRank == 0) std::cout << "Initializing starting values for multistep time integration\n";
+    double startValuesStart = MPI_Wtime();
     
     // Temporarily store variables while they're reset for use in RK routines
     int  timeDisc_temp = m_timeDisc; 
@@ -899,6 +1875,11 @@ void SpaceTimeMatrix::SetMultistepStartValues()
            
     }
     
+    // Cached DIRK systems and transient buffers are no longer needed
+    ClearDIRKCache();
+    ClearBufferPool();
+    m_phase_time[TIMER_STARTING_VALUES] += MPI_Wtime() - startValuesStart;
+    
     // Reset variables to their original values
     m_t0       = 0.0;
     m_timeDisc = timeDisc_temp;
@@ -907,26 +1888,20 @@ void SpaceTimeMatrix::SetMultistepStartValues()
 }
 
 
-/* Sequential time-stepping routine for arbitrary Adams--Bashforth schemes */
-void SpaceTimeMatrix::ABTimeSteppingSolve() 
-{
-}
-
-/* Sequential time-stepping routine for arbitrary Adams--Moulton schemes */
-void SpaceTimeMatrix::AMTimeSteppingSolve() 
-{
-}
-
-/* Sequential time-stepping routine for arbitrary BDF schemes 
+/* Sequential time-stepping routine for arbitrary Adams--Bashforth schemes 
 
     After this function has executed, the solution at the final time is stored in 
-        m_x, which is just a pointer to the head of the list m_u_multi
-
-NOTE:
-    -m_u_multi must contain the s starting values required to initiate s-step BDF; 
-    that is, m_u_multi==[u(t_0),...,u(t_{s-1})], s>=1.
+        m_x, which is just a pointer to an element of the list m_u_multi
+
+NOTES:
+    -m_u_multi must contain the s starting values required to initiate s-step AB; 
+        that is, m_u_multi==[u(t_0),...,u(t_{s-1})], s>=1.
+    -For the ODEs M*du/dt = -L*u + g, the s most recent values of f == M^{-1}*(-L*u + g) 
+        are stored in a ring buffer, so that each step costs one MATVEC (plus a mass 
+        solve if M exists), and one fused linear combination,
+            u[n+1] = u[n] + dt*\sum_{j=0}^{s-1} b[j] * f[n+1-s+j].
 */
-void SpaceTimeMatrix::BDFTimeSteppingSolve() 
+void SpaceTimeMatrix::ABTimeSteppingSolve() 
 {
     /* ---------------------------------------------------------------------- */
     /* ------------------------ Setup/initialization ------------------------ */
@@ -934,115 +1909,339 @@ void SpaceTimeMatrix::BDFTimeSteppingSolve()
     
     // Check that solution vector has been initialized!
     if (m_u_multi_ij.empty()) {
-        std::cout << "WARNING: Global solution vector must be allocated before beginning BDF time stepping" << '\n';
+        std::cout << "WARNING: Global solution vector must be allocated before beginning AB time stepping" << '\n';
         MPI_Finalize();
         exit(1);
     }
     
-    int headptr = m_s_multi - 1;    // Pointer to solution at most recent time, u(t_n)
-    int tailptr = 0;                // Pointer to solution at last required time, u(t_{n+1-s})
+    int headptr = m_s_multi - 1;    // Pointer to f at most recent time, f(t_n)
+    int tailptr = 0;                // Pointer to f at last required time, f(t_{n+1-s})
     
-    // TODO : Should rename m_x to m_u...
-    // Shallow copy starting values into vectors with more meaningful names
-    std::vector<HYPRE_ParVector> u   = m_u_multi;   // Initial solution vector to integrate from
-    std::vector<HYPRE_IJVector>  uij = m_u_multi_ij;
+    HYPRE_ParVector    u   = m_u_multi[headptr]; // Solution at most recent time
+    HYPRE_IJVector     uij = m_u_multi_ij[headptr];
+    HYPRE_ParVector    g   = NULL; // Spatial discretization vector
+    HYPRE_IJVector     gij = NULL;
+    HYPRE_ParCSRMatrix L   = NULL; // Spatial discretization matrix  
+    HYPRE_IJMatrix     Lij = NULL;
     
-    HYPRE_ParVector    g             = NULL; // Spatial discretization vector
-    HYPRE_IJVector     gij           = NULL;
-    HYPRE_ParCSRMatrix L             = NULL; // Spatial discretization matrix  
-    HYPRE_IJMatrix     Lij           = NULL;
-    HYPRE_ParCSRMatrix BDF_matrix    = NULL; // Matrix to be inverted in linear solve
-    HYPRE_IJMatrix     BDF_matrixij  = NULL;
-
     // Place-holder vectors
     std::vector<HYPRE_ParVector> vectors;
     std::vector<HYPRE_IJVector>  vectorsij;
-    int numVectors = 1; // We only need a single temporary vector (to store RHS of the linear system)
-
+    int numVectors = m_s_multi + 1; // Have s values of f + 1 temporary vector
+    
     // Initialize place-holder vectors
     vectors.resize(numVectors);
     vectorsij.resize(numVectors);
-    InitializeHypreVectors(u[0], uij[0], vectors, vectorsij);
-
+    InitializeHypreVectors(u, uij, vectors, vectorsij);
+    
     // Shallow copy vectors into variables with meaningful names
-    HYPRE_ParVector b   = vectors[0];  // Temporary vector
-    HYPRE_IJVector  bij = vectorsij[0];
-
-    // Mass matrix components
-    int    * M_rowptr;
-    int    * M_colinds;
-    double * M_data;
-    double * M_scaled_data;
-    int    * M_rows;
-    int    * M_cols_per_row;
-    int      ilower;
-    int      iupper;
-    int      onProcSize;
-
+    HYPRE_ParVector              b = vectors[0];  // Temporary vector
+    std::vector<HYPRE_ParVector> f(vectors.begin() + 1, vectors.end()); // Ring buffer of f values
+    std::vector<HYPRE_ParVector> f_ordered(m_s_multi); // f values ordered oldest to most recent
+    std::vector<double>          coeffs(m_s_multi);
+    for (int j = 0; j < m_s_multi; j++) coeffs[j] = m_dt * m_b_multi[j];
+    
+    // If resuming from a checkpoint, m_u_multi holds the s-1 most recent values of f, followed by u
+    bool restarted = (m_step0 > 0);
+    if (restarted) {
+        for (int j = 0; j < m_s_multi-1; j++) HYPRE_ParVectorCopy(m_u_multi[j], f[j]);
+    } else {
+        for (int j = 0; j < m_s_multi; j++) {
+            if (SnapshotDue(j)) WriteSnapshot(m_u_multi[j], j, j * m_dt);
+        }
+    }
+    
     // For monitoring convergence of linear solver
-    int    num_iters   = 0;
-    int    solve_count = 0; // Number of linear solves
-    double rel_res_norm;
-    double avg_iters   = 0;
-    double avg_convergence_rate;
-
-    // Is it necessary to build spatial discretization matrix/BDF matrix more than once?
-    bool rebuildMatrix = m_L_isTimedependent;
-
+    int    solve_count = 0;
+    double avg_iters   = 0.0;
+    
     /* ------------------------------------------------------------ */
     /* ------------------------ Time march ------------------------ */
     /* ------------------------------------------------------------ */
     int step = 0; // Counter for how many time steps we take
-        
+    
     // Advance the solution from its known values at the current time, tInd*m_dt, to new time, (tInd+1)*dt.
     // For a multistep scheme, the solution is initially known at (s-1)*dt (and the s-1 times before it)
     // Solve up to time t == m_nt*dt
-    for (int tInd = m_s_multi-1; tInd < m_nt; tInd++) {
-        /* -------------- Build RHS vector, b, in linear system (M+b_s*dt*L)*u[n+1]=b[n+1] -------------- */
+    for (int tInd = m_s_multi-1+m_step0; tInd < m_nt; tInd++) {
         if (m_solver_parameters.printLevel > 0 && m_spatialRank == 0) {
             std::cout << "\nSolving for time level " << tInd+1 << " of " << m_nt << "\n"; 
             std::cout << "-----------------------------------------\n\n";
         }
         
-        double t = tInd * m_dt; // Current time at which the solution is known
-        
-        // Compute spatial discretization at t + dt
-        // Solution-independent term
-        if (m_G_isTimedependent || step == 0) {
-            GetHypreSpatialDiscretizationG(g, gij, t + m_dt);
-        }
-        // Solution-dependent term
-        if (rebuildMatrix || step == 0) {
-            GetHypreSpatialDiscretizationL(L, Lij, t + m_dt);
-        } 
-        
-        // Assemble intermediate variable w, w == \sum_{j=1}^s a[s-j] * u[n+1-j], this is stored in u[tail]
-        for (int j = m_s_multi-1; j >= 0; j--) { // Start sum from u[n+1-s] since  this is overwritten
-            if (j == m_s_multi-1) {
-                HYPRE_ParVectorScale(m_a_multi[0], u[tailptr]); // u[n+1-s] <- a[0] * u[n+1-s]
-            } else {
-                HYPRE_ParVectorAxpy(m_a_multi[m_s_multi-1 - j], u[(tailptr + m_s_multi-1 - j) % m_s_multi], u[tailptr]); // u[n+1-s] <- u[n+1-s] + a[s-j]*u[n+1-j]
+        // Compute f at the current time, and on the first step, at the times of all other starting values too
+        // (unless they were restored from a checkpoint)
+        int n_first = (step == 0 && !restarted) ? 0 : m_s_multi-1;
+        for (int n = n_first; n < m_s_multi; n++) {
+            int    ind = (tailptr + n) % m_s_multi;    // Index of f in ring buffer
+            double t   = (tInd + 1 - m_s_multi + n) * m_dt;
+            
+            // Compute spatial discretization at t
+            if (m_G_isTimedependent || (step == 0 && n == n_first)) {
+                GetHypreSpatialDiscretizationG(g, gij, t);
             }
-        }
-        
-        // Multiply w by mass matrix and add g. Note for BDF schemes, m_b_multi stores only b_s!
-        if (m_M_exists)  {
-            // Assemble as HYPRE matrix to compute MATVECS  
-            if (step == 0) {
-                int ilower, iupper, jdummy1, jdummy2;
-                HYPRE_IJMatrixGetLocalRange(Lij, &ilower, &iupper, &jdummy1, &jdummy2);
-                SetHypreMassMatrix(ilower, iupper);
+            if (m_L_isTimedependent || (step == 0 && n == n_first)) {
+                GetHypreSpatialDiscretizationL(L, Lij, t);
             }
-            hypre_ParCSRMatrixMatvecOutOfPlace(-1.0, m_M, u[tailptr], m_dt*m_b_multi[0], g, b); // b <- -M*w + dt*b_s*g
-        // Add g to w
-        } else {
-            HYPRE_ParVectorCopy(u[tailptr], b); // b <- u[tail]
-            HYPRE_ParVectorScale(-1.0, b); // b <- -b
-            HYPRE_ParVectorAxpy(m_dt*m_b_multi[0], g, b); // b <- b + dt*b_s*g
+            
+            // Starting values are in m_u_multi, and thereafter u is the current solution
+            HYPRE_ParVector un = (step == 0) ? m_u_multi[n] : u;
+            hypre_ParCSRMatrixMatvecOutOfPlace(-1.0, L, un, 1.0, g, f[ind]); // f <- -L*u + g 
+            
+            /* --- Invert mass matrix: Find f such that M*f = -L*u + g --- */
+            if (m_M_exists) {
+                // Assemble mass matrix on first evaluation
+                if (step == 0 && n == n_first) {
+                    // Get rows this process owns of M assuming rows of M and L are partitioned the same in memory
+                    int ilower, iupper, jdummy1, jdummy2;
+                    HYPRE_IJMatrixGetLocalRange(Lij, &ilower, &iupper, &jdummy1, &jdummy2);
+                    // Store inverse of M if it's lumped since we only need mass matrix for purposes of inverting it
+                    // (it may already exist from integrating the starting values of a multistep scheme)
+                    if (!m_solver_parameters.lump_mass) {
+                        if (!m_Mij) SetHypreMassMatrix(ilower, iupper);
+                    } else {
+                        if (!m_invMij) SetHypreInvMassMatrix(ilower, iupper);
+                    }
+                }
+                
+                HYPRE_ParVectorCopy(f[ind], b); // b <- f; RHS of linear system is the value currently stored in f
+                
+                // Point member variables to local variables so mass solver can access them
+                m_x = f[ind]; // RHS of linear system is used as the initial guess at the solution
+                m_b = b;
+                SolveMassSystem(); 
+                m_x = NULL;
+                m_b = NULL;
+                
+                // Ensure desired tolerance was reached if using iterative solver, otherwise quit
+                if (m_iterative) {
+                    solve_count += 1;
+                    avg_iters   += (double) m_num_iters;
+                    if (m_res_norm > m_solver_parameters.tol) {
+                        if (m_spatialRank == 0) std::cout << "=================================\n =========== WARNING ===========\n=================================\n";
+                        if (m_spatialRank == 0) std::cout << "Time step " << step+1 << "/" << m_nt << "\n";
+                        if (m_spatialRank == 0) std::cout << "Tol after " << m_num_iters << " iters (max iterations) = " << m_res_norm << " > desired tol = " << m_solver_parameters.tol << "\n\n";
+                        MPI_Finalize();
+                        exit(1);
+                    }
+                }
+            }
+        }
+        
+        // Starting values other than the most recent are no longer needed
+        if (step == 0) {
+            for (int n = 0; n < m_s_multi-1; n++) {
+                HYPRE_IJVectorDestroy(m_u_multi_ij[n]);
+                m_u_multi_ij[n] = NULL;
+                m_u_multi[n]    = NULL;
+            }
+        }
+        
+        // Update solution, u <- u + dt*\sum_{j=0}^{s-1} b[j] * f[n+1-s+j]
+        for (int j = 0; j < m_s_multi; j++) f_ordered[j] = f[(tailptr + j) % m_s_multi];
+        LinearCombination(1.0, u, coeffs, f_ordered);
+        
+        step += 1;    // Increment step counter
+        
+        // Update tailptr and headptr for next iteration; f at the oldest time is overwritten next
+        headptr = tailptr;
+        tailptr = (tailptr + 1) % m_s_multi;
+        
+        if (SnapshotDue(tInd+1)) WriteSnapshot(u, tInd+1, (tInd+1) * m_dt);
+        
+        // Checkpoint the s-1 values of f still required, oldest to most recent, followed by u
+        if (CheckpointDue(tInd+1)) {
+            for (int j = 0; j < m_s_multi-1; j++) f_ordered[j] = f[(tailptr + j) % m_s_multi];
+            f_ordered[m_s_multi-1] = u;
+            WriteCheckpoint(f_ordered, tInd+1, (tInd+1) * m_dt, m_dt);
+        }
+    }
+    
+    
+    // Print statistics about average iteration counts across whole time interval
+    if (m_M_exists && m_iterative && solve_count > 0) {
+        if ((m_solver_parameters.printLevel > 0) && (m_spatialRank == 0)) {
+            std::cout << "=============================================\n";
+            std::cout << "Summary of linear solves during time stepping\n";
+            std::cout << "---------------------------------------------\n";
+            std::cout << "Number of systems solved = " << solve_count << '\n';
+            std::cout << "Average number of iterations = " << avg_iters/solve_count << '\n';
+        }
+    }
+    
+    /* ---------------------------------------------------------- */
+    /* ------------------------ Clean up ------------------------ */
+    /* ---------------------------------------------------------- */
+    for (size_t i = 0; i < vectors.size(); i++) {
+        HYPRE_IJVectorDestroy(vectorsij[i]);
+    }
+    
+    if (gij) HYPRE_IJVectorDestroy(gij);
+    if (Lij) HYPRE_IJMatrixDestroy(Lij);
+    
+    // Point member variable x to final solution
+    m_x   = u;
+    m_xij = uij;
+    // Set corresponding u_multi element to NULL since x now "owns" this block of memory
+    m_u_multi[m_s_multi-1]    = NULL;
+    m_u_multi_ij[m_s_multi-1] = NULL;
+}
+
+/* Sequential time-stepping routine for arbitrary Adams--Moulton schemes */
+void SpaceTimeMatrix::AMTimeSteppingSolve() 
+{
+}
+
+/* Sequential time-stepping routine for arbitrary BDF schemes 
+
+    After this function has executed, the solution at the final time is stored in 
+        m_x, which is just a pointer to the head of the list m_u_multi
+
+NOTE:
+    -m_u_multi must contain the s starting values required to initiate s-step BDF; 
+    that is, m_u_multi==[u(t_0),...,u(t_{s-1})], s>=1.
+*/
+void SpaceTimeMatrix::BDFTimeSteppingSolve() 
+{
+    /* ---------------------------------------------------------------------- */
+    /* ------------------------ Setup/initialization ------------------------ */
+    /* ---------------------------------------------------------------------- */
+    
+    // Check that solution vector has been initialized!
+    if (m_u_multi_ij.empty()) {
+        std::cout << "WARNING: Global solution vector must be allocated before beginning BDF time stepping" << '\n';
+        MPI_Finalize();
+        exit(1);
+    }
+    
+    int headptr = m_s_multi - 1;    // Pointer to solution at most recent time, u(t_n)
+    int tailptr = 0;                // Pointer to solution at last required time, u(t_{n+1-s})
+    
+    // TODO : Should rename m_x to m_u...
+    // Shallow copy starting values into vectors with more meaningful names
+    std::vector<HYPRE_ParVector> u   = m_u_multi;   // Initial solution vector to integrate from
+    std::vector<HYPRE_IJVector>  uij = m_u_multi_ij;
+    
+    HYPRE_ParVector    g             = NULL; // Spatial discretization vector
+    HYPRE_IJVector     gij           = NULL;
+    HYPRE_ParCSRMatrix L             = NULL; // Spatial discretization matrix  
+    HYPRE_IJMatrix     Lij           = NULL;
+    HYPRE_ParCSRMatrix BDF_matrix    = NULL; // Matrix to be inverted in linear solve
+    HYPRE_IJMatrix     BDF_matrixij  = NULL;
+
+    // Place-holder vectors
+    std::vector<HYPRE_ParVector> vectors;
+    std::vector<HYPRE_IJVector>  vectorsij;
+    int numVectors = 1; // We only need a single temporary vector (to store RHS of the linear system)
+
+    // Initialize place-holder vectors
+    vectors.resize(numVectors);
+    vectorsij.resize(numVectors);
+    InitializeHypreVectors(u[0], uij[0], vectors, vectorsij);
+
+    // Shallow copy vectors into variables with meaningful names
+    HYPRE_ParVector b   = vectors[0];  // Temporary vector
+    HYPRE_IJVector  bij = vectorsij[0];
+
+    // Mass matrix components
+    int    * M_rowptr;
+    int    * M_colinds;
+    double * M_data;
+    double * M_scaled_data;
+    int      ilower;
+    int      iupper;
+    int      onProcSize;
+
+    // For monitoring convergence of linear solver
+    int    num_iters   = 0;
+    int    solve_count = 0; // Number of linear solves
+    double rel_res_norm;
+    double avg_iters   = 0;
+    int    rebuild_count = 0;   // Number of times solver is (re)built
+    double setup_time    = 0.0; // Total wall time of solver setups
+    double solve_time    = 0.0; // Total wall time of solves
+    double avg_convergence_rate;
+
+    // Is it necessary to build spatial discretization matrix/BDF matrix more than once?
+    bool rebuildMatrix = m_L_isTimedependent;
+    
+    // Coefficients and vectors of linear combinations
+    std::vector<double>          coeffs(m_s_multi-1);
+    std::vector<HYPRE_ParVector> terms(m_s_multi-1);
+    
+    // Ring buffer of previous solutions from which initial guesses are extrapolated. 
+    // Initial guess option k > 0 uses the k most recent solutions; prime with the starting values
+    int              initial_guess = m_solver_parameters.initial_guess;
+    const char     * guess_names[] = {"RHS", "previous step", "linear extrapolation", "quadratic extrapolation"};
+    Solution_history u_history;
+    if (initial_guess > 0) {
+        InitializeSolutionHistory(u[0], uij[0], initial_guess, u_history);
+        for (int j = 0; j < m_s_multi; j++) {
+            PushSolutionHistory(u[(tailptr + j) % m_s_multi], u_history); // Oldest to most recent
+        }
+    }
+    m_step_iters.clear();
+    
+    // Snapshots of starting values 
+    if (m_step0 == 0) {
+        for (int j = 0; j < m_s_multi; j++) {
+            if (SnapshotDue(j)) WriteSnapshot(u[j], j, j * m_dt);
+        }
+    }
+
+    /* ------------------------------------------------------------ */
+    /* ------------------------ Time march ------------------------ */
+    /* ------------------------------------------------------------ */
+    int step = 0; // Counter for how many time steps we take
+        
+    // Advance the solution from its known values at the current time, tInd*m_dt, to new time, (tInd+1)*dt.
+    // For a multistep scheme, the solution is initially known at (s-1)*dt (and the s-1 times before it)
+    // Solve up to time t == m_nt*dt
+    for (int tInd = m_s_multi-1+m_step0; tInd < m_nt; tInd++) {
+        /* -------------- Build RHS vector, b, in linear system (M+b_s*dt*L)*u[n+1]=b[n+1] -------------- */
+        if (m_solver_parameters.printLevel > 0 && m_spatialRank == 0) {
+            std::cout << "\nSolving for time level " << tInd+1 << " of " << m_nt << "\n"; 
+            std::cout << "-----------------------------------------\n\n";
+        }
+        
+        double t = tInd * m_dt; // Current time at which the solution is known
+        
+        // Compute spatial discretization at t + dt
+        // Solution-independent term
+        if (m_G_isTimedependent || step == 0) {
+            GetHypreSpatialDiscretizationG(g, gij, t + m_dt);
+        }
+        // Solution-dependent term
+        if (rebuildMatrix || step == 0) {
+            GetHypreSpatialDiscretizationL(L, Lij, t + m_dt);
+        } 
+        
+        // Assemble intermediate variable w, w == \sum_{j=1}^s a[s-j] * u[n+1-j], this is stored in u[tail]
+        // u[n+1-s] <- a[0] * u[n+1-s] + \sum_{j=1}^{s-1} a[s-j]*u[n+1-j]
+        for (int j = 1; j < m_s_multi; j++) {
+            coeffs[j-1] = m_a_multi[j];
+            terms[j-1]  = u[(tailptr + j) % m_s_multi];
+        }
+        LinearCombination(m_a_multi[0], u[tailptr], coeffs, terms);
+        
+        // Multiply w by mass matrix and add g. Note for BDF schemes, m_b_multi stores only b_s!
+        if (m_M_exists)  {
+            // Assemble as HYPRE matrix to compute MATVECS  
+            if (step == 0) {
+                int ilower, iupper, jdummy1, jdummy2;
+                HYPRE_IJMatrixGetLocalRange(Lij, &ilower, &iupper, &jdummy1, &jdummy2);
+                SetHypreMassMatrix(ilower, iupper);
+            }
+            hypre_ParCSRMatrixMatvecOutOfPlace(-1.0, m_M, u[tailptr], m_dt*m_b_multi[0], g, b); // b <- -M*w + dt*b_s*g
+        // Add g to w
+        } else {
+            LinearCombination(0.0, b, {-1.0, m_dt*m_b_multi[0]}, {u[tailptr], g}); // b <- -u[tail] + dt*b_s*g
         }
         
-        // Set inital guess at solution to be the RHS of the system
-        HYPRE_ParVectorCopy(b, u[tailptr]); 
+        // Set inital guess at solution by extrapolating previous solutions, or else to be the RHS of the system
+        if (initial_guess == 0 || !ExtrapolateSolutionHistory(u_history, u[tailptr])) {
+            HYPRE_ParVectorCopy(b, u[tailptr]); 
+        }
         
         
         /* -------------- Solve linear system, (M+b_s*dt*L)*u[n+1]=b -------------- */
@@ -1058,12 +2257,6 @@ void SpaceTimeMatrix::BDFTimeSteppingSolve()
             
             getMassMatrix(M_rowptr, M_colinds, M_data);
             onProcSize     = iupper - ilower + 1;
-            M_rows         = new int[onProcSize];
-            M_cols_per_row = new int[onProcSize];
-            for (int rowIdx = 0; rowIdx < onProcSize; rowIdx++) {
-                M_rows[rowIdx]         = ilower + rowIdx;
-                M_cols_per_row[rowIdx] = M_rowptr[rowIdx+1] - M_rowptr[rowIdx];
-            }
             M_scaled_data = new double[M_rowptr[onProcSize]]; // Temporary vector to use below...
         }
         
@@ -1084,18 +2277,24 @@ void SpaceTimeMatrix::BDFTimeSteppingSolve()
             // Build BDF matrix on first iteration only
             if (step == 0) { 
                 GetHypreSpatialDiscretizationL(BDF_matrix, BDF_matrixij, t + m_dt);
-                HYPRE_IJMatrixAddToValues(BDF_matrixij, onProcSize, M_cols_per_row, M_rows, M_colinds, M_scaled_data);            
+                AddHypreMatrixValuesFromCRSData(BDF_matrix, M_rowptr, M_colinds, M_scaled_data, ilower, iupper);
                 m_rebuildSolver = true; // Ensure solver rebuilt on first iteration (may not be depending on how initial values were obtained)
+                ClearBinvScaling();
             }
         // Reuse/update L since it's rebuilt at next iteration, BDF_matrix <- L <- M + b_s*dt*L    
         } else {
-            HYPRE_IJMatrixAddToValues(Lij, onProcSize, M_cols_per_row, M_rows, M_colinds, M_scaled_data);            
+            AddHypreMatrixValuesFromCRSData(L, M_rowptr, M_colinds, M_scaled_data, ilower, iupper);
             BDF_matrix   = L;
             BDF_matrixij = Lij;
+            ClearBinvScaling(); // Values of matrix have changed
             
             // BDF matrix has changed, check if AMG solver is due to be rebuild
             // (m_rebuildSolver is reset to false when the solver (re)built)
-            if (m_solver_parameters.rebuildRate == 0 || (m_solver_parameters.rebuildRate > 0 && (step % m_solver_parameters.rebuildRate) == 0)) m_rebuildSolver = true; 
+            if (m_solver_parameters.rebuildTol > 0.0) {
+                if (m_rebuild_due) m_rebuildSolver = true;
+            } else if (m_solver_parameters.rebuildRate == 0 || (m_solver_parameters.rebuildRate > 0 && (step % m_solver_parameters.rebuildRate) == 0)) {
+                m_rebuildSolver = true; 
+            }
         }
         
         // Point member variables to local variables so appropiate linear solver can access them
@@ -1112,8 +2311,14 @@ void SpaceTimeMatrix::BDFTimeSteppingSolve()
         m_A = NULL;
         m_x = NULL;
         m_b = NULL;
-        solve_count += 1;
-        avg_iters   += (double) m_num_iters;
+        solve_count   += 1;
+        avg_iters     += (double) m_num_iters;
+        rebuild_count += (int) m_solverRebuilt;
+        setup_time    += m_setup_time;
+        solve_time    += m_solve_time;
+        m_step_iters.push_back(m_num_iters);
+        UpdateAdaptiveRebuild();
+        if (initial_guess > 0) PushSolutionHistory(u[tailptr], u_history);
         // avg_convergence_rate += ...; // TODO : Not sure how to do
         
         // Ensure desired tolerance was reached in allowable number of iterations, otherwise quit
@@ -1130,6 +2335,15 @@ void SpaceTimeMatrix::BDFTimeSteppingSolve()
         // Update tailptr and headptr for next iteration
         headptr = tailptr;
         tailptr = (tailptr + 1) % m_s_multi;
+        
+        if (SnapshotDue(tInd+1)) WriteSnapshot(u[headptr], tInd+1, (tInd+1) * m_dt);
+        
+        // Checkpoint the s most recent solutions, oldest to most recent
+        if (CheckpointDue(tInd+1)) {
+            std::vector<HYPRE_ParVector> u_ordered(m_s_multi);
+            for (int j = 0; j < m_s_multi; j++) u_ordered[j] = u[(tailptr + j) % m_s_multi];
+            WriteCheckpoint(u_ordered, tInd+1, (tInd+1) * m_dt, m_dt);
+        }
     }
 
 
@@ -1141,6 +2355,14 @@ void SpaceTimeMatrix::BDFTimeSteppingSolve()
         std::cout << "Number of systems solved = " << solve_count << '\n';
         std::cout << "Average number of iterations = " << avg_iters/solve_count << '\n';
         std::cout << "***TODO***: Average convergence factor = ..." << '\n';
+        std::cout << "Number of solver rebuilds = " << rebuild_count << '\n';
+        std::cout << "Solver setup time = " << setup_time << "s, solve time = " << solve_time << "s\n";
+        std::cout << "Initial guess = " << guess_names[initial_guess] << '\n';
+        if (m_solver_parameters.printLevel > 1) {
+            std::cout << "Iterations per solve =";
+            for (size_t j = 0; j < m_step_iters.size(); j++) std::cout << ' ' << m_step_iters[j];
+            std::cout << '\n';
+        }
         //hypre_BoomerAMGGetRelResidualNorm(m_solver, &rel_res_norm);
     }
 
@@ -1150,9 +2372,11 @@ void SpaceTimeMatrix::BDFTimeSteppingSolve()
     for (int i = 0; i < vectors.size(); i++) {
         HYPRE_IJVectorDestroy(vectorsij[i]);
     }
+    DestroySolutionHistory(u_history);
     
     if (Lij) HYPRE_IJMatrixDestroy(Lij);
     if (BDF_matrixij && BDF_matrixij != Lij) HYPRE_IJMatrixDestroy(BDF_matrixij); // BDF_matrix is distinct from L
+    ClearBinvScaling(); // Any scaled matrix was computed from BDF_matrix
 
     // Free all starting values except the one holding the solution at the final time
     for (int i = 0; i < m_u_multi_ij.size(); i++) {
@@ -1273,8 +2497,6 @@ void SpaceTimeMatrix::DIRKTimeSteppingSolve()
     int    * M_colinds;
     double * M_data;
     double * M_scaled_data;
-    int    * M_rows;
-    int    * M_cols_per_row;
     int      ilower;
     int      iupper;
     int      onProcSize;
@@ -1284,22 +2506,72 @@ void SpaceTimeMatrix::DIRKTimeSteppingSolve()
     double rel_res_norm;
     double avg_iters = 0;
     double avg_convergence_rate;
+    int    rebuild_count = 0;   // Number of times solver is (re)built
+    double setup_time    = 0.0; // Total wall time of solver setups
+    double solve_time    = 0.0; // Total wall time of solves
 
 
     // Is it necessary to build spatial discretization matrix/DIRK matrix more than once?
-    bool rebuildMatrix = (m_L_isTimedependent || !m_SDIRK);
+    // If not, a DIRK matrix and its solver are cached for each distinct dt*a_ii
+    bool rebuildMatrix = m_L_isTimedependent;
+    int  systemInd     = -1; // Index of cached DIRK system
+    if (!rebuildMatrix) {
+        // Any existing solver (and scaled matrix) was set up for some other matrix
+        if (m_gmres)  HYPRE_ParCSRGMRESDestroy(m_gmres);
+        if (m_solver) HYPRE_BoomerAMGDestroy(m_solver);
+        m_gmres  = NULL;
+        m_solver = NULL;
+        ClearBinvScaling();
+    }
+    
+    // Ring buffers of each stage at previous steps from which initial guesses are extrapolated.
+    // Initial guess option k > 1 uses the stage at the k most recent accepted steps. Extrapolation 
+    // assumes steps of equal size, so the previous stage is used instead if the step size is adapted
+    int                           initial_guess = m_solver_parameters.initial_guess;
+    const char                  * guess_names[] = {"RHS", "previous stage", "linear extrapolation", "quadratic extrapolation"};
+    if (initial_guess > 1 && AdaptiveTimeStepping()) initial_guess = 1;
+    std::vector<Solution_history> k_history(m_s_butcher);
+    if (initial_guess > 1) {
+        for (int i = 0; i < m_s_butcher; i++) {
+            InitializeSolutionHistory(u, uij, initial_guess, k_history[i]);
+        }
+    }
+    m_step_iters.clear();
+    
+    // Step size control: Either take nt steps of size dt, or, if adaptive, step to the same 
+    // final time with steps chosen to meet the local error tolerance
+    bool   adaptive  = AdaptiveTimeStepping();
+    double t_final   = m_t0 + m_nt * m_dt;
+    double dt        = m_dt;     // Current step size
+    double dt_min    = t_final - m_t0; // Smallest and largest accepted step sizes
+    double dt_max    = 0.0;
+    bool   rejected  = false;    // Was the last step rejected?
+    double M_scaling = 0.0;      // Scaling of mass matrix stored in M_scaled_data 
+    m_accepted_steps = 0;
+    m_rejected_steps = 0;
+    
+    // Resume from most recent checkpoint, if there is one (multistep starting values are never checkpointed)
+    int step0 = 0; // Number of steps taken before time-stepping resumed
+    if (m_restart && !m_multi) ReadCheckpoint({u}, step0, t, dt);
+    int steps_taken = step0; // Number of accepted steps
+    if (!m_multi && step0 == 0 && SnapshotDue(0)) WriteSnapshot(u, 0, t);
+    
+    // Coefficients and vectors of linear combinations
+    std::vector<double>          coeffs;
+    std::vector<HYPRE_ParVector> terms;
 
     /* ------------------------------------------------------------ */
     /* ------------------------ Time march ------------------------ */
     /* ------------------------------------------------------------ */
-    // Take nt steps
+    // Take nt steps (or, if adaptive, as many steps as needed, counting rejected steps)
     int solve_count = 0; // Number of linear solves
     int step = 0;
-    for (step = 0; step < m_nt; step++) {
+    for (step = 0; adaptive ? (t_final - t > 1e-12 * m_dt) : (step < m_nt - step0); step++) {
+        if (adaptive && t + dt > t_final) dt = t_final - t; // Don't step past final time
         /* -------------- Build RHS vector, b2, in linear system (M+a_ii*dt*L)*k[i]=b2 -------------- */
         for (int i = 0; i < m_s_butcher; i++) {
             if ((m_solver_parameters.printLevel > 0) && (m_spatialRank == 0)) {
-                std::cout << "Time step " << step+1 << "/" << m_nt << ": Solving for stage " << i+1 << "/" << m_s_butcher << '\n';
+                std::cout << "Time step " << step0+step+1 << "/" << m_nt << ": Solving for stage " << i+1 << "/" << m_s_butcher << '\n';
                 std::cout << "-----------------------------------------\n\n";
             }
             
@@ -1307,25 +2579,31 @@ void SpaceTimeMatrix::DIRKTimeSteppingSolve()
             // Solution-independent term
             if (m_G_isTimedependent || (i == 0 && step == 0)) {
                 //HYPRE_IJVectorDestroy(gij);
-                GetHypreSpatialDiscretizationG(g, gij, t + m_dt * m_c_butcher[i]);
+                GetHypreSpatialDiscretizationG(g, gij, t + dt * m_c_butcher[i]);
             }
             // Solution-dependent term
             if (rebuildMatrix || (i == 0 && step == 0)) {
                 //HYPRE_IJMatrixDestroy(Lij);
-                GetHypreSpatialDiscretizationL(L, Lij, t + m_dt * m_c_butcher[i]);
+                GetHypreSpatialDiscretizationL(L, Lij, t + dt * m_c_butcher[i]);
             } 
             
             // Assemble RHS of linear system in b2
-            HYPRE_ParVectorCopy(u, b1); // b1 <- u
+            coeffs.assign(1, 1.0);
+            terms.assign(1, u);
             for (int j = 0; j < i; j++) {
-                double temp = m_dt * m_A_butcher[i][j];
-                if (temp != 0.0) HYPRE_ParVectorAxpy(temp, k[j], b1); // b1 <- b1 + dt*aij*k[j]
+                coeffs.push_back(dt * m_A_butcher[i][j]);
+                terms.push_back(k[j]);
             }
+            LinearCombination(0.0, b1, coeffs, terms); // b1 <- u + dt*\sum_{j<i} aij*k[j]
             hypre_ParCSRMatrixMatvecOutOfPlace(-1.0, L, b1, 1.0, g, b2); // b2 <- -L*b1 + g 
             
             
             // Set inital guess at ith stage
-            HYPRE_ParVectorCopy(b2, k[i]); // Stage is RHS of linear system
+            if (initial_guess == 1 && (i > 0 || step > 0)) {
+                HYPRE_ParVectorCopy(k[(i - 1 + m_s_butcher) % m_s_butcher], k[i]); // Stage is previous stage 
+            } else if (initial_guess < 2 || !ExtrapolateSolutionHistory(k_history[i], k[i])) { // Stage is extrapolated from ith stage at previous steps
+                HYPRE_ParVectorCopy(b2, k[i]); // Stage is RHS of linear system
+            }
             
             //HYPRE_ParVectorCopy(u, k[i]); // Stage is u at start of current interval
             
@@ -1347,12 +2625,6 @@ void SpaceTimeMatrix::DIRKTimeSteppingSolve()
                 if (!m_M_exists) setIdentityMassLocalRange(ilower, iupper);
                 getMassMatrix(M_rowptr, M_colinds, M_data);
                 onProcSize     = iupper - ilower + 1;
-                M_rows         = new int[onProcSize];
-                M_cols_per_row = new int[onProcSize];
-                for (int rowIdx = 0; rowIdx < onProcSize; rowIdx++) {
-                    M_rows[rowIdx]         = ilower + rowIdx;
-                    M_cols_per_row[rowIdx] = M_rowptr[rowIdx+1] - M_rowptr[rowIdx];
-                }
                 M_scaled_data = new double[M_rowptr[onProcSize]]; // Temporary vector to use below...
             }
             
@@ -1364,33 +2636,43 @@ void SpaceTimeMatrix::DIRKTimeSteppingSolve()
             }
             
             // Scale RHS vector by 1/dt*a_ii for the moment 
-            double temp = 1.0/(m_dt * m_A_butcher[i][i]); 
+            double temp = 1.0/(dt * m_A_butcher[i][i]); 
             HYPRE_ParVectorScale(temp, b2); // b2 <- b2/(dt*a_ii)
             
-            // Rescale mass matrix data by 1/dt*a_ii; only need to do this once if using SDIRK 
-            if (!m_SDIRK || ((step == 0) && (i == 0))) {
+            // Rescale mass matrix data by 1/dt*a_ii; only need to do this when a_ii (or dt) changes
+            if (M_scaling != temp) {
                 for (int dataInd = 0; dataInd < M_rowptr[onProcSize]; dataInd++) {
                     M_scaled_data[dataInd] = temp * M_data[dataInd]; // M <- M / (dt*a_ii)
                 }
+                M_scaling = temp;
             }
             
             // Get DIRK matrix, DIRK_matrix <- M + a_ii*dt*L
-            // Build DIRK matrix once only if L time independent, and using SDIRK
+            // If L time independent, build DIRK matrix and its solver once only for each dt*a_ii
             if (!rebuildMatrix) {
-                // Build DIRK matrix on first iteration only
-                if ((step == 0) && (i == 0)) { 
-                    GetHypreSpatialDiscretizationL(DIRK_matrix, DIRK_matrixij, t);
-                    HYPRE_IJMatrixAddToValues(DIRK_matrixij, onProcSize, M_cols_per_row, M_rows, M_colinds, M_scaled_data);            
-                }
+                systemInd   = GetCachedDIRKSystem(temp, t, ilower, iupper, M_rowptr, M_colinds, M_scaled_data);
+                DIRK_matrix = m_DIRK_cache[systemInd].A;
+                
+                // Solve with the solver set up for this matrix (it's set up now if there isn't one)
+                m_solver        = m_DIRK_cache[systemInd].amg;
+                m_gmres         = m_DIRK_cache[systemInd].gmres;
+                m_A_s           = m_DIRK_cache[systemInd].A_s;
+                m_binv_A        = m_A_s ? DIRK_matrix : NULL;
+                m_rebuildSolver = false;
             // Reuse/update L since it's rebuilt at next iteration, DIRK_matrix <- L <- M + a_ii*dt*L    
             } else {
-                HYPRE_IJMatrixAddToValues(Lij, onProcSize, M_cols_per_row, M_rows, M_colinds, M_scaled_data);            
+                AddHypreMatrixValuesFromCRSData(L, M_rowptr, M_colinds, M_scaled_data, ilower, iupper);
                 DIRK_matrix   = L;
                 DIRK_matrixij = Lij;
+                ClearBinvScaling(); // Values of matrix have changed
                 
                 // DIRK matrix has changed, check if AMG solver is due to be rebuild
                 // (m_rebuildSolver is reset to false when the solver (re)built)
-                if (m_solver_parameters.rebuildRate == 0 || (m_solver_parameters.rebuildRate > 0 && i == 0 && (step % m_solver_parameters.rebuildRate) == 0)) m_rebuildSolver = true; 
+                if (m_solver_parameters.rebuildTol > 0.0) {
+                    if (m_rebuild_due) m_rebuildSolver = true;
+                } else if (m_solver_parameters.rebuildRate == 0 || (m_solver_parameters.rebuildRate > 0 && i == 0 && (step % m_solver_parameters.rebuildRate) == 0)) {
+                    m_rebuildSolver = true; 
+                }
             }
             
             // Point member variables to local variables so appropiate linear solver can access them
@@ -1407,27 +2689,69 @@ void SpaceTimeMatrix::DIRKTimeSteppingSolve()
             m_A = NULL;
             m_x = NULL;
             m_b = NULL;  
-            solve_count += 1;
-            avg_iters   += (double) m_num_iters;
+            if (!rebuildMatrix) StoreCachedDIRKSolver(systemInd);
+            solve_count   += 1;
+            avg_iters     += (double) m_num_iters;
+            rebuild_count += (int) m_solverRebuilt;
+            setup_time    += m_setup_time;
+            solve_time    += m_solve_time;
+            m_step_iters.push_back(m_num_iters);
+            UpdateAdaptiveRebuild();
             // avg_convergence_rate += ...; // TODO : Not sure how to do
             
                 
             // Ensure desired tolerance was reached in allowable number of iterations, otherwise quit
             if (m_res_norm > m_solver_parameters.tol) {
                 if (m_spatialRank == 0) std::cout << "=================================\n =========== WARNING ===========\n=================================\n";
-                if (m_spatialRank == 0) std::cout << "Time step " << step+1 << "/" << m_nt << ": Solving for stage " << i+1 << "/" << m_s_butcher << '\n';
+                if (m_spatialRank == 0) std::cout << "Time step " << step0+step+1 << "/" << m_nt << ": Solving for stage " << i+1 << "/" << m_s_butcher << '\n';
                 if (m_spatialRank == 0) std::cout << "Tol after " << m_num_iters << " iters (max iterations) = " << m_res_norm << " > desired tol = " << m_solver_parameters.tol << "\n\n";
                 MPI_Finalize();
                 exit(1);
             }
         }
 
-        // Sum solution
-        for (int i = 0; i < m_s_butcher; i++)  {
-            double temp = m_dt * m_b_butcher[i];
-            if (temp != 0.0) HYPRE_ParVectorAxpy(temp, k[i], u); // u <- u + dt*k[i]*k[i]; 
+        // Estimate local error as difference of the solution and the embedded solution
+        double dt_factor = 1.0;
+        if (adaptive) {
+            coeffs.resize(m_s_butcher);
+            for (int i = 0; i < m_s_butcher; i++) coeffs[i] = dt * (m_b_butcher[i] - m_bhat_butcher[i]);
+            LinearCombination(0.0, b1, coeffs, k); // b1 <- dt*\sum_i (b_i-bhat_i)*k[i]
+            double err = EmbeddedErrorNorm(b1, u);
+            dt_factor  = StepSizeFactor(err, rejected);
+            
+            // Reject step and retake it from t with a smaller step size, reusing the stage vectors
+            rejected = (err > 1.0);
+            if (rejected) {
+                if ((m_solver_parameters.printLevel > 0) && (m_spatialRank == 0)) {
+                    std::cout << "Step rejected at t = " << t << ": dt = " << dt << ", error = " << err << '\n';
+                }
+                m_rejected_steps += 1;
+                dt *= dt_factor;
+                continue;
+            }
+            m_accepted_steps += 1;
+            dt_min = std::min(dt_min, dt);
+            dt_max = std::max(dt_max, dt);
+            
+            // Keep step size if it would only grow a little, so the DIRK matrix and its solver can be reused
+            if (!rebuildMatrix && dt_factor > 1.0 && dt_factor < 1.5) dt_factor = 1.0;
+        }
+        
+        // Stages of accepted step are extrapolated from at later steps
+        if (initial_guess > 1) {
+            for (int i = 0; i < m_s_butcher; i++) PushSolutionHistory(k[i], k_history[i]);
         }
-        t += m_dt; // Increment time
+        
+        // Sum solution
+        coeffs.resize(m_s_butcher);
+        for (int i = 0; i < m_s_butcher; i++) coeffs[i] = dt * m_b_butcher[i];
+        LinearCombination(1.0, u, coeffs, k); // u <- u + dt*\sum_i b_i*k[i]
+        t  += dt; // Increment time
+        dt *= dt_factor;
+        
+        steps_taken += 1;
+        if (!m_multi && SnapshotDue(steps_taken)) WriteSnapshot(u, steps_taken, t);
+        if (!m_multi && CheckpointDue(steps_taken)) WriteCheckpoint({u}, steps_taken, t, dt);
     }
 
 
@@ -1439,8 +2763,24 @@ void SpaceTimeMatrix::DIRKTimeSteppingSolve()
         std::cout << "Number of systems solved = " << solve_count << '\n';
         std::cout << "Average number of iterations = " << avg_iters/solve_count << '\n';
         std::cout << "***TODO***: Average convergence factor = ..." << '\n';
+        std::cout << "Number of solver rebuilds = " << rebuild_count << '\n';
+        std::cout << "Solver setup time = " << setup_time << "s, solve time = " << solve_time << "s\n";
+        std::cout << "Initial guess = " << guess_names[initial_guess] << '\n';
+        if (adaptive) {
+            std::cout << "---------------------------------------------\n";
+            std::cout << "Adaptive time stepping\n";
+            std::cout << "Accepted steps = " << m_accepted_steps << ", rejected steps = " << m_rejected_steps << " (nt = " << m_nt << " steps of dt = " << m_dt << ")\n";
+            std::cout << "Accepted step sizes in [" << dt_min << ", " << dt_max << "]\n";
+            std::cout << "Total number of iterations = " << avg_iters << '\n';
+        }
+        if (m_solver_parameters.printLevel > 1) {
+            std::cout << "Iterations per solve =";
+            for (size_t j = 0; j < m_step_iters.size(); j++) std::cout << ' ' << m_step_iters[j];
+            std::cout << '\n';
+        }
         //hypre_BoomerAMGGetRelResidualNorm(m_solver, &rel_res_norm);
     }
+    if (!rebuildMatrix && m_solver_parameters.printLevel > 0) ReportDIRKCache();
 
     /* ---------------------------------------------------------- */
     /* ------------------------ Clean up ------------------------ */
@@ -1449,9 +2789,14 @@ void SpaceTimeMatrix::DIRKTimeSteppingSolve()
         HYPRE_IJVectorDestroy(vectorsij[i]);
     }
     
+    for (size_t i = 0; i < k_history.size(); i++) {
+        DestroySolutionHistory(k_history[i]);
+    }
+    
     if (gij) HYPRE_IJVectorDestroy(gij);
     if (Lij) HYPRE_IJMatrixDestroy(Lij);
     if (DIRK_matrixij && DIRK_matrixij != Lij)  HYPRE_IJMatrixDestroy(DIRK_matrixij); // DIRK matrix was distinct from L
+    ClearBinvScaling(); // Any scaled matrix was computed from L
         
         
             
@@ -1504,8 +2849,8 @@ void SpaceTimeMatrix::ERKTimeSteppingSolve()
     HYPRE_IJVector               bij = vectorsij[0];
     std::vector<HYPRE_ParVector> k; // Stage vectors
     std::vector<HYPRE_IJVector>  kij;    
-    k.reserve(m_s_butcher);
-    kij.reserve(m_s_butcher);
+    k.resize(m_s_butcher);
+    kij.resize(m_s_butcher);
     for (int i = 0; i < m_s_butcher; i++) {
         kij[i] = vectorsij[i+1];
         k[i]   = vectors[i+1];
@@ -1516,37 +2861,61 @@ void SpaceTimeMatrix::ERKTimeSteppingSolve()
     double rel_res_norm;
     double avg_iters;
     double avg_convergence_rate;
+    
+    // Step size control: Either take nt steps of size dt, or, if adaptive, step to the same 
+    // final time with steps chosen to meet the local error tolerance
+    bool   adaptive = AdaptiveTimeStepping();
+    double t_final  = m_t0 + m_nt * m_dt;
+    double dt       = m_dt;     // Current step size
+    double dt_min   = t_final - m_t0; // Smallest and largest accepted step sizes
+    double dt_max   = 0.0;
+    bool   rejected = false;    // Was the last step rejected?
+    m_accepted_steps = 0;
+    m_rejected_steps = 0;
+    
+    // Resume from most recent checkpoint, if there is one (multistep starting values are never checkpointed)
+    int step0 = 0; // Number of steps taken before time-stepping resumed
+    if (m_restart && !m_multi) ReadCheckpoint({u}, step0, t, dt);
+    int steps_taken = step0; // Number of accepted steps
+    if (!m_multi && step0 == 0 && SnapshotDue(0)) WriteSnapshot(u, 0, t);
+    
+    // Coefficients and vectors of linear combinations
+    std::vector<double>          coeffs;
+    std::vector<HYPRE_ParVector> terms;
 
     /* ------------------------------------------------------------ */
     /* ------------------------ Time march ------------------------ */
     /* ------------------------------------------------------------ */
-    // Take nt steps
+    // Take nt steps (or, if adaptive, as many steps as needed, counting rejected steps)
     int solve_count = 0;
     int step = 0;
-    for (step = 0; step < m_nt; step++) {
+    for (step = 0; adaptive ? (t_final - t > 1e-12 * m_dt) : (step < m_nt - step0); step++) {
+        if (adaptive && t + dt > t_final) dt = t_final - t; // Don't step past final time
         
         // Build ith stage vector, k[i]
         for (int i = 0; i < m_s_butcher; i++) {
             if ((m_solver_parameters.printLevel > 0) && (m_spatialRank == 0)) {
-                std::cout << "Time step " << step+1 << "/" << m_nt << ": Solving for stage " << i+1 << "/" << m_s_butcher << '\n';
+                std::cout << "Time step " << step0+step+1 << "/" << m_nt << ": Solving for stage " << i+1 << "/" << m_s_butcher << '\n';
                 std::cout << "-----------------------------------------\n\n";
             }
             
             // Compute spatial discretization at t + c[i]*dt
             if (m_G_isTimedependent || (i == 0 && step == 0)) {
-                GetHypreSpatialDiscretizationG(g, gij, t + m_dt * m_c_butcher[i]);
+                GetHypreSpatialDiscretizationG(g, gij, t + dt * m_c_butcher[i]);
             }
 
             // Solution-dependent term
             if (m_L_isTimedependent || (i == 0 && step == 0)) {
-                GetHypreSpatialDiscretizationL(L, Lij, t + m_dt * m_c_butcher[i]);
+                GetHypreSpatialDiscretizationL(L, Lij, t + dt * m_c_butcher[i]);
             } 
 
-            HYPRE_ParVectorCopy(u, b); // b <- u
+            coeffs.assign(1, 1.0);
+            terms.assign(1, u);
             for (int j = 0; j < i; j++) {
-                double temp = m_dt * m_A_butcher[i][j];
-                if (temp !=  0.0) HYPRE_ParVectorAxpy(temp, k[j], b); // b <- b + dt*aij*k[j]
+                coeffs.push_back(dt * m_A_butcher[i][j]);
+                terms.push_back(k[j]);
             }
+            LinearCombination(0.0, b, coeffs, terms); // b <- u + dt*\sum_{j<i} aij*k[j]
 
             // Set final value of stage if no mass matrix, otherwise this makes a good initial guess at solution
             hypre_ParCSRMatrixMatvecOutOfPlace(-1.0, L, b, 1.0, g, k[i]); // k[i] <- -L*b + g 
@@ -1563,10 +2932,11 @@ void SpaceTimeMatrix::ERKTimeSteppingSolve()
                     HYPRE_IJMatrixGetLocalRange(Lij, &ilower, &iupper, &jdummy1, &jdummy2);
                     //setIdentityMassLocalRange(ilower, iupper); // TODO : Hack for testing when I don't have a mass matrix but want to invert whatever is provided by getMassMatrix()
                     // Store inverse of M if it's lumped since we only need mass matrix for purposes of inverting it
+                    // (it may already exist from integrating the starting values of a multistep scheme)
                     if (!m_solver_parameters.lump_mass) {
-                        SetHypreMassMatrix(ilower, iupper);
+                        if (!m_Mij) SetHypreMassMatrix(ilower, iupper);
                     } else {
-                        SetHypreInvMassMatrix(ilower, iupper);
+                        if (!m_invMij) SetHypreInvMassMatrix(ilower, iupper);
                     }
                 }
                 
@@ -1590,7 +2960,7 @@ void SpaceTimeMatrix::ERKTimeSteppingSolve()
                     // Ensure desired tolerance was reached in allowable number of iterations, otherwise quit
                     if (m_res_norm > m_solver_parameters.tol) {
                         if (m_spatialRank == 0) std::cout << "=================================\n =========== WARNING ===========\n=================================\n";
-                        if (m_spatialRank == 0) std::cout << "Time step " << step+1 << "/" << m_nt << ": Solving for stage " << i+1 << "/" << m_s_butcher << '\n';
+                        if (m_spatialRank == 0) std::cout << "Time step " << step0+step+1 << "/" << m_nt << ": Solving for stage " << i+1 << "/" << m_s_butcher << '\n';
                         if (m_spatialRank == 0) std::cout << "Tol after " << m_num_iters << " iters (max iterations) = " << m_res_norm << " > desired tol = " << m_solver_parameters.tol << "\n\n";
                         MPI_Finalize();
                         exit(1);
@@ -1599,12 +2969,40 @@ void SpaceTimeMatrix::ERKTimeSteppingSolve()
             }
         }
 
-        // Sum solution
-        for (int i = 0; i < m_s_butcher; i++) {
-            double temp = m_dt * m_b_butcher[i];
-            if (temp != 0.0) HYPRE_ParVectorAxpy(temp, k[i], u); // u <- u + dt*k[i]*k[i]; 
+        // Estimate local error as difference of the solution and the embedded solution
+        double dt_factor = 1.0;
+        if (adaptive) {
+            coeffs.resize(m_s_butcher);
+            for (int i = 0; i < m_s_butcher; i++) coeffs[i] = dt * (m_b_butcher[i] - m_bhat_butcher[i]);
+            LinearCombination(0.0, b, coeffs, k); // b <- dt*\sum_i (b_i-bhat_i)*k[i]
+            double err = EmbeddedErrorNorm(b, u);
+            dt_factor  = StepSizeFactor(err, rejected);
+            
+            // Reject step and retake it from t with a smaller step size, reusing the stage vectors
+            rejected = (err > 1.0);
+            if (rejected) {
+                if ((m_solver_parameters.printLevel > 0) && (m_spatialRank == 0)) {
+                    std::cout << "Step rejected at t = " << t << ": dt = " << dt << ", error = " << err << '\n';
+                }
+                m_rejected_steps += 1;
+                dt *= dt_factor;
+                continue;
+            }
+            m_accepted_steps += 1;
+            dt_min = std::min(dt_min, dt);
+            dt_max = std::max(dt_max, dt);
         }
-        t += m_dt; // Increment time
+        
+        // Sum solution
+        coeffs.resize(m_s_butcher);
+        for (int i = 0; i < m_s_butcher; i++) coeffs[i] = dt * m_b_butcher[i];
+        LinearCombination(1.0, u, coeffs, k); // u <- u + dt*\sum_i b_i*k[i]
+        t  += dt; // Increment time
+        dt *= dt_factor;
+        
+        steps_taken += 1;
+        if (!m_multi && SnapshotDue(steps_taken)) WriteSnapshot(u, steps_taken, t);
+        if (!m_multi && CheckpointDue(steps_taken)) WriteCheckpoint({u}, steps_taken, t, dt);
     }
 
 
@@ -1620,6 +3018,14 @@ void SpaceTimeMatrix::ERKTimeSteppingSolve()
             //hypre_BoomerAMGGetRelResidualNorm(m_solver, &rel_res_norm);
         }
     }
+    if (adaptive && (m_solver_parameters.printLevel > 0) && (m_spatialRank == 0)) {
+        std::cout << "=============================================\n";
+        std::cout << "Summary of adaptive time stepping\n";
+        std::cout << "---------------------------------------------\n";
+        std::cout << "Accepted steps = " << m_accepted_steps << ", rejected steps = " << m_rejected_steps << " (nt = " << m_nt << " steps of dt = " << m_dt << ")\n";
+        std::cout << "Accepted step sizes in [" << dt_min << ", " << dt_max << "]\n";
+        std::cout << "Stage evaluations = " << (m_accepted_steps + m_rejected_steps) * m_s_butcher << '\n';
+    }
 
 
     /* ---------------------------------------------------------- */
@@ -1639,26 +3045,91 @@ void SpaceTimeMatrix::ERKTimeSteppingSolve()
 }
 
 
-/* Assemble the inverse of a diagonally lumped mass matrix as a HYPRE matrix
+/* Should RK time-stepping choose its step sizes adaptively? This is the case if a local 
+    error tolerance has been set, and the solution is integrated over the whole time interval
+    (i.e., not just to get starting values of a multistep scheme). 
 
-NOTE: 
-    -We know the rows owned by the current process by previously assembling 
-        the spatial discretization whose rows are distributed the same way
-    -If the mass matrix has been lumped to a diagonal this function will 
-        store its inverse 
+NOTES:
+    -Adaptive time-stepping requires an RK scheme with an embedded pair (see GetButcherTableaux)
+    -Integration is from m_t0 to m_t0 + m_nt*m_dt, with m_dt as the initial step size
 */
-void SpaceTimeMatrix::SetHypreInvMassMatrix(int  ilower, 
-                                            int  iupper)
+bool SpaceTimeMatrix::AdaptiveTimeStepping() 
 {
-    // Just check not already set!
-    if (m_invM) {
-        std::cout << "WARNING: The inverse of mass matrix has already been set! Cannot be reset" << '\n';
+    if (m_multi || (m_solver_parameters.dt_rtol <= 0.0 && m_solver_parameters.dt_atol <= 0.0)) return false;
+    
+    if (m_bhat_butcher.empty()) {
+        if (m_globRank == 0) std::cout << "WARNING: Adaptive time-stepping requires an RK scheme with an embedded pair; scheme " << m_timeDisc << " has none!" << '\n';
         MPI_Finalize();
         exit(1);
     }
-    
-    if (!m_solver_parameters.lump_mass) {
-        std::cout << "WARNING: I can only compute the inverse of a diagaonally lumped mass matrix!" << '\n';
+    return true;
+}
+
+
+/* Weighted RMS norm of the local error estimate e of a step taken from solution u, 
+        ||e|| = sqrt( 1/N * sum_j (e_j / (atol + rtol*|u_j|))^2 ),
+    so that the step meets the local error tolerance if ||e|| <= 1 
+*/
+double SpaceTimeMatrix::EmbeddedErrorNorm(HYPRE_ParVector e, HYPRE_ParVector u) 
+{
+    hypre_Vector * e_local = hypre_ParVectorLocalVector((hypre_ParVector *) e);
+    hypre_Vector * u_local = hypre_ParVectorLocalVector((hypre_ParVector *) u);
+    double * e_data = hypre_VectorData(e_local);
+    double * u_data = hypre_VectorData(u_local);
+    int      onProcSize = hypre_VectorSize(e_local);
+    
+    double sums[2] = {0.0, (double) onProcSize}; // Sum of squares and number of entries
+    for (int j = 0; j < onProcSize; j++) {
+        double w = e_data[j] / (m_solver_parameters.dt_atol + m_solver_parameters.dt_rtol * std::abs(u_data[j]));
+        sums[0] += w * w;
+    }
+    MPI_Allreduce(MPI_IN_PLACE, sums, 2, MPI_DOUBLE, MPI_SUM, m_spatialComm);
+    
+    return std::sqrt(sums[0] / sums[1]);
+}
+
+
+/* Factor to multiply the step size by, given the norm of the local error of the last step,
+    err, such that the local error of the next step is (just) within tolerance. 
+    
+NOTES:
+    -The error estimate is of the order of the embedded solution, so it scales as 
+        dt^(p+1), with p == m_bhat_order
+    -Changes of step size are limited to [0.2, 5], and the step is not allowed to grow 
+        if the last step was rejected
+*/
+double SpaceTimeMatrix::StepSizeFactor(double err, bool rejected) 
+{
+    double safety  = 0.9;
+    double min_fac = 0.2;
+    double max_fac = rejected ? 1.0 : 5.0;
+    
+    if (err == 0.0) return max_fac;
+    double factor = safety * std::pow(err, -1.0 / (m_bhat_order + 1));
+    return std::min(max_fac, std::max(min_fac, factor));
+}
+
+
+/* Assemble the inverse of a diagonally lumped mass matrix as a HYPRE matrix
+
+NOTE: 
+    -We know the rows owned by the current process by previously assembling 
+        the spatial discretization whose rows are distributed the same way
+    -If the mass matrix has been lumped to a diagonal this function will 
+        store its inverse 
+*/
+void SpaceTimeMatrix::SetHypreInvMassMatrix(int  ilower, 
+                                            int  iupper)
+{
+    // Just check not already set!
+    if (m_invM) {
+        std::cout << "WARNING: The inverse of mass matrix has already been set! Cannot be reset" << '\n';
+        MPI_Finalize();
+        exit(1);
+    }
+    
+    if (!m_solver_parameters.lump_mass) {
+        std::cout << "WARNING: I can only compute the inverse of a diagaonally lumped mass matrix!" << '\n';
         MPI_Finalize();
         exit(1);
     }
@@ -1669,13 +3140,16 @@ void SpaceTimeMatrix::SetHypreInvMassMatrix(int  ilower,
     int *    M_rows;
     int *    M_cols_per_row;
     double * M_data;
+    double * invM_data;
     
     // Get mass matrix components and assemble as the HYPRE matrix M
     getMassMatrix(M_rowptr, M_colinds, M_data);
     
     onProcSize = iupper - ilower + 1; // Number of rows on process
     
-    int nnzM = M_rowptr[onProcSize] - M_rowptr[0]; // nnz(M) on process
+    // Reciprocals are stored separately, since M_data belongs to the spatial discretization
+    int nnzM  = M_rowptr[onProcSize] - M_rowptr[0]; // nnz(M) on process
+    invM_data = new double[nnzM];
     for (int i = 0; i < nnzM; i++) {
         // TODO : Is this a silly check? Is it impossible that M could become singular after lumping?
         if (std::abs(M_data[i]) < 1e-14) {
@@ -1683,7 +3157,7 @@ void SpaceTimeMatrix::SetHypreInvMassMatrix(int  ilower,
             MPI_Finalize();
             exit(1);
         }
-        M_data[i] = 1/M_data[i];
+        invM_data[i] = 1/M_data[i];
     }
     
     // Initialize matrix
@@ -1698,17 +3172,16 @@ void SpaceTimeMatrix::SetHypreInvMassMatrix(int  ilower,
         M_rows[i] = ilower + i;
         M_cols_per_row[i] = M_rowptr[i+1] - M_rowptr[i];
     }
-    HYPRE_IJMatrixSetValues(m_Mij, onProcSize, M_cols_per_row, M_rows, M_colinds, M_data);
+    HYPRE_IJMatrixSetValues(m_invMij, onProcSize, M_cols_per_row, M_rows, M_colinds, invM_data);
     
     // Finalize construction
     HYPRE_IJMatrixAssemble(m_invMij);
     HYPRE_IJMatrixGetObject(m_invMij, (void **) &m_invM);
     
-    delete[] M_rowptr;
-    delete[] M_colinds;
     delete[] M_rows;
     delete[] M_cols_per_row;
-    delete[] M_data;
+    delete[] invM_data;
+    // NOTE: Mass matrix arrays are owned by the spatial discretization and must not be deleted here
 }
 
 
@@ -1759,11 +3232,9 @@ void SpaceTimeMatrix::SetHypreMassMatrix(int  ilower,
     HYPRE_IJMatrixAssemble(m_Mij);
     HYPRE_IJMatrixGetObject(m_Mij, (void **) &m_M);
     
-    delete[] M_rowptr;
-    delete[] M_colinds;
     delete[] M_rows;
     delete[] M_cols_per_row;
-    delete[] M_data;
+    // NOTE: Mass matrix arrays are owned by the spatial discretization and must not be deleted here
 }
 
 
@@ -1856,22 +3327,173 @@ void SpaceTimeMatrix::InitializeHypreVectors(HYPRE_ParVector              &u,
 }
 
 
-/* Get solution-independent component of spatial discretization, the vector g, as a HYPRE vector */
+/* Allocate a ring buffer to hold the depth most recent solutions of a linear system; its 
+    vectors are initialized with the values (and partitioning) of u, but it holds no solutions 
+*/
+void SpaceTimeMatrix::InitializeSolutionHistory(HYPRE_ParVector  &u, 
+                                                HYPRE_IJVector   &uij, 
+                                                int               depth, 
+                                                Solution_history &history) 
+{
+    history.x.resize(depth);
+    history.xij.resize(depth);
+    InitializeHypreVectors(u, uij, history.x, history.xij);
+    history.head  = depth - 1;
+    history.count = 0;
+}
+
+
+/* Store x as the most recent solution in history, overwriting the oldest one if full */
+void SpaceTimeMatrix::PushSolutionHistory(HYPRE_ParVector x, Solution_history &history) 
+{
+    if (history.x.empty()) return;
+    history.head = (history.head + 1) % history.x.size();
+    HYPRE_ParVectorCopy(x, history.x[history.head]);
+    if (history.count < (int) history.x.size()) history.count += 1;
+}
+
+
+/* Extrapolate the solutions in history to the next step, storing the result in x. 
+
+NOTES:
+    -Solutions are assumed to be equispaced in time. The polynomial interpolating the 
+        stored solutions is evaluated one step ahead, so that for 1, 2, or 3 stored solutions,
+            x <- x_n,  x <- 2*x_n - x_{n-1},  x <- 3*x_n - 3*x_{n-1} + x_{n-2}.
+    -Returns false, leaving x unchanged, if history holds no solutions.
+*/
+bool SpaceTimeMatrix::ExtrapolateSolutionHistory(const Solution_history &history, HYPRE_ParVector x) 
+{
+    static const double coefficients[3][3] = {{1.0,  0.0, 0.0},
+                                              {2.0, -1.0, 0.0},
+                                              {3.0, -3.0, 1.0}};
+    if (history.count == 0) return false;
+    
+    int order = std::min(history.count, 3) - 1; 
+    int depth = history.x.size();
+    std::vector<double>          coeffs(order+1);
+    std::vector<HYPRE_ParVector> terms(order+1);
+    for (int j = 0; j <= order; j++) {
+        coeffs[j] = coefficients[order][j];
+        terms[j]  = history.x[(history.head - j + depth) % depth];
+    }
+    LinearCombination(0.0, x, coeffs, terms); // x <- \sum_j c_j*x_{n-j}
+    return true;
+}
+
+
+/* Free vectors in ring buffer of solutions */
+void SpaceTimeMatrix::DestroySolutionHistory(Solution_history &history) 
+{
+    for (size_t i = 0; i < history.xij.size(); i++) {
+        if (history.xij[i]) HYPRE_IJVectorDestroy(history.xij[i]);
+    }
+    history.x.clear();
+    history.xij.clear();
+    history.count = 0;
+}
+
+
+/* Fused linear combination of vectors, y <- alpha0*y + sum_j alpha[j]*x[j], 
+    which streams over the local data of every vector only once
+
+NOTES:
+    -Terms with a zero coefficient are skipped (and if alpha0 == 0, y is only written)
+    -Terms are applied in groups of up to four per (SIMD-vectorized) pass over y, so that
+        y is only read and written more than once if there are more than four terms.
+        A group with fewer than four terms is padded with copies of one of its vectors 
+        with zero coefficient; these are read from cache rather than memory. 
+    -All vectors must be partitioned the same way
+*/
+void SpaceTimeMatrix::LinearCombination(double                              alpha0, 
+                                        HYPRE_ParVector                     y, 
+                                        const std::vector<double>          &alpha, 
+                                        const std::vector<HYPRE_ParVector> &x) 
+{
+    double * y_data     = hypre_VectorData(hypre_ParVectorLocalVector((hypre_ParVector *) y));
+    int      onProcSize = hypre_VectorSize(hypre_ParVectorLocalVector((hypre_ParVector *) y));
+    
+    // Gather terms with nonzero coefficients
+    int       nterms  = 0;
+    double  * coeffs  = new double[alpha.size()];
+    double ** x_data  = new double*[alpha.size()];
+    for (size_t j = 0; j < alpha.size(); j++) {
+        if (alpha[j] != 0.0) {
+            coeffs[nterms] = alpha[j];
+            x_data[nterms] = hypre_VectorData(hypre_ParVectorLocalVector((hypre_ParVector *) x[j]));
+            nterms += 1;
+        }
+    }
+    
+    // No terms: Just scale y
+    if (nterms == 0) {
+        if (alpha0 != 1.0) {
+            #pragma omp simd
+            for (int i = 0; i < onProcSize; i++) {
+                y_data[i] = (alpha0 == 0.0) ? 0.0 : alpha0 * y_data[i];
+            }
+        }
+    }
+    
+    // Apply terms in groups of four
+    for (int group = 0; group < nterms; group += 4) {
+        double         c[4];
+        const double * x0;
+        const double * x1;
+        const double * x2;
+        const double * x3;
+        for (int j = 0; j < 4; j++) {
+            c[j] = (group + j < nterms) ? coeffs[group + j] : 0.0;
+        }
+        x0 = x_data[group];
+        x1 = (group + 1 < nterms) ? x_data[group + 1] : x0;
+        x2 = (group + 2 < nterms) ? x_data[group + 2] : x0;
+        x3 = (group + 3 < nterms) ? x_data[group + 3] : x0;
+        
+        // y is only written in the first pass if alpha0 == 0
+        if (group == 0 && alpha0 == 0.0) {
+            #pragma omp simd
+            for (int i = 0; i < onProcSize; i++) {
+                y_data[i] = c[0]*x0[i] + c[1]*x1[i] + c[2]*x2[i] + c[3]*x3[i];
+            }
+        } else {
+            double a = (group == 0) ? alpha0 : 1.0;
+            #pragma omp simd
+            for (int i = 0; i < onProcSize; i++) {
+                y_data[i] = a*y_data[i] + c[0]*x0[i] + c[1]*x1[i] + c[2]*x2[i] + c[3]*x3[i];
+            }
+        }
+    }
+    
+    delete[] coeffs;
+    delete[] x_data;
+}
+
+
+/* Get solution-independent component of spatial discretization, the vector g, as a HYPRE vector 
+
+NOTES:
+    -If the spatial discretization lends G, g wraps its storage directly: The local data 
+        of g is replaced by G, which g does not own, so it is not freed with gij. 
+        Otherwise G is copied into g and then deleted, since hypre frees its 
+        data with its own allocator.
+    -g must therefore not be modified.
+    -If gij already exists, g is kept and only its local values are replaced, since the 
+        partitioning of the spatial discretization never changes.
+*/
 void SpaceTimeMatrix::GetHypreSpatialDiscretizationG(HYPRE_ParVector &g,
                                                      HYPRE_IJVector  &gij,
                                                      double           t)  
 {
-    // Free vector if currently allocated memory
-    if (gij) HYPRE_IJVectorDestroy(gij);
-    
-    int      spatialDOFs;
-    int      ilower;
-    int      iupper;
-    int      onProcSize;
-    int    * G_rows;
-    double * G;
+    int           spatialDOFs;
+    int           ilower;
+    int           iupper;
+    int           onProcSize;
+    Vector_buffer G = {};
 
     // No parallelism: Spatial discretization on single processor
+    // G is released below, so its storage may come from the buffer pool
+    m_pool_active = true;
+    double discStart = MPI_Wtime();
     if (!m_useSpatialParallel) {
         getSpatialDiscretizationG(G, spatialDOFs, t);
         ilower = 0; 
@@ -1880,91 +3502,144 @@ void SpaceTimeMatrix::GetHypreSpatialDiscretizationG(HYPRE_ParVector &g,
     } else {
         getSpatialDiscretizationG(m_spatialComm, G, ilower, iupper, spatialDOFs, t);
     }
-
-    // Get global row indices
+    m_phase_time[TIMER_SPATIAL_DISC] += MPI_Wtime() - discStart;
     onProcSize = iupper - ilower + 1; // Number of rows of spatial disc I own
-    G_rows = new int[onProcSize];
-    for (int i = 0; i < onProcSize; i++) {
-        G_rows[i] = ilower + i;
+    
+    // Vector exists: Overwrite its local data in place
+    if (gij) {
+        hypre_Vector * g_local = hypre_ParVectorLocalVector(g);
+        if (hypre_ParVectorFirstIndex(g) != ilower || hypre_VectorSize(g_local) != onProcSize) {
+            std::cout << "WARNING: Partitioning of spatial discretization G has changed on process " 
+                        << m_globRank << ".\n";
+            MPI_Finalize();
+            exit(1);
+        }
+        
+        // Borrowed G: Swap it in for the local data of g
+        if (!G.owned) {
+            if (hypre_VectorOwnsData(g_local)) hypre_TFree(hypre_VectorData(g_local), HYPRE_MEMORY_HOST);
+            hypre_VectorData(g_local)      = G.data;
+            hypre_VectorOwnsData(g_local)  = 0;
+        
+        // Owned G: Copy it into g (which needs its own storage if it was borrowing it)
+        } else {
+            if (!hypre_VectorOwnsData(g_local)) {
+                hypre_VectorData(g_local)      = hypre_CTAlloc(HYPRE_Complex, onProcSize, HYPRE_MEMORY_HOST);
+                hypre_VectorOwnsData(g_local)  = 1;
+            }
+            std::copy(G.data, G.data + onProcSize, hypre_VectorData(g_local));
+        }
+        
+        FreeBuffer(G);
+        m_pool_active = false;
+        return;
     }
     
     // Create HYPRE vector
     HYPRE_IJVectorCreate(m_spatialComm, ilower, iupper, &gij);
     HYPRE_IJVectorSetObjectType(gij, HYPRE_PARCSR);
     HYPRE_IJVectorInitialize(gij);
-    HYPRE_IJVectorSetValues(gij, onProcSize, G_rows, G);
-    HYPRE_IJVectorAssemble(gij);
-    HYPRE_IJVectorGetObject(gij, (void **) &g);
-
-    // Remove pointers that should have been copied by Hypre
-    delete[] G_rows;
-    delete[] G;
+    
+    // Borrowed G: Swap it in for the local data of g
+    if (!G.owned) {
+        HYPRE_IJVectorAssemble(gij);
+        HYPRE_IJVectorGetObject(gij, (void **) &g);
+        hypre_Vector * g_local = hypre_ParVectorLocalVector(g);
+        hypre_TFree(hypre_VectorData(g_local), HYPRE_MEMORY_HOST);
+        hypre_VectorData(g_local)      = G.data;
+        hypre_VectorOwnsData(g_local)  = 0;
+        
+    // Owned G: Copy it into g
+    } else {
+        int * G_rows;
+        AllocBuffer(G_rows, onProcSize);
+        for (int i = 0; i < onProcSize; i++) {
+            G_rows[i] = ilower + i;
+        }
+        HYPRE_IJVectorSetValues(gij, onProcSize, G_rows, G.data);
+        HYPRE_IJVectorAssemble(gij);
+        HYPRE_IJVectorGetObject(gij, (void **) &g);
+        ReleaseBuffer(G_rows);
+    }
+    
+    FreeBuffer(G);
+    m_pool_active = false;
 }
 
 
-/* Get solution-dependent component of spatial discretization, the matrix L, as a HYPRE matrix */
+/* Get solution-dependent component of spatial discretization, the matrix L, as a HYPRE matrix 
+
+NOTES:
+    -L is always copied, since its CRS data must be split into diagonal and off-diagonal 
+        blocks for hypre. Its storage is released afterwards if it was handed over.
+    -If Lij already exists, and the nonzero structure of L is unchanged on all processes, 
+        only the values of L are rewritten, keeping its hypre objects (including the 
+        communication package for mat-vecs). Otherwise L is rebuilt.
+*/
 void SpaceTimeMatrix::GetHypreSpatialDiscretizationL(HYPRE_ParCSRMatrix &L,
                                                      HYPRE_IJMatrix     &Lij,
                                                      double              t)  
 {
-    // Free matrix if currently allocated memory
-    if (Lij) HYPRE_IJMatrixDestroy(Lij); 
-    
-    int      m_bsize;
-    int      ilower;
-    int      iupper;
-    int      spatialDOFs;
-    int      onProcSize;
-    int    * L_rowptr;
-    int    * L_colinds;
-    int    * L_rows;
-    int    * L_cols_per_row;
-    double * L_data;
-    double * U0; // Dummy variable
-    bool     getU0 = false; // No need to get initial guess at the solution
+    int           m_bsize;
+    int           ilower;
+    int           iupper;
+    int           spatialDOFs;
+    CSR_buffer    L_buffer  = {};
+    Vector_buffer U0        = {}; // Dummy variable
+    bool          getU0     = false; // No need to get initial guess at the solution
 
     // No parallelism: Spatial discretization on single processor
+    // L is released below, so its storage may come from the buffer pool
+    m_pool_active = true;
+    double discStart = MPI_Wtime();
     if (!m_useSpatialParallel) {
-        getSpatialDiscretizationL(L_rowptr, L_colinds, L_data, U0, getU0, spatialDOFs, t, m_bsize);
+        getSpatialDiscretizationL(L_buffer, U0, getU0, spatialDOFs, t, m_bsize);
         ilower = 0; 
         iupper = spatialDOFs - 1; 
     // Spatial parallelism: Distribute initial condition across spatial communicator    
     } else {
-        getSpatialDiscretizationL(m_spatialComm, L_rowptr, L_colinds, L_data, 
-                                    U0, getU0, ilower, iupper, spatialDOFs, 
-                                    t, m_bsize);
+        getSpatialDiscretizationL(m_spatialComm, L_buffer, U0, getU0, ilower, iupper, 
+                                    spatialDOFs, t, m_bsize);
     }
-
-    // Initialize matrix
-    onProcSize = iupper - ilower + 1; // Number of rows on process
-    HYPRE_IJMatrixCreate(m_spatialComm, ilower, iupper, ilower, iupper, &Lij);
-    HYPRE_IJMatrixSetObjectType(Lij, HYPRE_PARCSR);
-    HYPRE_IJMatrixInitialize(Lij);
-
-    // Set matrix coefficients
-    L_rows         = new int[onProcSize];
-    L_cols_per_row = new int[onProcSize];
-    for (int i = 0; i < onProcSize; i++) {
-        L_rows[i] = ilower + i;
-        L_cols_per_row[i] = L_rowptr[i+1] - L_rowptr[i];
+    m_phase_time[TIMER_SPATIAL_DISC] += MPI_Wtime() - discStart;
+
+    // Rewrite values of existing matrix if its structure is unchanged on all processes
+    int valuesSet = 0;
+    if (Lij) {
+        valuesSet = (hypre_ParCSRMatrixFirstRowIndex(L) == ilower 
+                        && hypre_CSRMatrixNumRows(hypre_ParCSRMatrixDiag(L)) == iupper - ilower + 1
+                        && SetHypreMatrixValuesFromCRSData(L, L_buffer.rowptr, L_buffer.colinds, 
+                                                            L_buffer.data, ilower, iupper));
+        MPI_Allreduce(MPI_IN_PLACE, &valuesSet, 1, MPI_INT, MPI_MIN, m_spatialComm);
+    }
+    
+    // Build matrix (freeing L if currently allocated)
+    if (!valuesSet) {
+        GetHypreMatrixFromCRSData(L, Lij, m_spatialComm, L_buffer.rowptr, L_buffer.colinds, 
+                                    L_buffer.data, ilower, iupper);
     }
-    HYPRE_IJMatrixSetValues(Lij, onProcSize, L_cols_per_row, L_rows, L_colinds, L_data);
-
-    // Finalize construction
-    HYPRE_IJMatrixAssemble(Lij);
-    HYPRE_IJMatrixGetObject(Lij, (void **) &L);
 
-    // Remove pointers that should have been copied by Hypre
-    delete[] L_rowptr;
-    delete[] L_colinds;
-    delete[] L_data;
-    delete[] L_rows;
-    delete[] L_cols_per_row;
+    // Remove pointers that have been copied into hypre matrix
+    FreeBuffer(L_buffer);
+    m_pool_active = false;
 }
 
 
 /* Get arbitrary matrix A as a HYPRE matrix from its CRS data, 
-    AND don't free this data once matrix has been assembled */
+    AND don't free this data once matrix has been assembled 
+    
+NOTES:
+    -A is square, with its columns distributed across processes in the same way as its rows.
+    -The ParCSR matrix is constructed directly rather than through HYPRE_IJMatrixSetValues
+        and HYPRE_IJMatrixAssemble: The CRS data is split into its diagonal and off-diagonal 
+        blocks, the sizes of which are counted first so that hypre's arrays are allocated 
+        once at their exact size and filled in a single pass.
+    -The diagonal entry of each row is stored first in the diagonal block, as hypre requires.
+    -Column indices are assumed to be unique within each row.
+    -The ParCSR matrix is owned by Aij, so both are freed by HYPRE_IJMatrixDestroy(Aij).
+        Aij only holds the matrix: Values of A are changed with SetHypreMatrixValuesFromCRSData 
+        and AddHypreMatrixValuesFromCRSData, not through the IJ interface.
+*/
 void SpaceTimeMatrix::GetHypreMatrixFromCRSData(HYPRE_ParCSRMatrix  &A,
                                                 HYPRE_IJMatrix      &Aij,
                                                 MPI_Comm             A_comm,
@@ -1974,31 +3649,291 @@ void SpaceTimeMatrix::GetHypreMatrixFromCRSData(HYPRE_ParCSRMatrix  &A,
                                                 int                  ilower, 
                                                 int                  iupper)  
 {
+    double ijStart = MPI_Wtime();
+    
     // Free matrix if currently allocated memory
     if (Aij) HYPRE_IJMatrixDestroy(Aij); 
     
-    // Initialize matrix
     int onProcSize = iupper - ilower + 1; // Number of rows on process
+    
+    /* --- Count nnz in diagonal and off-diagonal blocks, and get global indices of off-diagonal columns --- */
+    int diag_nnz = 0;
+    std::vector<int> offd_cols;
+    for (int p = A_rowptr[0]; p < A_rowptr[onProcSize]; p++) {
+        if (A_colinds[p] >= ilower && A_colinds[p] <= iupper) {
+            diag_nnz++;
+        } else {
+            offd_cols.push_back(A_colinds[p]);
+        }
+    }
+    int offd_nnz = offd_cols.size();
+    std::sort(offd_cols.begin(), offd_cols.end());
+    offd_cols.erase(std::unique(offd_cols.begin(), offd_cols.end()), offd_cols.end());
+    
+    CreateHypreMatrix(A, A_comm, ilower, iupper, diag_nnz, offd_nnz, offd_cols);
+    FillHypreMatrixRows(A, offd_cols, A_rowptr, A_colinds, A_data, ilower, iupper);
+    FinalizeHypreMatrix(A, Aij, A_comm, ilower, iupper);
+    
+    m_phase_time[TIMER_IJ_ASSEMBLY] += MPI_Wtime() - ijStart;
+}
+
+
+/* Create ParCSR matrix A with rows ilower,...,iupper on process, and diagonal and 
+    off-diagonal blocks allocated at their exact size. offd_cols are the sorted, unique 
+    global indices of the columns of the off-diagonal block.
+    
+NOTES:
+    -A is square, with its columns distributed across processes in the same way as its rows.
+    -Rows are then written with FillHypreMatrixRows, and A completed by FinalizeHypreMatrix.
+*/
+void SpaceTimeMatrix::CreateHypreMatrix(HYPRE_ParCSRMatrix     &A,
+                                        MPI_Comm                A_comm,
+                                        int                     ilower, 
+                                        int                     iupper, 
+                                        int                     diag_nnz, 
+                                        int                     offd_nnz, 
+                                        const std::vector<int> &offd_cols)
+{
+    int onProcSize = iupper - ilower + 1; // Number of rows on process
+    
+    /* --- Row distribution --- */
+    int globalSize;
+    MPI_Allreduce(&onProcSize, &globalSize, 1, MPI_INT, MPI_SUM, A_comm);
+#ifdef HYPRE_NO_GLOBAL_PARTITION
+    HYPRE_Int * row_starts = hypre_CTAlloc(HYPRE_Int, 2, HYPRE_MEMORY_HOST);
+    row_starts[0] = ilower;
+    row_starts[1] = iupper + 1;
+#else
+    int commSize;
+    MPI_Comm_size(A_comm, &commSize);
+    HYPRE_Int * row_starts = hypre_CTAlloc(HYPRE_Int, commSize + 1, HYPRE_MEMORY_HOST);
+    MPI_Allgather(&ilower, 1, MPI_INT, row_starts, 1, MPI_INT, A_comm);
+    row_starts[commSize] = globalSize;
+#endif
+    
+    // Row starts are shared with column starts, and the matrix owns them
+    A = hypre_ParCSRMatrixCreate(A_comm, globalSize, globalSize, row_starts, row_starts, 
+                                    offd_cols.size(), diag_nnz, offd_nnz);
+    hypre_ParCSRMatrixInitialize(A);
+    std::copy(offd_cols.begin(), offd_cols.end(), hypre_ParCSRMatrixColMapOffd(A));
+    hypre_CSRMatrixI(hypre_ParCSRMatrixDiag(A))[0] = 0;
+    hypre_CSRMatrixI(hypre_ParCSRMatrixOffd(A))[0] = 0;
+}
+
+
+/* Split CRS data of rows ilower,...,iupper of A (rows must be on process) into its 
+    diagonal and off-diagonal blocks, following on from the rows before them.
+    
+NOTES:
+    -Rows must be filled in order, starting from the first row on process.
+    -The diagonal entry of each row is stored first in the diagonal block, as hypre requires.
+    -Column indices are assumed to be unique within each row.
+*/
+void SpaceTimeMatrix::FillHypreMatrixRows(HYPRE_ParCSRMatrix     &A,
+                                          const std::vector<int> &offd_cols,
+                                          int                   * A_rowptr, 
+                                          int                   * A_colinds, 
+                                          double                * A_data, 
+                                          int                     ilower, 
+                                          int                     iupper)
+{
+    hypre_CSRMatrix * diag      = hypre_ParCSRMatrixDiag(A);
+    hypre_CSRMatrix * offd      = hypre_ParCSRMatrixOffd(A);
+    HYPRE_Int       * diag_i    = hypre_CSRMatrixI(diag);
+    HYPRE_Int       * diag_j    = hypre_CSRMatrixJ(diag);
+    HYPRE_Complex   * diag_data = hypre_CSRMatrixData(diag);
+    HYPRE_Int       * offd_i    = hypre_CSRMatrixI(offd);
+    HYPRE_Int       * offd_j    = hypre_CSRMatrixJ(offd);
+    HYPRE_Complex   * offd_data = hypre_CSRMatrixData(offd);
+    int               firstCol  = hypre_ParCSRMatrixFirstColDiag(A);
+    int               lastCol   = firstCol + hypre_CSRMatrixNumCols(diag) - 1;
+    int               row0      = ilower - hypre_ParCSRMatrixFirstRowIndex(A); // Local row of A
+    
+    int diagInd = diag_i[row0];
+    int offdInd = offd_i[row0];
+    for (int i = 0; i < iupper - ilower + 1; i++) {
+        int row = row0 + i;
+        
+        // Diagonal entry first
+        for (int p = A_rowptr[i]; p < A_rowptr[i+1]; p++) {
+            if (A_colinds[p] == firstCol + row) {
+                diag_j[diagInd]    = row;
+                diag_data[diagInd] = A_data[p];
+                diagInd++;
+            }
+        }
+        
+        // Remaining entries in the order they're given
+        for (int p = A_rowptr[i]; p < A_rowptr[i+1]; p++) {
+            int col = A_colinds[p];
+            if (col == firstCol + row) continue;
+            
+            if (col >= firstCol && col <= lastCol) {
+                diag_j[diagInd]    = col - firstCol;
+                diag_data[diagInd] = A_data[p];
+                diagInd++;
+            } else {
+                offd_j[offdInd]    = std::lower_bound(offd_cols.begin(), offd_cols.end(), col) - offd_cols.begin();
+                offd_data[offdInd] = A_data[p];
+                offdInd++;
+            }
+        }
+        diag_i[row+1] = diagInd;
+        offd_i[row+1] = offdInd;
+    }
+}
+
+
+/* Complete ParCSR matrix A once all of its rows have been filled, and wrap it in the IJ
+    matrix Aij, which takes ownership of it */
+void SpaceTimeMatrix::FinalizeHypreMatrix(HYPRE_ParCSRMatrix  &A,
+                                          HYPRE_IJMatrix      &Aij,
+                                          MPI_Comm             A_comm,
+                                          int                  ilower, 
+                                          int                  iupper)
+{
+    hypre_ParCSRMatrixSetNumNonzeros(A);
+    hypre_MatvecCommPkgCreate(A);
+    
     HYPRE_IJMatrixCreate(A_comm, ilower, iupper, ilower, iupper, &Aij);
     HYPRE_IJMatrixSetObjectType(Aij, HYPRE_PARCSR);
-    HYPRE_IJMatrixInitialize(Aij);
+    hypre_IJMatrixObject((hypre_IJMatrix *) Aij)       = A;
+    hypre_IJMatrixAssembleFlag((hypre_IJMatrix *) Aij) = 1;
+}
 
-    // Set matrix coefficients
-    int * A_rows         = new int[onProcSize];
-    int * A_cols_per_row = new int[onProcSize];
-    for (int i = 0; i < onProcSize; i++) {
-        A_rows[i] = ilower + i;
-        A_cols_per_row[i] = A_rowptr[i+1] - A_rowptr[i];
+
+/* Rewrite the values of rows ilower,...,iupper of existing HYPRE matrix A (rows must be 
+    on process) from CRS data with the same nonzero structure as A. Returns false if the 
+    structure differs, in which case A is left partially updated.
+    
+NOTES:
+    -The CRS data only needs to have the same nonzeros as A, not in the same order. 
+        Each entry is first looked for where GetHypreMatrixFromCRSData would have 
+        stored it, and otherwise searched for in its row.
+    -Column indices are assumed to be unique within each row.
+    -The input arrays are not freed.
+*/
+bool SpaceTimeMatrix::SetHypreMatrixValuesFromCRSData(HYPRE_ParCSRMatrix  &A,
+                                                      int                * A_rowptr, 
+                                                      int                * A_colinds, 
+                                                      double             * A_data, 
+                                                      int                  ilower, 
+                                                      int                  iupper)
+{
+    hypre_CSRMatrix * diag          = hypre_ParCSRMatrixDiag(A);
+    hypre_CSRMatrix * offd          = hypre_ParCSRMatrixOffd(A);
+    HYPRE_Int       * diag_i        = hypre_CSRMatrixI(diag);
+    HYPRE_Int       * diag_j        = hypre_CSRMatrixJ(diag);
+    HYPRE_Complex   * diag_data     = hypre_CSRMatrixData(diag);
+    HYPRE_Int       * offd_i        = hypre_CSRMatrixI(offd);
+    HYPRE_Int       * offd_j        = hypre_CSRMatrixJ(offd);
+    HYPRE_Complex   * offd_data     = hypre_CSRMatrixData(offd);
+    HYPRE_BigInt    * col_map_offd  = hypre_ParCSRMatrixColMapOffd(A);
+    int               firstRow      = hypre_ParCSRMatrixFirstRowIndex(A);
+    int               firstCol      = hypre_ParCSRMatrixFirstColDiag(A);
+    int               lastCol       = firstCol + hypre_CSRMatrixNumCols(diag) - 1;
+    
+    for (int i = 0; i < iupper - ilower + 1; i++) {
+        int row = ilower - firstRow + i; // Local row of A
+        
+        // Row must have same number of nonzeros
+        if (A_rowptr[i+1] - A_rowptr[i] != (diag_i[row+1] - diag_i[row]) + (offd_i[row+1] - offd_i[row])) return false;
+        
+        int diagInd = diag_i[row] + 1; // Diagonal entry is stored first
+        int offdInd = offd_i[row];
+        for (int p = A_rowptr[i]; p < A_rowptr[i+1]; p++) {
+            int col = A_colinds[p];
+            
+            // Diagonal block: Local column index
+            if (col >= firstCol && col <= lastCol) {
+                col -= firstCol;
+                int ind = (col == row) ? diag_i[row] : diagInd++;
+                if (ind >= diag_i[row+1] || diag_j[ind] != col) {
+                    for (ind = diag_i[row]; ind < diag_i[row+1] && diag_j[ind] != col; ind++) { }
+                    if (ind == diag_i[row+1]) return false;
+                }
+                diag_data[ind] = A_data[p];
+            
+            // Off-diagonal block: Global column index through column map
+            } else {
+                int ind = offdInd++;
+                if (ind >= offd_i[row+1] || col_map_offd[offd_j[ind]] != col) {
+                    for (ind = offd_i[row]; ind < offd_i[row+1] && col_map_offd[offd_j[ind]] != col; ind++) { }
+                    if (ind == offd_i[row+1]) return false;
+                }
+                offd_data[ind] = A_data[p];
+            }
+        }
     }
-    HYPRE_IJMatrixSetValues(Aij, onProcSize, A_cols_per_row, A_rows, A_colinds, A_data);
+    return true;
+}
 
-    // Finalize construction
-    HYPRE_IJMatrixAssemble(Aij);
-    HYPRE_IJMatrixGetObject(Aij, (void **) &A);
 
-    // Remove pointers that should have been copied by Hypre
-    delete[] A_rows;
-    delete[] A_cols_per_row;
+/* Add CRS data to the values of rows ilower,...,iupper of existing HYPRE matrix A (rows 
+    must be on process). Every nonzero of the CRS data must be a nonzero of A.
+    
+NOTES:
+    -Values are added directly into the diagonal and off-diagonal blocks of A, so A need 
+        not have been assembled through the IJ interface (see GetHypreMatrixFromCRSData).
+    -The input arrays are not freed.
+*/
+void SpaceTimeMatrix::AddHypreMatrixValuesFromCRSData(HYPRE_ParCSRMatrix  &A,
+                                                      int                * A_rowptr, 
+                                                      int                * A_colinds, 
+                                                      double             * A_data, 
+                                                      int                  ilower, 
+                                                      int                  iupper)
+{
+    hypre_CSRMatrix * diag          = hypre_ParCSRMatrixDiag(A);
+    hypre_CSRMatrix * offd          = hypre_ParCSRMatrixOffd(A);
+    HYPRE_Int       * diag_i        = hypre_CSRMatrixI(diag);
+    HYPRE_Int       * diag_j        = hypre_CSRMatrixJ(diag);
+    HYPRE_Complex   * diag_data     = hypre_CSRMatrixData(diag);
+    HYPRE_Int       * offd_i        = hypre_CSRMatrixI(offd);
+    HYPRE_Int       * offd_j        = hypre_CSRMatrixJ(offd);
+    HYPRE_Complex   * offd_data     = hypre_CSRMatrixData(offd);
+    HYPRE_BigInt    * col_map_offd  = hypre_ParCSRMatrixColMapOffd(A);
+    int               firstRow      = hypre_ParCSRMatrixFirstRowIndex(A);
+    int               firstCol      = hypre_ParCSRMatrixFirstColDiag(A);
+    int               lastCol       = firstCol + hypre_CSRMatrixNumCols(diag) - 1;
+    
+    for (int i = 0; i < iupper - ilower + 1; i++) {
+        int row = ilower - firstRow + i; // Local row of A
+        
+        for (int p = A_rowptr[i]; p < A_rowptr[i+1]; p++) {
+            int col   = A_colinds[p];
+            int found = 0;
+            
+            // Diagonal block: Local column index
+            if (col >= firstCol && col <= lastCol) {
+                col -= firstCol;
+                for (int ind = diag_i[row]; ind < diag_i[row+1]; ind++) {
+                    if (diag_j[ind] == col) {
+                        diag_data[ind] += A_data[p];
+                        found = 1;
+                        break;
+                    }
+                }
+            
+            // Off-diagonal block: Global column index through column map
+            } else {
+                for (int ind = offd_i[row]; ind < offd_i[row+1]; ind++) {
+                    if (col_map_offd[offd_j[ind]] == col) {
+                        offd_data[ind] += A_data[p];
+                        found = 1;
+                        break;
+                    }
+                }
+            }
+            
+            if (!found) {
+                std::cout << "WARNING: Entry (" << ilower + i << ", " << A_colinds[p] 
+                            << ") is not in the sparsity pattern of the matrix it's added to!\n";
+                MPI_Finalize();
+                exit(1);
+            }
+        }
+    }
 }
 
 
@@ -2011,6 +3946,8 @@ void SpaceTimeMatrix::GetHypreVectorFromData(HYPRE_ParVector  &x,
                                              int               ilower, 
                                              int               iupper) 
 {
+    double ijStart = MPI_Wtime();
+    
     // Free vector if currently allocated memory
     if (xij) HYPRE_IJVectorDestroy(xij); 
     
@@ -2028,15 +3965,100 @@ void SpaceTimeMatrix::GetHypreVectorFromData(HYPRE_ParVector  &x,
     HYPRE_IJVectorGetObject(xij, (void **) &x);
 
     delete[] rows;
+    m_phase_time[TIMER_IJ_ASSEMBLY] += MPI_Wtime() - ijStart;
+}
+
+
+/* Rewrite the values of existing HYPRE vector x from data on process */
+void SpaceTimeMatrix::SetHypreVectorValuesFromData(HYPRE_ParVector &x, 
+                                                   double        * x_data, 
+                                                   int             onProcSize)
+{
+    hypre_Vector * x_local = hypre_ParVectorLocalVector(x);
+    if (hypre_VectorSize(x_local) != onProcSize) {
+        std::cout << "WARNING: Cannot rewrite values of HYPRE vector of size " << hypre_VectorSize(x_local) 
+                    << " with " << onProcSize << " values on process " << m_globRank << ".\n";
+        MPI_Finalize();
+        exit(1);
+    }
+    std::copy(x_data, x_data + onProcSize, hypre_VectorData(x_local));
 }
 
 
 void SpaceTimeMatrix::BuildSpaceTimeMatrix()
 {
+    m_matrixFree = UseMatrixFreeOperator();
     if (m_globRank == 0) std::cout << "Building space-time matrix\n";
+    double assemblyStart = MPI_Wtime();
     if (m_useSpatialParallel) GetMatrix_ntLE1();
     else GetMatrix_ntGT1();
-    if (m_globRank == 0) std::cout << "Space-time matrix assembled.\n";
+    m_phase_time[TIMER_ST_ASSEMBLY] += MPI_Wtime() - assemblyStart;
+    ClearBinvScaling(); // Matrix has changed
+    if (m_globRank == 0) {
+        if (m_matrixFree) std::cout << "Space-time matrix set up to be applied matrix-free.\n";
+        else              std::cout << "Space-time matrix assembled.\n";
+    }
+    m_rebuildSolver = true; // Any existing solver is based on a previous matrix
+}
+
+
+/* Rewrite the values of the existing space-time matrix, RHS vector and initial guess, 
+    e.g., after changing dt, keeping the structure of the matrix and the layout of the 
+    vectors. The result is the same as if the space-time matrix were rebuilt.
+
+NOTES:
+    -If no space-time system exists yet (on any process), or it would now be set up in 
+        a different form (assembled vs. matrix-free), it is built from scratch.
+    -The number of time steps, the spatial discretization's DOFs, and the parallel 
+        distribution must not have changed since the matrix was built.
+    -If the nonzero structure of the matrix has changed on any process (e.g., a Butcher 
+        tableau with a different pattern of zero coefficients), the matrix is rebuilt.
+    -Multistep starting values must have been computed as for BuildSpaceTimeMatrix.
+    -The solver is rebuilt at its next use.
+*/
+void SpaceTimeMatrix::RefreshSpaceTimeMatrix()
+{
+    bool matrixFree = UseMatrixFreeOperator();
+    int  systemExists = (m_bij && m_xij && (m_matrixFree || m_Aij) && matrixFree == m_matrixFree);
+    MPI_Allreduce(MPI_IN_PLACE, &systemExists, 1, MPI_INT, MPI_MIN, m_globComm);
+    if (!systemExists) {
+        BuildSpaceTimeMatrix();
+        return;
+    }
+    
+    if (m_globRank == 0) std::cout << "Refreshing values of space-time matrix\n";
+    double assemblyStart = MPI_Wtime();
+    if (m_useSpatialParallel) GetMatrix_ntLE1(true, true);
+    else GetMatrix_ntGT1(true, true);
+    m_phase_time[TIMER_ST_ASSEMBLY] += MPI_Wtime() - assemblyStart;
+    ClearBinvScaling(); // Values of matrix have changed
+    m_rebuildSolver = true; // Solver is based on previous values of matrix
+}
+
+
+/* Rewrite the values of the existing space-time RHS vector and initial guess only, 
+    e.g., after changing the PDE source term or the initial condition. The space-time 
+    matrix and the solver are left as they are.
+
+NOTES:
+    -If no space-time system exists yet (on any process), the whole system is built.
+    -Anything that changes the matrix (e.g., dt) requires RefreshSpaceTimeMatrix instead.
+    -Multistep starting values must have been computed as for BuildSpaceTimeMatrix.
+*/
+void SpaceTimeMatrix::RefreshSpaceTimeRHS()
+{
+    int systemExists = (m_bij && m_xij);
+    MPI_Allreduce(MPI_IN_PLACE, &systemExists, 1, MPI_INT, MPI_MIN, m_globComm);
+    if (!systemExists) {
+        BuildSpaceTimeMatrix();
+        return;
+    }
+    
+    if (m_globRank == 0) std::cout << "Refreshing values of space-time RHS vector\n";
+    double assemblyStart = MPI_Wtime();
+    if (m_useSpatialParallel) GetMatrix_ntLE1(false, true);
+    else GetMatrix_ntGT1(false, true);
+    m_phase_time[TIMER_ST_ASSEMBLY] += MPI_Wtime() - assemblyStart;
 }
 
 
@@ -2054,6 +4076,7 @@ void SpaceTimeMatrix::SaveSolInfo(std::string filename, std::map<std::string, st
     solinfo << "P " << m_numProc << "\n";
     solinfo << "nt " << m_nt << "\n";
     solinfo << "dt " << m_dt << "\n";
+    if (m_pit && m_num_windows > 1) solinfo << "windows " << m_num_windows << "\n"; // Each of nt time steps
     solinfo << "spatialParallel " << int(m_useSpatialParallel) << "\n";
     if (m_useSpatialParallel) solinfo << "p_xTotal " << m_spatialCommSize << "\n";
     
@@ -2074,6 +4097,34 @@ void SpaceTimeMatrix::SaveSolInfo(std::string filename, std::map<std::string, st
         solinfo << "s_multi " << m_s_multi << "\n";
     }
     
+    // Transient buffer pool statistics (of this process)
+    if (!m_pit) {
+        solinfo << "pool_requests " << m_pool_requests << "\n";
+        solinfo << "pool_recycled " << m_pool_hits << "\n";
+        solinfo << "pool_bytes " << m_pool_bytes << "\n";
+        
+        // Initial guess of linear solves (iterations of each are in the performance record)
+        if (m_implicit) {
+            solinfo << "initial_guess " << m_solver_parameters.initial_guess << "\n";
+        }
+        
+        // Adaptive RK time-stepping
+        if (m_accepted_steps > 0) {
+            solinfo << "accepted_steps " << m_accepted_steps << "\n";
+            solinfo << "rejected_steps " << m_rejected_steps << "\n";
+        }
+        
+        if (m_snapshot_rate > 0) {
+            solinfo << "snapshot_rate " << m_snapshot_rate << "\n";
+        }
+        
+        // Checkpointing
+        if (m_checkpoint_rate > 0 || m_restart) {
+            solinfo << "checkpoint_rate " << m_checkpoint_rate << "\n";
+            solinfo << "checkpoints " << m_checkpoint_count << "\n";
+            solinfo << "restart " << m_restart << "\n";
+        }
+    }
     
 
     
@@ -2084,16 +4135,111 @@ void SpaceTimeMatrix::SaveSolInfo(std::string filename, std::map<std::string, st
     }
 
     solinfo.close();
+    
+    SavePerformanceRecord(filename + ".json", additionalInfo);
 }
 
 
-/* 
-timeDisc is a 3 digit integer
+/* Escape str for writing as a JSON string: Quotes and backslashes are preceded by a 
+    backslash, and control characters are written as \uXXXX. */
+static std::string EscapeJSONString(const std::string &str)
+{
+    std::string escaped;
+    for (size_t i = 0; i < str.size(); i++) {
+        unsigned char c = str[i];
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        } else if (c < 0x20) {
+            char code[7];
+            std::snprintf(code, sizeof(code), "\\u%04x", c);
+            escaped += code;
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
 
-timeDisc with "1" as 1st digit are ERK, timeDisc with "2" as 1st digit are DIRK
-2nd digit == number of stages
-3rd digit == order of method
-*/
+
+/* Print a JSON record of the run to file: its parameters, the iterations and residual 
+    norms of the linear solves, and the wall time of each phase (see TIMER_*) as 
+    min/max/avg over all processes. Keys and values in additionalInfo are saved as 
+    (escaped) strings.
+
+NOTES:
+    -Timings are those reduced at the end of the last call to Solve.
+*/
+void SpaceTimeMatrix::SavePerformanceRecord(std::string filename, std::map<std::string, std::string> additionalInfo) 
+{
+    std::ofstream record;
+    record.open(filename);
+    record << std::scientific;
+    record << "{\n";
+    record << "  \"pit\": " << int(m_pit) << ",\n";
+    record << "  \"P\": " << m_numProc << ",\n";
+    record << "  \"nt\": " << m_nt << ",\n";
+    record << "  \"dt\": " << m_dt << ",\n";
+    if (m_pit) record << "  \"windows\": " << m_num_windows << ",\n";
+    record << "  \"spatialParallel\": " << int(m_useSpatialParallel) << ",\n";
+    if (m_useSpatialParallel) record << "  \"p_xTotal\": " << m_spatialCommSize << ",\n";
+    record << "  \"timeDisc\": " << m_timeDisc << ",\n";
+    record << "  \"implicit\": " << int(m_implicit) << ",\n";
+    
+    // Linear solves
+    record << "  \"solves\": " << m_solve_count << ",\n";
+    record << "  \"total_iters\": " << m_total_iters << ",\n";
+    record << "  \"iters\": " << m_num_iters << ",\n";            // Of last solve
+    record << "  \"res_norm\": " << m_res_norm << ",\n";          // Of last solve
+    record << "  \"max_res_norm\": " << m_max_res_norm << ",\n";
+    if (!m_pit && m_implicit) {
+        record << "  \"step_iters\": [";
+        for (size_t i = 0; i < m_step_iters.size(); i++) record << (i > 0 ? ", " : "") << m_step_iters[i];
+        record << "],\n";
+    }
+    if (m_pit && !m_batch_x.empty()) {
+        record << "  \"batch_iters\": [";
+        for (size_t i = 0; i < m_batch_iters.size(); i++) record << (i > 0 ? ", " : "") << m_batch_iters[i];
+        record << "],\n";
+        record << "  \"batch_res_norm\": [";
+        for (size_t i = 0; i < m_batch_res_norm.size(); i++) record << (i > 0 ? ", " : "") << m_batch_res_norm[i];
+        record << "],\n";
+        record << "  \"batch_true_res_norm\": [";
+        for (size_t i = 0; i < m_batch_true_res_norm.size(); i++) record << (i > 0 ? ", " : "") << m_batch_true_res_norm[i];
+        record << "],\n";
+        record << "  \"batch_solve_time\": [";
+        for (size_t i = 0; i < m_batch_solve_time.size(); i++) record << (i > 0 ? ", " : "") << m_batch_solve_time[i];
+        record << "],\n";
+        record << "  \"batch_setup_time\": " << m_batch_setup_time << ",\n";
+        record << "  \"batch_time\": " << m_batch_time << ",\n";
+    }
+    
+    // Phase timings
+    record << "  \"timers\": {\n";
+    for (int i = 0; i < NUM_TIMERS; i++) {
+        record << "    \"" << timerNames[i] << "\": {\"min\": " << m_phase_min[i] 
+                << ", \"max\": " << m_phase_max[i] << ", \"avg\": " << m_phase_avg[i] << "}" 
+                << (i < NUM_TIMERS-1 ? "," : "") << "\n";
+    }
+    record << "  }";
+    
+    std::map<std::string, std::string>::iterator it;
+    for (it=additionalInfo.begin(); it!=additionalInfo.end(); it++) {
+        record << ",\n  \"" << EscapeJSONString(it->first) << "\": \"" << EscapeJSONString(it->second) << "\"";
+    }
+    record << "\n}\n";
+    
+    record.close();
+}
+
+
+/* 
+timeDisc is a 3 digit integer
+
+timeDisc with "1" as 1st digit are ERK, timeDisc with "2" as 1st digit are DIRK
+2nd digit == number of stages
+3rd digit == order of method
+*/
 void SpaceTimeMatrix::GetButcherTableaux() {
 
     m_s_butcher = m_timeDisc / 10 % 10; //  Extract number of stages; assumes number has 3 digits    
@@ -2101,6 +4247,9 @@ void SpaceTimeMatrix::GetButcherTableaux() {
     m_A_butcher.resize(m_s_butcher, std::vector<double>(m_s_butcher, 0.0));
     m_b_butcher.resize(m_s_butcher);
     m_c_butcher.resize(m_s_butcher);
+    // Embedded weights are only set for schemes that have an embedded pair
+    m_bhat_butcher.clear();
+    m_bhat_order = 0;
 
     /* --- ERK tables --- */
     // Forward Euler: 1st-order
@@ -2125,6 +4274,9 @@ void SpaceTimeMatrix::GetButcherTableaux() {
         m_b_butcher[1]    = 0.5;
         m_c_butcher[0]    = 0.0;
         m_c_butcher[1]    = 1.0;
+        // Embedded 1st-order forward Euler
+        m_bhat_order      = 1;
+        m_bhat_butcher    = {1.0, 0.0};
         
     // 3rd-order optimal SSPERK
     } else if (m_timeDisc == 133) {
@@ -2146,6 +4298,9 @@ void SpaceTimeMatrix::GetButcherTableaux() {
         m_c_butcher[0]    = 0.0;
         m_c_butcher[1]    = 1.0;
         m_c_butcher[2]    = 1.0/2.0;
+        // Embedded 2nd-order Heun's method (first two stages)
+        m_bhat_order      = 2;
+        m_bhat_butcher    = {1.0/2.0, 1.0/2.0, 0.0};
 
     // Classical 4th-order ERK
     } else if (m_timeDisc == 144){
@@ -2176,6 +4331,9 @@ void SpaceTimeMatrix::GetButcherTableaux() {
         m_c_butcher[1]    = 1.0/2.0;
         m_c_butcher[2]    = 1.0/2.0;
         m_c_butcher[3]    = 1.0;
+        // Embedded 2nd-order midpoint method (first two stages)
+        m_bhat_order      = 2;
+        m_bhat_butcher    = {0.0, 1.0, 0.0, 0.0};
     
     
     /* --- SDIRK tables --- */
@@ -2204,6 +4362,9 @@ void SpaceTimeMatrix::GetButcherTableaux() {
         m_b_butcher[1]    = 0.5;
         m_c_butcher[0]    = 1 - sqrt2/2.0;
         m_c_butcher[1]    = sqrt2/2.0;
+        // Embedded 1st-order solution (last stage only)
+        m_bhat_order      = 1;
+        m_bhat_butcher    = {0.0, 1.0};
         
     // 3rd-order (3-stage) L-stable SDIRK (see Butcher's book, p.261--262)
     } else if (m_timeDisc == 233) {
@@ -2231,6 +4392,9 @@ void SpaceTimeMatrix::GetButcherTableaux() {
         m_c_butcher[0]    =  zeta;
         m_c_butcher[1]    =  alpha;
         m_c_butcher[2]    =  1.0;
+        // Embedded 2nd-order solution (first two stages)
+        m_bhat_order      =  2;
+        m_bhat_butcher    =  {1.0 - (0.5 - zeta)/(alpha - zeta), (0.5 - zeta)/(alpha - zeta), 0.0};
         
     // 4th-order (5-stage) L-stable SDIRK (see Wanner's & Hairer's, Solving ODEs II, 1996, eq. 6.16)
     } else if (m_timeDisc == 254) {
@@ -2281,6 +4445,9 @@ void SpaceTimeMatrix::GetButcherTableaux() {
         m_c_butcher[2]    =  11.0/20.0;
         m_c_butcher[3]    =  1.0/2.0;
         m_c_butcher[4]    =  1.0;
+        // Embedded 3rd-order solution (see Wanner's & Hairer's, Solving ODEs II, 1996, Table 6.5)
+        m_bhat_order      =  3;
+        m_bhat_butcher    =  {59.0/48.0, -17.0/96.0, 225.0/32.0, -85.0/12.0, 0.0};
     
     } else {
         std::cout << "WARNING: invalid choice of time integration.\n";
@@ -2380,8 +4547,15 @@ void SpaceTimeMatrix::SetBDFTableaux()
 }
 
 
-/* Get space-time matrix for at less than 1 temporal DOF per processor: Uses spatial parallelism */
-void SpaceTimeMatrix::GetMatrix_ntLE1()
+/* Get space-time matrix for at less than 1 temporal DOF per processor: Uses spatial parallelism 
+
+NOTES:
+    -If getMatrix == false, only the RHS vector and initial guess are obtained
+    -If refresh == true, values are written into the existing hypre matrix and vectors 
+        (unless the structure of the matrix has changed, in which case it is rebuilt)
+*/
+void SpaceTimeMatrix::GetMatrix_ntLE1(bool getMatrix, 
+                                      bool refresh)
 {
     
     // Get local CSR structure
@@ -2394,9 +4568,9 @@ void SpaceTimeMatrix::GetMatrix_ntLE1()
     int localMaxRow;
     int spatialDOFs;
     if (m_RK) {
-        RKSpaceTimeBlock(rowptr, colinds, data, B, X, localMinRow, localMaxRow, spatialDOFs);
+        RKSpaceTimeBlock(rowptr, colinds, data, B, X, localMinRow, localMaxRow, spatialDOFs, getMatrix);
     } else if (m_BDF) {
-        BDFSpaceTimeBlock(rowptr, colinds, data, B, X, localMinRow, localMaxRow, spatialDOFs);
+        BDFSpaceTimeBlock(rowptr, colinds, data, B, X, localMinRow, localMaxRow, spatialDOFs, getMatrix);
     }
     // TODO: remove code below, but keep for the moment. 
     // if (m_timeDisc == 11) {
@@ -2415,24 +4589,38 @@ void SpaceTimeMatrix::GetMatrix_ntLE1()
     int onProcSize = localMaxRow - localMinRow + 1;
     int ilower = m_DOFInd*spatialDOFs + localMinRow;
     int iupper = m_DOFInd*spatialDOFs + localMaxRow;
-    HYPRE_IJMatrixCreate(m_globComm, ilower, iupper, ilower, iupper, &m_Aij);
-    HYPRE_IJMatrixSetObjectType(m_Aij, HYPRE_PARCSR);
-    HYPRE_IJMatrixInitialize(m_Aij);
+    if (getMatrix) {
+        // Rewrite values of existing matrix if its structure is unchanged on all processes
+        int valuesSet = refresh && SetHypreMatrixValuesFromCRSData(m_A, rowptr, colinds, data, ilower, iupper);
+        if (refresh) {
+            MPI_Allreduce(MPI_IN_PLACE, &valuesSet, 1, MPI_INT, MPI_MIN, m_globComm);
+            if (!valuesSet && m_globRank == 0) std::cout << "Structure of space-time matrix has changed; rebuilding it.\n";
+        }
+        if (!valuesSet) GetHypreMatrixFromCRSData(m_A, m_Aij, m_globComm, rowptr, colinds, data, ilower, iupper);
+        
+        // CSR structure has been copied into hypre matrix
+        delete[] rowptr;
+        delete[] colinds;
+        delete[] data;
+    }
+    
+    // Rewrite values of existing rhs and solution vectors
+    if (refresh) {
+        SetHypreVectorValuesFromData(m_b, B, onProcSize);
+        SetHypreVectorValuesFromData(m_x, X, onProcSize);
+        delete[] B;
+        delete[] X;
+        return;
+    }
 
-    // Set matrix coefficients
-    int* rows         = new int[onProcSize];
-    int* cols_per_row = new int[onProcSize];
+    int* rows = new int[onProcSize];
     for (int i=0; i<onProcSize; i++) {
         rows[i] = ilower + i;
-        cols_per_row[i] = rowptr[i+1] - rowptr[i];
     }
-    HYPRE_IJMatrixSetValues(m_Aij, onProcSize, cols_per_row, rows, colinds, data);
-
-    // Finalize construction
-    HYPRE_IJMatrixAssemble(m_Aij);
-    HYPRE_IJMatrixGetObject(m_Aij, (void **) &m_A);
 
     // Create rhs and solution vectors
+    if (m_bij) HYPRE_IJVectorDestroy(m_bij);
+    if (m_xij) HYPRE_IJVectorDestroy(m_xij);
     HYPRE_IJVectorCreate(m_globComm, ilower, iupper, &m_bij);
     HYPRE_IJVectorSetObjectType(m_bij, HYPRE_PARCSR);
     HYPRE_IJVectorInitialize(m_bij);
@@ -2448,18 +4636,21 @@ void SpaceTimeMatrix::GetMatrix_ntLE1()
     HYPRE_IJVectorGetObject(m_xij, (void **) &m_x);
 
     // Remove pointers that should have been copied by Hypre
-    delete[] rowptr;
-    delete[] colinds;
-    delete[] data;
     delete[] B;
     delete[] X;
     delete[] rows;
-    delete[] cols_per_row;
 }
 
 
-/* Get space-time matrix for at least 1 temporal DOF per processor: Doesn't use spatial parallelism */
-void SpaceTimeMatrix::GetMatrix_ntGT1()
+/* Get space-time matrix for at least 1 temporal DOF per processor: Doesn't use spatial parallelism 
+
+NOTES:
+    -If getMatrix == false, only the RHS vector and initial guess are obtained
+    -If refresh == true, values are written into the existing hypre matrix and vectors 
+        (unless the structure of the matrix has changed, in which case it is rebuilt)
+*/
+void SpaceTimeMatrix::GetMatrix_ntGT1(bool getMatrix, 
+                                      bool refresh)
 {
     // Get local CSR structure
     int* rowptr;
@@ -2469,10 +4660,13 @@ void SpaceTimeMatrix::GetMatrix_ntGT1()
     double* X;
     int onProcSize;
     
+    // Get matrix in Kronecker-product form rather than assembling CSR structure if possible
+    bool kron = getMatrix && (m_matrixFree || UseKroneckerStorage());
+    
     if (m_RK) {
-        RKSpaceTimeBlock(rowptr, colinds, data, B, X, onProcSize);
+        RKSpaceTimeBlock(rowptr, colinds, data, B, X, onProcSize, getMatrix && !kron, kron);
     } else if (m_BDF) {
-        BDFSpaceTimeBlock(rowptr, colinds, data, B, X, onProcSize);
+        BDFSpaceTimeBlock(rowptr, colinds, data, B, X, onProcSize, getMatrix && !kron, kron);
     }    
     // TODO : Delete the stuff below. But just keep for the moment.. 
    // if (m_timeDisc == 11) {
@@ -2487,27 +4681,44 @@ void SpaceTimeMatrix::GetMatrix_ntGT1()
    //      return;
    //  }
 
-    // Initialize matrix
     int ilower = m_globRank*onProcSize;
     int iupper = (m_globRank+1)*onProcSize - 1;
-    HYPRE_IJMatrixCreate(MPI_COMM_WORLD, ilower, iupper, ilower, iupper, &m_Aij);
-    HYPRE_IJMatrixSetObjectType(m_Aij, HYPRE_PARCSR);
-    HYPRE_IJMatrixInitialize(m_Aij);
     
-    // Set matrix coefficients
+    // Initialize matrix (unless it's applied matrix-free)
+    if (kron) {
+        if (!m_matrixFree) MaterializeKroneckerMatrix(ilower, iupper, refresh);
+    } else if (getMatrix) {
+        // Rewrite values of existing matrix if its structure is unchanged on all processes
+        int valuesSet = refresh && SetHypreMatrixValuesFromCRSData(m_A, rowptr, colinds, data, ilower, iupper);
+        if (refresh) {
+            MPI_Allreduce(MPI_IN_PLACE, &valuesSet, 1, MPI_INT, MPI_MIN, m_globComm);
+            if (!valuesSet && m_globRank == 0) std::cout << "Structure of space-time matrix has changed; rebuilding it.\n";
+        }
+        if (!valuesSet) GetHypreMatrixFromCRSData(m_A, m_Aij, m_globComm, rowptr, colinds, data, ilower, iupper);
+        
+        // CSR structure has been copied into hypre matrix
+        delete[] rowptr;
+        delete[] colinds;
+        delete[] data;
+    }
+    
+    // Rewrite values of existing rhs and solution vectors
+    if (refresh) {
+        SetHypreVectorValuesFromData(m_b, B, onProcSize);
+        SetHypreVectorValuesFromData(m_x, X, onProcSize);
+        delete[] B;
+        delete[] X;
+        return;
+    }
+    
     int* rows = new int[onProcSize];
-    int* cols_per_row = new int[onProcSize];
     for (int i=0; i<onProcSize; i++) {
         rows[i] = ilower + i;
-        cols_per_row[i] = rowptr[i+1] - rowptr[i];
     }
-    HYPRE_IJMatrixSetValues(m_Aij, onProcSize, cols_per_row, rows, colinds, data);
-    
-    // Finalize construction
-    HYPRE_IJMatrixAssemble(m_Aij);
-    HYPRE_IJMatrixGetObject(m_Aij, (void **) &m_A);
     
     // Create sample rhs and solution vectors
+    if (m_bij) HYPRE_IJVectorDestroy(m_bij);
+    if (m_xij) HYPRE_IJVectorDestroy(m_xij);
     HYPRE_IJVectorCreate(m_globComm, ilower, iupper, &m_bij);
     HYPRE_IJVectorSetObjectType(m_bij, HYPRE_PARCSR);
     HYPRE_IJVectorInitialize(m_bij);
@@ -2523,13 +4734,9 @@ void SpaceTimeMatrix::GetMatrix_ntGT1()
     HYPRE_IJVectorGetObject(m_xij, (void **) &m_x);
     
     // Remove pointers that should have been copied by Hypre
-    delete[] rowptr;
-    delete[] colinds;
-    delete[] data;
     delete[] B;
     delete[] X;
     delete[] rows;
-    delete[] cols_per_row;
 }
 
 
@@ -2557,6 +4764,19 @@ void SpaceTimeMatrix::SetSolverParametersDefaults() {
     m_solver_parameters.lump_mass    = true;
     
     m_solver_parameters.multi_init   = 0;
+    
+    m_solver_parameters.matrix_free  = false;
+    m_solver_parameters.kron_storage = false;
+    
+    m_solver_parameters.rebuildTol   = 0.0;
+    
+    m_solver_parameters.initial_guess = 0;
+    
+    m_solver_parameters.dt_rtol      = 0.0;
+    m_solver_parameters.dt_atol      = 0.0;
+    
+    m_solver_parameters.mass_solver  = 0;
+    m_solver_parameters.mass_cheby_iters = 0;
 }
 
 
@@ -2653,80 +4873,87 @@ void SpaceTimeMatrix::SetBoomerAMGOptions(int printLevel, int maxiter, double to
             if (m_globRank == 0) std::cout << "Building solver.\n";
         }
         
-        // Array to store relaxation scheme and pass to Hypre
-        //      TODO: does hypre clean up grid_relax_points
-        int ns_down = m_AMG_parameters.prerelax.length();
-        int ns_up = m_AMG_parameters.postrelax.length();
-        int ns_coarse = 1;
-        std::string Fr("F");
-        std::string Cr("C");
-        std::string Ar("A");
-        int* *grid_relax_points = new int* [4];
-        grid_relax_points[0] = NULL;
-        grid_relax_points[1] = new int[ns_down];
-        grid_relax_points[2] = new int [ns_up];
-        grid_relax_points[3] = new int[1];
-        grid_relax_points[3][0] = 0;
-
-        // set down relax scheme 
-        for(unsigned int i = 0; i<ns_down; i++) {
-            if (m_AMG_parameters.prerelax.compare(i,1,Fr) == 0) {
-                grid_relax_points[1][i] = -1;
-            }
-            else if (m_AMG_parameters.prerelax.compare(i,1,Cr) == 0) {
-                grid_relax_points[1][i] = 1;
-            }
-            else if (m_AMG_parameters.prerelax.compare(i,1,Ar) == 0) {
-                grid_relax_points[1][i] = 0;
-            }
-        }
-
-        // set up relax scheme 
-        for(unsigned int i = 0; i<ns_up; i++) {
-            if (m_AMG_parameters.postrelax.compare(i,1,Fr) == 0) {
-                grid_relax_points[2][i] = -1;
-            }
-            else if (m_AMG_parameters.postrelax.compare(i,1,Cr) == 0) {
-                grid_relax_points[2][i] = 1;
-            }
-            else if (m_AMG_parameters.postrelax.compare(i,1,Ar) == 0) {
-                grid_relax_points[2][i] = 0;
-            }
-        }
+        CreateBoomerAMG(m_solver, printLevel, maxiter, tol);
+    }
+}
 
-        // Create preconditioner
-        HYPRE_BoomerAMGCreate(&m_solver);
-        HYPRE_BoomerAMGSetTol(m_solver, tol);    
-        HYPRE_BoomerAMGSetMaxIter(m_solver, maxiter);
-        HYPRE_BoomerAMGSetPrintLevel(m_solver, printLevel);
 
-        if (m_AMG_parameters.distance_R > 0) {
-            HYPRE_BoomerAMGSetRestriction(m_solver, m_AMG_parameters.distance_R);
-            HYPRE_BoomerAMGSetStrongThresholdR(m_solver, m_AMG_parameters.strength_tolR);
-            HYPRE_BoomerAMGSetFilterThresholdR(m_solver, m_AMG_parameters.filter_tolR);
+/* Create AMG solver with options from m_AMG_parameters struct */
+void SpaceTimeMatrix::CreateBoomerAMG(HYPRE_Solver &solver, int printLevel, int maxiter, double tol)
+{
+    // Array to store relaxation scheme and pass to Hypre
+    //      TODO: does hypre clean up grid_relax_points
+    int ns_down = m_AMG_parameters.prerelax.length();
+    int ns_up = m_AMG_parameters.postrelax.length();
+    int ns_coarse = 1;
+    std::string Fr("F");
+    std::string Cr("C");
+    std::string Ar("A");
+    int* *grid_relax_points = new int* [4];
+    grid_relax_points[0] = NULL;
+    grid_relax_points[1] = new int[ns_down];
+    grid_relax_points[2] = new int [ns_up];
+    grid_relax_points[3] = new int[1];
+    grid_relax_points[3][0] = 0;
+
+    // set down relax scheme 
+    for(int i = 0; i<ns_down; i++) {
+        if (m_AMG_parameters.prerelax.compare(i,1,Fr) == 0) {
+            grid_relax_points[1][i] = -1;
+        }
+        else if (m_AMG_parameters.prerelax.compare(i,1,Cr) == 0) {
+            grid_relax_points[1][i] = 1;
+        }
+        else if (m_AMG_parameters.prerelax.compare(i,1,Ar) == 0) {
+            grid_relax_points[1][i] = 0;
         }
-        HYPRE_BoomerAMGSetInterpType(m_solver, m_AMG_parameters.interp_type);
-        HYPRE_BoomerAMGSetCoarsenType(m_solver, m_AMG_parameters.coarsen_type);
-        HYPRE_BoomerAMGSetAggNumLevels(m_solver, 0);
-        HYPRE_BoomerAMGSetStrongThreshold(m_solver, m_AMG_parameters.strength_tolC);
-        HYPRE_BoomerAMGSetGridRelaxPoints(m_solver, grid_relax_points);
-        if (m_AMG_parameters.relax_type > -1) {
-            HYPRE_BoomerAMGSetRelaxType(m_solver, m_AMG_parameters.relax_type);
+    }
+
+    // set up relax scheme 
+    for(int i = 0; i<ns_up; i++) {
+        if (m_AMG_parameters.postrelax.compare(i,1,Fr) == 0) {
+            grid_relax_points[2][i] = -1;
         }
-        HYPRE_BoomerAMGSetCycleNumSweeps(m_solver, ns_coarse, 3);
-        HYPRE_BoomerAMGSetCycleNumSweeps(m_solver, ns_down,   1);
-        HYPRE_BoomerAMGSetCycleNumSweeps(m_solver, ns_up,     2);
-        if (m_AMG_parameters.filter_tolA > 0) {
-            HYPRE_BoomerAMGSetADropTol(m_solver, m_AMG_parameters.filter_tolA);
+        else if (m_AMG_parameters.postrelax.compare(i,1,Cr) == 0) {
+            grid_relax_points[2][i] = 1;
         }
-        // type = -1: drop based on row inf-norm
-        else if (m_AMG_parameters.filter_tolA == -1) {
-            HYPRE_BoomerAMGSetADropType(m_solver, -1);
+        else if (m_AMG_parameters.postrelax.compare(i,1,Ar) == 0) {
+            grid_relax_points[2][i] = 0;
         }
+    }
+
+    // Create preconditioner
+    HYPRE_BoomerAMGCreate(&solver);
+    HYPRE_BoomerAMGSetTol(solver, tol);    
+    HYPRE_BoomerAMGSetMaxIter(solver, maxiter);
+    HYPRE_BoomerAMGSetPrintLevel(solver, printLevel);
 
-        // Set cycle type for solve 
-        HYPRE_BoomerAMGSetCycleType(m_solver, m_AMG_parameters.cycle_type);
+    if (m_AMG_parameters.distance_R > 0) {
+        HYPRE_BoomerAMGSetRestriction(solver, m_AMG_parameters.distance_R);
+        HYPRE_BoomerAMGSetStrongThresholdR(solver, m_AMG_parameters.strength_tolR);
+        HYPRE_BoomerAMGSetFilterThresholdR(solver, m_AMG_parameters.filter_tolR);
     }
+    HYPRE_BoomerAMGSetInterpType(solver, m_AMG_parameters.interp_type);
+    HYPRE_BoomerAMGSetCoarsenType(solver, m_AMG_parameters.coarsen_type);
+    HYPRE_BoomerAMGSetAggNumLevels(solver, 0);
+    HYPRE_BoomerAMGSetStrongThreshold(solver, m_AMG_parameters.strength_tolC);
+    HYPRE_BoomerAMGSetGridRelaxPoints(solver, grid_relax_points);
+    if (m_AMG_parameters.relax_type > -1) {
+        HYPRE_BoomerAMGSetRelaxType(solver, m_AMG_parameters.relax_type);
+    }
+    HYPRE_BoomerAMGSetCycleNumSweeps(solver, ns_coarse, 3);
+    HYPRE_BoomerAMGSetCycleNumSweeps(solver, ns_down,   1);
+    HYPRE_BoomerAMGSetCycleNumSweeps(solver, ns_up,     2);
+    if (m_AMG_parameters.filter_tolA > 0) {
+        HYPRE_BoomerAMGSetADropTol(solver, m_AMG_parameters.filter_tolA);
+    }
+    // type = -1: drop based on row inf-norm
+    else if (m_AMG_parameters.filter_tolA == -1) {
+        HYPRE_BoomerAMGSetADropType(solver, -1);
+    }
+
+    // Set cycle type for solve 
+    HYPRE_BoomerAMGSetCycleType(solver, m_AMG_parameters.cycle_type);
 }
 
 
@@ -2739,44 +4966,46 @@ AMG solver is not explicitly told to be rebuilt via the m_rebuildSolver flag */
 void SpaceTimeMatrix::SolveAMG()
 {
     if (!m_solver) m_rebuildSolver = true; // Ensure that if solver not build previously then it is built now
+    m_solverRebuilt = m_rebuildSolver;
+    m_setup_time    = 0.0;
     
     // TODO : What does this code mean? Does it scale the whole matrix by inverse of block diagonal mass matrix? 
     // If so, when do we want to do this? Oh, maybe if solving the space-time problem with explicit time stepping to make the 
     // Space-time matrix lower triangular...
     if (m_solver_parameters.binv_scale) {
-        HYPRE_ParCSRMatrix A_s;
-        hypre_ParcsrBdiagInvScal(m_A, m_bsize, &A_s);
-        hypre_ParCSRMatrixDropSmallEntries(A_s, 1e-15, 1);
         HYPRE_ParVector b_s;
-        hypre_ParvecBdiagInvScal(m_b, m_bsize, &b_s, m_A);
+        GetBinvScaledSystem(b_s);
     
-    
-        // TODO : wrap setup timer around this block
         // If necessary, construct AMG solver based on current value of  A
         if (m_rebuildSolver) {
+            double setupStart = MPI_Wtime();
             // Set or reset options for AMG solver
             SetBoomerAMGOptions(m_solver_parameters.printLevel, m_solver_parameters.maxiter, m_solver_parameters.tol);
             // Build AMG hierarchy based on current value of A_s
-            HYPRE_BoomerAMGSetup(m_solver, A_s, b_s, m_x); // NOTE: Values of b and x are ignored by this function!
+            HYPRE_BoomerAMGSetup(m_solver, m_A_s, b_s, m_x); // NOTE: Values of b and x are ignored by this function!
+            m_setup_time = MPI_Wtime() - setupStart;
             if (m_globRank == 0) std::cout << "Solver assembled.\n";
             m_rebuildSolver = false; // Don't rebuild solver again unless explicitly told to
         }
         
-        // TODO : wrap solve timer around this block
         // Solve linear system based on current values of A,b,x 
-        m_hypre_ierr = HYPRE_BoomerAMGSolve(m_solver, A_s, b_s, m_x);
+        double solveStart = MPI_Wtime();
+        m_hypre_ierr = HYPRE_BoomerAMGSolve(m_solver, m_A_s, b_s, m_x);
+        m_solve_time = MPI_Wtime() - solveStart;
         
-        // TODO : What happens to A_s and b_s here? Don't they need to be free'd? Or are they just copies?
+        // Scaled matrix is kept for later solves, scaled RHS is not
+        HYPRE_ParVectorDestroy(b_s);
     }
     else 
     {
-        // TODO : wrap setup timer around block
         // If necessary, construct AMG solver based on current value of  A
         if (m_rebuildSolver) {
+            double setupStart = MPI_Wtime();
             // Set or reset options for AMG solver
             SetBoomerAMGOptions(m_solver_parameters.printLevel, m_solver_parameters.maxiter, m_solver_parameters.tol);
             // Build AMG hierarchy based on current value of A
             HYPRE_BoomerAMGSetup(m_solver, m_A, m_b, m_x); // NOTE: Values of b and x are ignored by this function!
+            m_setup_time = MPI_Wtime() - setupStart;
             
             
             // experimenting with extracting CF splitting from solver object
@@ -2793,17 +5022,128 @@ void SpaceTimeMatrix::SolveAMG()
             m_rebuildSolver = false; // Don't rebuild solver again unless explicitly told to
         }
         
-        // TODO : wrap solve timer around this block
         // Solve linear system based on current values of A,b,x 
+        double solveStart = MPI_Wtime();
         m_hypre_ierr = HYPRE_BoomerAMGSolve(m_solver, m_A, m_b, m_x);
+        m_solve_time = MPI_Wtime() - solveStart;
     }
     
     // Get convergence statistics
     HYPRE_BoomerAMGGetNumIterations(m_solver, &m_num_iters);
     HYPRE_BoomerAMGGetFinalRelativeResidualNorm(m_solver, &m_res_norm);
+    AccumulateSolveStats();
+}
+
+
+/* Get system scaled by inverse of block diagonal of m_A: The scaled matrix, m_A_s, is 
+    only computed if it hasn't been already for m_A, and the scaled RHS is returned in b_s, 
+    which must be destroyed by the caller.
+
+NOTES:
+    -The block inverses are stored in m_A by hypre_ParcsrBdiagInvScal, so that scaling 
+        the RHS of later solves with the same m_A is cheap.
+    -The values of m_A must not have changed since m_A_s was computed; ClearBinvScaling 
+        must be called if they have.
+*/
+void SpaceTimeMatrix::GetBinvScaledSystem(HYPRE_ParVector &b_s)
+{
+    if (!m_A_s || m_binv_A != m_A) {
+        ClearBinvScaling();
+        hypre_ParcsrBdiagInvScal(m_A, m_bsize, &m_A_s);
+        hypre_ParCSRMatrixDropSmallEntries(m_A_s, 1e-15, 1);
+        m_binv_A = m_A;
+    }
+    hypre_ParvecBdiagInvScal(m_b, m_bsize, &b_s, m_A);
+}
+
+
+/* Destroy matrix scaled by inverse of its block diagonal, e.g., because the values of the 
+    matrix it was computed from have changed */
+void SpaceTimeMatrix::ClearBinvScaling()
+{
+    if (m_A_s) hypre_ParCSRMatrixDestroy(m_A_s);
+    m_A_s    = NULL;
+    m_binv_A = NULL;
+}
+
+
+/* Adaptive solver rebuild policy for sequential time-stepping; call after each linear solve. 
+    The first solve after the solver has been (re)built sets a baseline. A rebuild is due 
+    (m_rebuild_due) once a later solve needs more than rebuildTol times the baseline 
+    number of iterations, or converges at a rate, -log(convergence factor), less than 
+    1/rebuildTol times the baseline rate.
+
+NOTES:
+    -The decision depends only on iteration counts and residual norms, which are global, 
+        so all processes make the same decision.
+    -To help tune rebuildTol, the time of the last setup is printed alongside the solve 
+        time spent above the baseline since then, i.e., the cost of not rebuilding.
+*/
+void SpaceTimeMatrix::UpdateAdaptiveRebuild()
+{
+    // Convergence rate; solves that converged immediately are taken as the fastest possible
+    double rate = (m_num_iters > 0 && m_res_norm > 0.0) ? -log(m_res_norm) / m_num_iters : 1e16;
+    
+    // Solver rebuilt for this solve: Reset baseline
+    if (m_solverRebuilt) {
+        m_rebuild_due           = false;
+        m_rebuild_baseIters     = m_num_iters;
+        m_rebuild_baseRate      = rate;
+        m_rebuild_baseSolveTime = m_solve_time;
+        m_rebuild_setupTime     = m_setup_time;
+        m_rebuild_staleTime     = 0.0;
+        return;
+    }
+    
+    if (m_solver_parameters.rebuildTol <= 0.0 || m_rebuild_baseIters < 0) return;
+    
+    m_rebuild_staleTime += std::max(0.0, m_solve_time - m_rebuild_baseSolveTime);
+    if (m_num_iters > m_solver_parameters.rebuildTol * m_rebuild_baseIters || 
+            rate < m_rebuild_baseRate / m_solver_parameters.rebuildTol) {
+        m_rebuild_due = true;
+        if (m_solver_parameters.printLevel > 0 && m_globRank == 0) {
+            std::cout << "Solver due to be rebuilt: " << m_num_iters << " iterations, convergence factor " 
+                        << exp(-rate) << " (after last rebuild: " << m_rebuild_baseIters 
+                        << " iterations, convergence factor " << exp(-m_rebuild_baseRate) << ")\n";
+            std::cout << "    Time of last setup = " << m_rebuild_setupTime 
+                        << "s; additional solve time since = " << m_rebuild_staleTime << "s\n";
+        }
+    }
+}
+
+
+/* Add setup and solve time, iterations and residual norm of the AMG/GMRES solve just done 
+    to the totals over all solves */
+void SpaceTimeMatrix::AccumulateSolveStats()
+{
+    m_phase_time[TIMER_SOLVER_SETUP] += m_setup_time;
+    m_phase_time[TIMER_SOLVE]        += m_solve_time;
+    m_solve_count  += 1;
+    m_total_iters  += m_num_iters;
+    m_max_res_norm  = std::max(m_max_res_norm, m_res_norm);
 }
 
 
+/* Reduce time spent in each phase over all processes to its minimum, maximum and average, 
+    and print them. Must be called by all processes in m_globComm. */
+void SpaceTimeMatrix::ReduceTimers()
+{
+    MPI_Allreduce(m_phase_time, m_phase_min, NUM_TIMERS, MPI_DOUBLE, MPI_MIN, m_globComm);
+    MPI_Allreduce(m_phase_time, m_phase_max, NUM_TIMERS, MPI_DOUBLE, MPI_MAX, m_globComm);
+    MPI_Allreduce(m_phase_time, m_phase_avg, NUM_TIMERS, MPI_DOUBLE, MPI_SUM, m_globComm);
+    for (int i = 0; i < NUM_TIMERS; i++) m_phase_avg[i] /= m_numProc;
+    
+    if (m_globRank == 0) {
+        std::cout << "=============================================\n";
+        std::cout << "Wall time of phases over " << m_numProc << " processes (s): min / max / avg\n";
+        std::cout << "---------------------------------------------\n";
+        for (int i = 0; i < NUM_TIMERS; i++) {
+            std::cout << std::left << std::setw(16) << timerNames[i] << std::right << "= " 
+                        << m_phase_min[i] << " / " << m_phase_max[i] << " / " << m_phase_avg[i] << '\n';
+        }
+    }
+}
+
 
 /* Initialize GMRES solver based on parameters in m_solver_parameters struct. */
 void SpaceTimeMatrix::SetGMRESOptions() {
@@ -2816,10 +5156,16 @@ void SpaceTimeMatrix::SetGMRESOptions() {
         if (m_gmres) HYPRE_ParCSRGMRESDestroy(m_gmres);
     
         // Create solver object
-        HYPRE_ParCSRGMRESCreate(m_solverComm, &m_gmres);
+        if (m_matrixFree) MatrixFreeGMRESCreate();
+        else              HYPRE_ParCSRGMRESCreate(m_solverComm, &m_gmres);
     
-        // AMG preconditioning 
-        if (m_solver_parameters.gmres_preconditioner == 1) {
+        // Block forward substitution across temporal DOFs, solving with diagonal blocks by AMG
+        if (UseBlockForwardSubstitution()) {
+            HYPRE_GMRESSetPrecond(m_gmres, (HYPRE_PtrToSolverFcn) BlockForwardSubstitutionSolve,
+                              (HYPRE_PtrToSolverFcn) BlockForwardSubstitutionSetup, (HYPRE_Solver) this);
+        }
+        // AMG preconditioning (also used for spatial systems if block forward substitution is chosen)
+        else if (m_solver_parameters.gmres_preconditioner == 1 || m_solver_parameters.gmres_preconditioner == 3) {
             // Setup boomerAMG with zero halting tolerance so we can do a fixed number of AMG iterations
             SetBoomerAMGOptions(m_solver_parameters.precon_printLevel, m_solver_parameters.AMGiters, 0.0);
             HYPRE_GMRESSetPrecond(m_gmres, (HYPRE_PtrToSolverFcn) HYPRE_BoomerAMGSolve,
@@ -2850,58 +5196,81 @@ is not explicitly told to be rebuilt via the m_rebuildSolver flag */
 void SpaceTimeMatrix::SolveGMRES() 
 {
     if (!m_gmres) m_rebuildSolver = true; // Ensure that if solver not build previously then it is built now
+    m_solverRebuilt = m_rebuildSolver;
+    m_setup_time    = 0.0;
 
-    if (m_solver_parameters.binv_scale) {
-        HYPRE_ParCSRMatrix A_s;
-        hypre_ParcsrBdiagInvScal(m_A, m_bsize, &A_s);
-        hypre_ParCSRMatrixDropSmallEntries(A_s, 1e-15, 1);
+    // Space-time matrix is not assembled: Apply it matrix-free through generic GMRES interface
+    if (m_matrixFree) {
+        // If necessary, build GMRES solver
+        if (m_rebuildSolver) {
+            double setupStart = MPI_Wtime();
+            SetGMRESOptions();
+            HYPRE_GMRESSetup(m_gmres, (HYPRE_Matrix) this, (HYPRE_Vector) m_b, (HYPRE_Vector) m_x);
+            m_setup_time = MPI_Wtime() - setupStart;
+            if (m_globRank == 0) std::cout << "Solver assembled.\n";
+            m_rebuildSolver = false; // Don't rebuild solver again unless explicitly told to
+        }
+        
+        // Solve linear system based on current values of b,x
+        double solveStart = MPI_Wtime();
+        m_hypre_ierr = HYPRE_GMRESSolve(m_gmres, (HYPRE_Matrix) this, (HYPRE_Vector) m_b, (HYPRE_Vector) m_x);
+        m_solve_time = MPI_Wtime() - solveStart;
+    }
+    else if (m_solver_parameters.binv_scale) {
         HYPRE_ParVector b_s;
-        hypre_ParvecBdiagInvScal(m_b, m_bsize, &b_s, m_A);
+        GetBinvScaledSystem(b_s);
         
-        // TODO : wrap setup timer around block
         // If necessary, build GMRES solver based on current value of A_s
         if (m_rebuildSolver) {
+            double setupStart = MPI_Wtime();
             // Set or reset options for GMRES solver
             SetGMRESOptions();
             // Build GMRES solver based on current value of A
-            HYPRE_ParCSRGMRESSetup(m_gmres, A_s, b_s, m_x); // NOTE: Values of b and x are ignored by this function!
+            HYPRE_ParCSRGMRESSetup(m_gmres, m_A_s, b_s, m_x); // NOTE: Values of b and x are ignored by this function!
+            m_setup_time = MPI_Wtime() - setupStart;
             if (m_globRank == 0) std::cout << "Solver assembled.\n";
             m_rebuildSolver = false; // Don't rebuild solver again unless explicitly told to
         }
         
-        // TODO : wrap solve timer around this block
         // Solve linear system based on current values of A,b,x
-        m_hypre_ierr = HYPRE_ParCSRGMRESSolve(m_gmres, A_s, b_s, m_x);
+        double solveStart = MPI_Wtime();
+        m_hypre_ierr = HYPRE_ParCSRGMRESSolve(m_gmres, m_A_s, b_s, m_x);
+        m_solve_time = MPI_Wtime() - solveStart;
         
-        // TODO : What happens to A_s and b_s here? I think they likely need to be free'd? 
+        // Scaled matrix is kept for later solves, scaled RHS is not
+        HYPRE_ParVectorDestroy(b_s);
     }
     else 
     {
         
-        // TODO : wrap setup timer around block
         // If necessary, build GMRES solver based on current value of A
         if (m_rebuildSolver) {
+            double setupStart = MPI_Wtime();
             // Set or reset options for GMRES solver
             SetGMRESOptions();
             // Build GMRES solver based on current value of A
             HYPRE_ParCSRGMRESSetup(m_gmres, m_A, m_b, m_x); // NOTE: Values of b and x are ignored by this function!
+            m_setup_time = MPI_Wtime() - setupStart;
             if (m_globRank == 0) std::cout << "Solver assembled.\n";
             m_rebuildSolver = false; // Don't rebuild solver again unless explicitly told to
         }
         
-        // TODO : wrap solve timer around this block
         // Solve linear system based on current values of A,b,x
+        double solveStart = MPI_Wtime();
         m_hypre_ierr = HYPRE_ParCSRGMRESSolve(m_gmres, m_A, m_b, m_x);
+        m_solve_time = MPI_Wtime() - solveStart;
     }
     
     // Get convergence statistics
     HYPRE_GMRESGetNumIterations(m_gmres, &m_num_iters);
     HYPRE_GMRESGetFinalRelativeResidualNorm(m_gmres, &m_res_norm);
+    AccumulateSolveStats();
 }
 
 
 
-/* Initialize (unpreconditioned) PCG based on parameters in m_solver_parameters struct. 
+/* Initialize PCG based on parameters in m_solver_parameters struct. It's preconditioned by 
+    Jacobi or block Jacobi if mass_solver is 1 or 2, respectively, and otherwise unpreconditioned.
 
 NOTE:
     -No attention paid to m_rebuildSolver here since the mass matrix will not change 
@@ -2919,13 +5288,19 @@ void SpaceTimeMatrix::SetPCGOptions() {
     HYPRE_PCGSetTol(m_pcg, m_solver_parameters.tol);
     HYPRE_PCGSetPrintLevel(m_pcg, m_solver_parameters.printLevel);
     HYPRE_PCGSetLogging(m_pcg, 1);
+    
+    if (m_solver_parameters.mass_solver == 1 || m_solver_parameters.mass_solver == 2) {
+        HYPRE_PCGSetPrecond(m_pcg, (HYPRE_PtrToSolverFcn) MassPreconditionerSolve,
+                            (HYPRE_PtrToSolverFcn) MassPreconditionerSetup, (HYPRE_Solver) this);
+    }
 }
 
 
 /* Solve the linear system M*m_x = m_b where M is the mass matrix 
 
 Options:
-    1. M not lumped, and don't scale by block inverse: Solve iteratively with CG
+    1. M not lumped, and don't scale by block inverse: Solve iteratively with (Jacobi- or 
+        block-Jacobi-preconditioned) CG, or apply a fixed number of Chebyshev iterations
     2. M lumped to be diagonal: Multiply by its inverse
     3. Option set to scale by block inverse of M: Multiply by its inverse
     
@@ -2935,8 +5310,16 @@ NOTE:
 */
 void SpaceTimeMatrix::SolveMassSystem() 
 {
-    // Use unpreconditioned CG if not exactly inverting linear system
-    if (!m_solver_parameters.lump_mass && !m_solver_parameters.binv_scale) {
+    double massStart = MPI_Wtime();
+    
+    // Chebyshev iteration: Fixed number of iterations, so convergence is not checked
+    if (!m_solver_parameters.lump_mass && !m_solver_parameters.binv_scale && m_solver_parameters.mass_solver >= 3) {
+        m_iterative = false;
+        if (m_massWork.empty()) SetupMassChebyshev();
+        SolveMassChebyshev();
+    
+    // Use (preconditioned) CG if not exactly inverting linear system
+    } else if (!m_solver_parameters.lump_mass && !m_solver_parameters.binv_scale) {
         m_iterative = true;
         
         // Setup solver if hasn't been done previously
@@ -2980,189 +5363,1752 @@ void SpaceTimeMatrix::SolveMassSystem()
         // Scale RHS by mass inverse
         hypre_ParvecBdiagInvScal(m_b, m_bsize, &m_x, m_M); // x <- inv(A) * b
     }
+    
+    m_phase_time[TIMER_MASS_SOLVE] += MPI_Wtime() - massStart;
 }
 
 
-/* ----------------------------------------------------------- */
-/* ----------------- No spatial parallelism ------------------ */
-/* ----------------------------------------------------------- */
-/* NOTES:
-    -Does not make any assumption about overlap in the sparsity pattern of the spatial 
-        discretization and mass matrix when estimating matrix nnz, 
-        assumes nnz of spatial discretization does not depend on time
- */
+/* Overwrite n x n matrix A, stored row-wise, with its inverse by Gauss-Jordan elimination 
+    with partial pivoting. Returns false if A is singular. */
+static bool InvertDenseMatrix(double * A, int n)
+{
+    std::vector<double> LU(A, A + n*n);
+    for (int i = 0; i < n*n; i++) A[i] = 0.0;
+    for (int i = 0; i < n; i++) A[i*n + i] = 1.0;
+    
+    for (int k = 0; k < n; k++) {
+        int piv = k;
+        for (int i = k+1; i < n; i++) {
+            if (std::abs(LU[i*n + k]) > std::abs(LU[piv*n + k])) piv = i;
+        }
+        if (LU[piv*n + k] == 0.0) return false;
+        if (piv != k) {
+            for (int j = 0; j < n; j++) {
+                std::swap(LU[k*n + j], LU[piv*n + j]);
+                std::swap(A[k*n + j], A[piv*n + j]);
+            }
+        }
+        
+        double pivot = LU[k*n + k];
+        for (int j = 0; j < n; j++) {
+            LU[k*n + j] /= pivot;
+            A[k*n + j]  /= pivot;
+        }
+        for (int i = 0; i < n; i++) {
+            double factor = LU[i*n + k];
+            if (i == k || factor == 0.0) continue;
+            for (int j = 0; j < n; j++) {
+                LU[i*n + j] -= factor * LU[k*n + j];
+                A[i*n + j]  -= factor * A[k*n + j];
+            }
+        }
+    }
+    return true;
+}
+
 
+/* The k-th smallest eigenvalue (k = 0,...,n-1) of the symmetric tridiagonal matrix with 
+    diagonal d and off-diagonal e, by bisection using Sturm sequence counts */
+static double TridiagonalEigenvalue(const std::vector<double> &d, 
+                                    const std::vector<double> &e, 
+                                    int k)
+{
+    int n = d.size();
+    
+    // Gershgorin bounds on the spectrum
+    double lo = d[0], hi = d[0];
+    for (int j = 0; j < n; j++) {
+        double radius = (j > 0 ? std::abs(e[j-1]) : 0.0) + (j < n-1 ? std::abs(e[j]) : 0.0);
+        lo = std::min(lo, d[j] - radius);
+        hi = std::max(hi, d[j] + radius);
+    }
+    
+    for (int iter = 0; iter < 100; iter++) {
+        double x = 0.5 * (lo + hi);
+        
+        // Number of eigenvalues less than x
+        int    count = 0;
+        double q     = 1.0;
+        for (int j = 0; j < n; j++) {
+            q = d[j] - x - (j > 0 ? e[j-1] * e[j-1] / q : 0.0);
+            if (q == 0.0) q = 1e-300;
+            if (q < 0.0) count++;
+        }
+        
+        if (count > k) hi = x;
+        else lo = x;
+    }
+    return 0.5 * (lo + hi);
+}
 
 
-/* Gets block row (or multiple if there are > 1 DOFs per process) of s-step BDF 
-    space-time equations. No spatial parallelism.
+/* Set up preconditioner for solves with mass matrix M: The inverse of its diagonal (Jacobi),
+    or of its diagonal blocks of size m_bsize (block Jacobi) if mass_solver is 2 or 4
 
-NOTEs: 
-    -m_t0 is assumed to be 0, and so the spatial discretization is evaluated at
-        time t0 + (n+s)*dt == (n+s)*dt.
+NOTES:
+    -Diagonal blocks must not be split between processes
 */
-void SpaceTimeMatrix::BDFSpaceTimeBlock(int    * &rowptr, 
-                                        int    * &colinds, 
-                                        double * &data, 
-                                        double * &B, 
-                                        double * &V, 
-                                        int      &onProcSize)
+void SpaceTimeMatrix::SetupMassPreconditioner(HYPRE_ParCSRMatrix M)
 {
-    int globalInd0 = m_globRank * m_nDOFPerProc;    // Index of first DOF on process
-    int globalInd1 = globalInd0 + m_nDOFPerProc - 1;// Index of last DOF on process
-    
-    /* --- Get spatial discretization at time required by 1st DOF on process --- */
-    int      spatialDOFs;    
-    int      L_nnz;
-    int    * L_rowptr;
-    int    * L_colinds;
-    double * L_data;
-    double * B0;
-    double * V0;
-    bool     getV0 = true; // Get initial guess at solution from getSpatialDiscretizationL
-    getSpatialDiscretizationG(B0, spatialDOFs, m_t0 + (globalInd0+m_s_multi)*m_dt);
-    getSpatialDiscretizationL(L_rowptr, L_colinds, L_data, V0, getV0, spatialDOFs, m_t0 + (globalInd0+m_s_multi)*m_dt, m_bsize);
-    L_nnz = L_rowptr[spatialDOFs];   
+    hypre_CSRMatrix * diag       = hypre_ParCSRMatrixDiag(M);
+    HYPRE_Int       * diag_i     = hypre_CSRMatrixI(diag);
+    HYPRE_Int       * diag_j     = hypre_CSRMatrixJ(diag);
+    HYPRE_Complex   * diag_data  = hypre_CSRMatrixData(diag);
+    int               onProcSize = hypre_CSRMatrixNumRows(diag);
+    
+    int bsize = 1;
+    if (m_solver_parameters.mass_solver == 2 || m_solver_parameters.mass_solver == 4) bsize = m_bsize;
+    if (onProcSize % bsize != 0) {
+        if (m_spatialRank == 0) std::cout << "WARNING: Block-Jacobi mass preconditioner requires that diagonal blocks of size " << bsize << " are not split between processes!" << '\n';
+        MPI_Finalize();
+        exit(1);
+    }
+    m_massBsize = bsize;
     
-    /* --- Get mass matrix ---*/
-    int      M_nnz;
-    int    * M_rowptr;
-    int    * M_colinds;
-    double * M_data;
-    // Set range of identity mass matix to assemble if needed (all fits on process)
-    if (!m_M_exists) setIdentityMassLocalRange(0, spatialDOFs-1); 
-    getMassMatrix(M_rowptr, M_colinds, M_data);
-    M_nnz = M_rowptr[spatialDOFs];
-
-    /* --- Get total NNZ estimate on process --- */
-    //  -Assume NNZ of L does not change with time
-    //  -Don't assume sparsity of M and L overlap: Estimate will be an upperbound.
-    int onProcNnz = 0;
-    for (int globalInd = globalInd0; globalInd <= globalInd1; globalInd++) {
-        // Coupling to myself
-        onProcNnz += M_nnz;
-        onProcNnz += L_nnz;
-        
-        // Coupling to DOFs at s previous times
-        if (globalInd > m_s_multi - 1) {
-            onProcNnz += m_s_multi * M_nnz;
-        } else { // Or n times if n < s
-            onProcNnz += globalInd * M_nnz;
+    // Extract diagonal blocks
+    int numBlocks = onProcSize / bsize;
+    m_massPrecond.assign(numBlocks * bsize * bsize, 0.0);
+    for (int i = 0; i < onProcSize; i++) {
+        int block = i / bsize;
+        for (int p = diag_i[i]; p < diag_i[i+1]; p++) {
+            if (diag_j[p] / bsize == block) {
+                m_massPrecond[block*bsize*bsize + (i % bsize)*bsize + diag_j[p] % bsize] += diag_data[p];
+            }
         }
     }
     
-    onProcSize = m_nDOFPerProc * spatialDOFs; // Number of rows on process
-    rowptr     = new int[onProcSize + 1];
-    rowptr[0]  = 0; 
-    colinds    = new int[onProcNnz];
-    data       = new double[onProcNnz];
-    B          = new double[onProcSize];
-    V          = new double[onProcSize];
-    
-    int dataInd      = 0;
-    int colOffset    = 0;  // Global index of first column for DOF that we're coupling to
-    int rowptrOffset = 0;  // Offset for accessing rowptr array for each DOF on proc
-    double temp      = 0.0;
+    // Invert them
+    for (int block = 0; block < numBlocks; block++) {
+        if (!InvertDenseMatrix(&m_massPrecond[block*bsize*bsize], bsize)) {
+            std::cout << "WARNING: Mass matrix has a singular diagonal block; cannot set up (block-)Jacobi preconditioner!" << '\n';
+            MPI_Finalize();
+            exit(1);
+        }
+    }
+}
+
+
+/* Apply (block-)Jacobi preconditioner for mass matrix, z <- inv(block diagonal of M)*r */
+void SpaceTimeMatrix::ApplyMassPreconditioner(HYPRE_ParVector r, HYPRE_ParVector z)
+{
+    double * r_data     = hypre_VectorData(hypre_ParVectorLocalVector(r));
+    double * z_data     = hypre_VectorData(hypre_ParVectorLocalVector(z));
+    int      onProcSize = hypre_VectorSize(hypre_ParVectorLocalVector(r));
+    int      bsize      = m_massBsize;
     
+    if (bsize == 1) {
+        for (int i = 0; i < onProcSize; i++) z_data[i] = m_massPrecond[i] * r_data[i];
+        return;
+    }
     
-    /* ----------------------------------------------------- */
-    /* ------ Build block row for all DOFs on process ------ */
-    /* ----------------------------------------------------- */
-    for (int globalInd = globalInd0; globalInd <= globalInd1; globalInd++) {
-        
-        // Rebuild spatial discretization if it's time dependent
-        if (globalInd > globalInd0) {
-            if (m_G_isTimedependent) {
-                delete[] B0;
-                getSpatialDiscretizationG(B0, spatialDOFs, m_t0 + (globalInd+m_s_multi)*m_dt);
-            }
-            
-            if (m_L_isTimedependent) {
-                delete[] L_rowptr;
-                delete[] L_colinds;
-                delete[] L_data;
-                delete[] V0;
-                getSpatialDiscretizationL(L_rowptr, L_colinds, L_data, V0, getV0, spatialDOFs, m_t0 + (globalInd+m_s_multi)*m_dt, m_bsize);            
-            }
+    for (int i0 = 0; i0 < onProcSize; i0 += bsize) {
+        const double * invBlock = &m_massPrecond[i0 * bsize];
+        for (int i = 0; i < bsize; i++) {
+            double sum = 0.0;
+            for (int j = 0; j < bsize; j++) sum += invBlock[i*bsize + j] * r_data[i0 + j];
+            z_data[i0 + i] = sum;
         }
+    }
+}
+
+
+/* Preconditioner callbacks for hypre's PCG: solver is the SpaceTimeMatrix object */
+HYPRE_Int SpaceTimeMatrix::MassPreconditionerSetup(HYPRE_Solver solver, HYPRE_ParCSRMatrix A, 
+                                                   HYPRE_ParVector b, HYPRE_ParVector x)
+{
+    ((SpaceTimeMatrix *) solver)->SetupMassPreconditioner(A);
+    return 0;
+}
+HYPRE_Int SpaceTimeMatrix::MassPreconditionerSolve(HYPRE_Solver solver, HYPRE_ParCSRMatrix A, 
+                                                   HYPRE_ParVector b, HYPRE_ParVector x)
+{
+    ((SpaceTimeMatrix *) solver)->ApplyMassPreconditioner(b, x);
+    return 0;
+}
+
+
+/* Set up Chebyshev iteration for solves with mass matrix m_M, preconditioned by (block) 
+    Jacobi. The preconditioned mass matrix is spectrally equivalent to the identity, so 
+    bounds on its eigenvalues are computed once, and a fixed number of iterations is used 
+    for every solve.
+
+NOTES:
+    -Eigenvalues are estimated from the Lanczos tridiagonal matrix of (at most 20 iterations 
+        of) preconditioned CG. Its extreme eigenvalues lie inside the spectrum, so the 
+        interval is widened by 10% on each side.
+    -Unless set by mass_cheby_iters, the number of iterations is the smallest for which 
+        the Chebyshev error bound, 2*((sqrt(kappa)-1)/(sqrt(kappa)+1))^k, is below tol
+*/
+void SpaceTimeMatrix::SetupMassChebyshev()
+{
+    SetupMassPreconditioner(m_M);
+    
+    // Work vectors r, z, p, q; r is initialized with an arbitrary starting vector for Lanczos
+    int      onProcSize = hypre_CSRMatrixNumRows(hypre_ParCSRMatrixDiag(m_M));
+    int      ilower     = hypre_ParCSRMatrixFirstRowIndex(m_M);
+    double * temp       = new double[onProcSize];
+    for (int i = 0; i < onProcSize; i++) temp[i] = std::sin(1.0 + ilower + i);
+    m_massWork.resize(4);
+    m_massWork_ij.resize(4);
+    for (int k = 0; k < 4; k++) {
+        m_massWork_ij[k] = NULL;
+        GetHypreVectorFromData(m_massWork[k], m_massWork_ij[k], m_spatialComm, temp, ilower, ilower + onProcSize - 1);
+    }
+    delete[] temp;
+    HYPRE_ParVector r = m_massWork[0];
+    HYPRE_ParVector z = m_massWork[1];
+    HYPRE_ParVector p = m_massWork[2];
+    HYPRE_ParVector q = m_massWork[3];
+    
+    /* --- Preconditioned CG for M*x = r, recording coefficients of Lanczos tridiagonal matrix --- */
+    std::vector<double> alpha;
+    std::vector<double> beta;
+    ApplyMassPreconditioner(r, z);
+    HYPRE_ParVectorCopy(z, p);
+    double rz  = hypre_ParVectorInnerProd(r, z);
+    double rz0 = rz;
+    for (int k = 0; k < 20; k++) {
+        hypre_ParCSRMatrixMatvec(1.0, m_M, p, 0.0, q); // q <- M*p
+        alpha.push_back(rz / hypre_ParVectorInnerProd(p, q));
+        HYPRE_ParVectorAxpy(-alpha[k], q, r);
+        ApplyMassPreconditioner(r, z);
+        double rz_new = hypre_ParVectorInnerProd(r, z);
+        if (rz_new <= 1e-28 * rz0) break; // Krylov space is (numerically) invariant
+        beta.push_back(rz_new / rz);
+        rz = rz_new;
+        HYPRE_ParVectorScale(beta[k], p);
+        HYPRE_ParVectorAxpy(1.0, z, p);
+    }
     
-        std::map<int, double>::iterator it;
+    int n = alpha.size();
+    std::vector<double> d(n);
+    std::vector<double> e(std::max(n-1, 0));
+    for (int j = 0; j < n; j++) {
+        d[j] = 1.0 / alpha[j];
+        if (j > 0)   d[j] += beta[j-1] / alpha[j-1];
+        if (j < n-1) e[j]  = std::sqrt(beta[j]) / alpha[j];
+    }
+    m_massEigMin = 0.9 * TridiagonalEigenvalue(d, e, 0);
+    m_massEigMax = 1.1 * TridiagonalEigenvalue(d, e, n-1);
     
-        // Loop over each row in spatial discretization, working from earliest DOFs to the current one
-        for (int row = 0; row < spatialDOFs; row++) {
-            B[rowptrOffset + row] = m_dt*m_b_multi[0]*B0[row]; // PDE source term. NOTE: Only b_s is stored for BDF schemes 
-            V[rowptrOffset + row] = V0[row];                   // Initial guess at solution
-        
-            // Number of previous DOFs current DOF couples to
-            int s_effective = m_s_multi;
-            
-            // First s DOFs only couple to the n times before them rather than all s
-            if (globalInd <= m_s_multi - 1) {
-                s_effective = globalInd;
-                // Add precomputed w[n] vector holding all necessary starting-value information
-                B[rowptrOffset + row] += m_w_multi[globalInd][row];
-            }
-            
-            // Global index of furthest DOF current DOF couples back to
-            colOffset = (globalInd - s_effective) * spatialDOFs;
-            
-            /* ------ Off-block-diagonal component that reaches back s_effective DOFs with mass matrix couplings ------ */
-            for (int j = s_effective; j >= 1; j--)  {
-                // Get mass-matrix data
-                for (int p = M_rowptr[row]; p < M_rowptr[row+1]; p++) {                
-                    data[dataInd]    = m_a_multi[m_s_multi-j]*M_data[p];
-                    colinds[dataInd] = M_colinds[p] + colOffset;
-                    dataInd         += 1;
-                }
-                colOffset += spatialDOFs;
-            }
-        
-            /* ------ Block-diagonal component ------ */
-            std::map<int, double> entries; 
-            // Get mass-matrix data
-            for (int j=M_rowptr[row]; j<M_rowptr[row+1]; j++) {                
-                if (std::abs(M_data[j]) > 1e-16) {
-                    entries[M_colinds[j]] = M_data[j];
-                }
-            }
+    // Number of iterations
+    if (m_solver_parameters.mass_cheby_iters > 0) {
+        m_massChebyIters = m_solver_parameters.mass_cheby_iters;
+    } else {
+        double sqrtKappa = std::sqrt(m_massEigMax / m_massEigMin);
+        double rate      = (sqrtKappa - 1.0) / (sqrtKappa + 1.0);
+        m_massChebyIters = std::max(1, (int) std::ceil(std::log(0.5 * m_solver_parameters.tol) / std::log(rate)));
+    }
+    
+    if (m_spatialRank == 0 && m_solver_parameters.printLevel > 0) {
+        std::cout << "Mass matrix Chebyshev iteration: eigenvalues of preconditioned M in [" << m_massEigMin 
+                    << ", " << m_massEigMax << "], " << m_massChebyIters << " iterations per solve\n";
+    }
+}
 
-            // Add spatial discretization data to mass-matrix data
-            temp = m_dt * m_b_multi[0]; // Note only b_s is stored for BDF schemes
-            for (int j = L_rowptr[row]; j < L_rowptr[row+1]; j++) {
-                if (std::abs(L_data[j]) > 1e-16) {
-                    entries[L_colinds[j]] += temp * L_data[j];
-                }
-            }
 
-            // Add this data to global matrix
-            for (it=entries.begin(); it!=entries.end(); it++) {
-                colinds[dataInd] = it->first + colOffset;
-                data[dataInd]    = it->second;
-                dataInd         += 1;
+/* Solve M*m_x = m_b approximately with a fixed number of Chebyshev iterations, starting from 
+    the initial guess in m_x. No inner products are computed. */
+void SpaceTimeMatrix::SolveMassChebyshev()
+{
+    HYPRE_ParVector r = m_massWork[0];
+    HYPRE_ParVector z = m_massWork[1];
+    HYPRE_ParVector d = m_massWork[2];
+    
+    double theta = 0.5 * (m_massEigMax + m_massEigMin); // Center and half-width of eigenvalue interval
+    double delta = 0.5 * (m_massEigMax - m_massEigMin);
+    double sigma = theta / delta;
+    double rho   = 1.0 / sigma;
+    
+    HYPRE_ParVectorCopy(m_b, r);
+    hypre_ParCSRMatrixMatvec(-1.0, m_M, m_x, 1.0, r); // r <- b - M*x
+    ApplyMassPreconditioner(r, d);
+    HYPRE_ParVectorScale(1.0 / theta, d);
+    
+    for (int k = 0; k < m_massChebyIters; k++) {
+        HYPRE_ParVectorAxpy(1.0, d, m_x);
+        if (k == m_massChebyIters-1) break;
+        
+        hypre_ParCSRMatrixMatvec(-1.0, m_M, d, 1.0, r); // r <- r - M*d
+        ApplyMassPreconditioner(r, z);
+        double rho_new = 1.0 / (2.0 * sigma - rho);
+        HYPRE_ParVectorScale(rho_new * rho, d);
+        HYPRE_ParVectorAxpy(2.0 * rho_new / delta, z, d);
+        rho = rho_new;
+    }
+    m_num_iters = m_massChebyIters;
+}
+
+
+/* Destroy mass matrix preconditioner and Chebyshev work vectors */
+void SpaceTimeMatrix::ClearMassSolver()
+{
+    for (size_t k = 0; k < m_massWork_ij.size(); k++) {
+        if (m_massWork_ij[k]) HYPRE_IJVectorDestroy(m_massWork_ij[k]);
+    }
+    m_massWork.clear();
+    m_massWork_ij.clear();
+    m_massPrecond.clear();
+}
+
+
+/* ----------------------------------------------------------------------------- */
+/* ---------------- Space-time matrix in Kronecker-product form ---------------- */
+/* ----------------------------------------------------------------------------- */
+
+/* Decide whether the space-time matrix can be applied matrix-free rather than assembled.
+
+NOTES:
+    -This requires GMRES without preconditioning or scaling by block inverse (since these
+        need the assembled matrix), no spatial parallelism, and a time-independent L
+*/
+bool SpaceTimeMatrix::UseMatrixFreeOperator()
+{
+    if (!m_solver_parameters.matrix_free) return false;
+    
+    std::string reason = "";
+    if (!m_solver_parameters.use_gmres) {
+        reason = "AMG is used as solver";
+    } else if (m_solver_parameters.gmres_preconditioner >= 1 && m_solver_parameters.gmres_preconditioner <= 3) {
+        reason = "GMRES preconditioner requires the matrix";
+    } else if (m_solver_parameters.binv_scale) {
+        reason = "scaling by block inverse requires the matrix";
+    } else if (m_useSpatialParallel) {
+        reason = "spatial parallelism is used";
+    } else if (m_L_isTimedependent) {
+        reason = "L is time dependent";
+    } else if (!m_RK && !m_BDF) {
+        reason = "time integration scheme is not RK or BDF";
+    }
+    
+    if (reason != "") {
+        if (m_globRank == 0) std::cout << "Space-time matrix cannot be applied matrix-free (" << reason << "); assembling it.\n";
+        return false;
+    }
+    return true;
+}
+
+
+/* Decide whether the space-time matrix can be stored in Kronecker-product form, and only 
+    expanded into a hypre matrix one block row at a time. This requires no spatial 
+    parallelism and a time-independent L. */
+bool SpaceTimeMatrix::UseKroneckerStorage()
+{
+    if (!m_solver_parameters.kron_storage) return false;
+    
+    std::string reason = "";
+    if (m_useSpatialParallel) {
+        reason = "spatial parallelism is used";
+    } else if (m_L_isTimedependent) {
+        reason = "L is time dependent";
+    } else if (!m_RK && !m_BDF) {
+        reason = "time integration scheme is not RK or BDF";
+    }
+    
+    if (reason != "") {
+        if (m_globRank == 0) std::cout << "Space-time matrix cannot be stored in Kronecker form (" << reason << "); assembling it.\n";
+        return false;
+    }
+    return true;
+}
+
+
+/* Store the space-time matrix in Kronecker-product form: The mass matrix, spatial 
+    discretization, and the couplings between temporal DOFs on process. Also set up 
+    communication of the halo of DOFs on other processes that DOFs on this process couple to.
+
+NOTES:
+    -The coefficients are those used when assembling the block rows in RKSpaceTimeBlock
+        and BDFSpaceTimeBlock.
+    -Entries of M and L with magnitude <= 1e-16 are not stored, as they're dropped from 
+        their merged pattern. So, the matrix-free matvec applies the same matrix as that 
+        expanded from the pattern.
+    -Must be called by all processes in global communicator.
+*/
+void SpaceTimeMatrix::SetKroneckerOperator(int      spatialDOFs,
+                                            int    * M_rowptr, 
+                                            int    * M_colinds, 
+                                            double * M_data, 
+                                            int    * L_rowptr, 
+                                            int    * L_colinds, 
+                                            double * L_data)
+{
+    m_kron.spatialDOFs = spatialDOFs;
+    m_kron.M_rowptr.assign(1, 0);
+    m_kron.M_colinds.clear();
+    m_kron.M_data.clear();
+    m_kron.L_rowptr.assign(1, 0);
+    m_kron.L_colinds.clear();
+    m_kron.L_data.clear();
+    for (int row = 0; row < spatialDOFs; row++) {
+        for (int j = M_rowptr[row]; j < M_rowptr[row+1]; j++) {
+            if (std::abs(M_data[j]) <= 1e-16) continue;
+            m_kron.M_colinds.push_back(M_colinds[j]);
+            m_kron.M_data.push_back(M_data[j]);
+        }
+        for (int j = L_rowptr[row]; j < L_rowptr[row+1]; j++) {
+            if (std::abs(L_data[j]) <= 1e-16) continue;
+            m_kron.L_colinds.push_back(L_colinds[j]);
+            m_kron.L_data.push_back(L_data[j]);
+        }
+        m_kron.M_rowptr.push_back(m_kron.M_colinds.size());
+        m_kron.L_rowptr.push_back(m_kron.L_colinds.size());
+    }
+    GetMLPattern(m_kron.ML, spatialDOFs, &m_kron.M_rowptr[0], &m_kron.M_colinds[0], &m_kron.M_data[0], 
+                    &m_kron.L_rowptr[0], &m_kron.L_colinds[0], &m_kron.L_data[0]);
+    
+    m_kron.coupling_ptr.assign(1, 0);
+    m_kron.coupling_DOF.clear();
+    m_kron.coupling_M.clear();
+    m_kron.coupling_L.clear();
+    
+    int globalInd0 = m_globRank * m_nDOFPerProc;    // Index of first DOF on process
+    double temp;
+    
+    /* --- Couplings of each DOF on process: (c_M*M + c_L*L) applied to DOF coupling_DOF --- */
+    for (int globalInd = globalInd0; globalInd < globalInd0 + m_nDOFPerProc; globalInd++) {
+        if (m_RK) {
+            int localInd    = globalInd % m_s_butcher;
+            int blockInd    = globalInd / m_s_butcher;
+            int blockStart  = blockInd * m_s_butcher; // Global index of first DOF in block
+            
+            // Solution-type DOF
+            if (localInd == m_s_butcher-1) {
+                // Solution at previous time: -(M + dt*(a_ss - b_s)*L)
+                if (blockInd > 0) {
+                    temp = m_A_butcher[m_s_butcher-1][m_s_butcher-1] - m_b_butcher[m_s_butcher-1];
+                    m_kron.coupling_DOF.push_back(blockStart - 1);
+                    m_kron.coupling_M.push_back(-1.0);
+                    m_kron.coupling_L.push_back(-temp * m_dt);
+                }
+                // Stages: -(dt*b_i*M + dt^2*(b_i*a_ss - b_s*a_si)*L)
+                for (int i = 0; i < m_s_butcher - 1; i++) {
+                    temp = m_b_butcher[i] * m_A_butcher[m_s_butcher-1][m_s_butcher-1] - m_b_butcher[m_s_butcher-1] * m_A_butcher[m_s_butcher-1][i];
+                    m_kron.coupling_DOF.push_back(blockStart + i);
+                    m_kron.coupling_M.push_back(-m_b_butcher[i] * m_dt);
+                    m_kron.coupling_L.push_back(-temp * (m_dt * m_dt));
+                }
+            
+            // Stage-type DOF
+            } else {
+                // Solution at previous time: L
+                if (blockInd > 0) {
+                    m_kron.coupling_DOF.push_back(blockStart - 1);
+                    m_kron.coupling_M.push_back(0.0);
+                    m_kron.coupling_L.push_back(1.0);
+                }
+                // Previous stages: dt*a_ij*L
+                for (int j = 0; j < localInd; j++) {
+                    if (m_A_butcher[localInd][j] != 0.0) {
+                        m_kron.coupling_DOF.push_back(blockStart + j);
+                        m_kron.coupling_M.push_back(0.0);
+                        m_kron.coupling_L.push_back(m_A_butcher[localInd][j] * m_dt);
+                    }
+                }
+            }
+            
+            // Myself: M + dt*a_ii*L
+            m_kron.coupling_DOF.push_back(globalInd);
+            m_kron.coupling_M.push_back(1.0);
+            m_kron.coupling_L.push_back(m_A_butcher[localInd][localInd] * m_dt);
+            
+        } else if (m_BDF) {
+            // Previous s DOFs, or n DOFs if n < s: a_j*M
+            int s_effective = (globalInd <= m_s_multi - 1) ? globalInd : m_s_multi;
+            for (int j = s_effective; j >= 1; j--) {
+                m_kron.coupling_DOF.push_back(globalInd - j);
+                m_kron.coupling_M.push_back(m_a_multi[m_s_multi-j]);
+                m_kron.coupling_L.push_back(0.0);
+            }
+            
+            // Myself: M + dt*b_s*L. NOTE: Only b_s is stored for BDF schemes
+            m_kron.coupling_DOF.push_back(globalInd);
+            m_kron.coupling_M.push_back(1.0);
+            m_kron.coupling_L.push_back(m_dt * m_b_multi[0]);
+        }
+        m_kron.coupling_ptr.push_back(m_kron.coupling_DOF.size());
+    }
+    
+    /* --- Set up halo exchange --- */
+    // First DOF coupled to by each process
+    m_kron.haloDOF0 = globalInd0;
+    for (size_t i = 0; i < m_kron.coupling_DOF.size(); i++) {
+        m_kron.haloDOF0 = std::min(m_kron.haloDOF0, m_kron.coupling_DOF[i]);
+    }
+    std::vector<int> haloDOF0(m_numProc);
+    MPI_Allgather(&m_kron.haloDOF0, 1, MPI_INT, &haloDOF0[0], 1, MPI_INT, m_globComm);
+    
+    m_kron.halo.assign((globalInd0 - m_kron.haloDOF0) * spatialDOFs, 0.0);
+    m_kron.send_rank.clear();
+    m_kron.send_DOF0.clear();
+    m_kron.send_nDOF.clear();
+    m_kron.recv_rank.clear();
+    m_kron.recv_DOF0.clear();
+    m_kron.recv_nDOF.clear();
+    
+    // DOFs on this process needed by later processes
+    for (int rank = m_globRank + 1; rank < m_numProc; rank++) {
+        int DOF0 = std::max(haloDOF0[rank], globalInd0);
+        int DOF1 = globalInd0 + m_nDOFPerProc - 1; 
+        if (DOF0 > DOF1) break;
+        m_kron.send_rank.push_back(rank);
+        m_kron.send_DOF0.push_back(DOF0);
+        m_kron.send_nDOF.push_back(DOF1 - DOF0 + 1);
+    }
+    
+    // DOFs on earlier processes needed by this process
+    for (int rank = m_globRank - 1; rank >= 0; rank--) {
+        int DOF0 = std::max(m_kron.haloDOF0, rank * m_nDOFPerProc);
+        int DOF1 = (rank + 1) * m_nDOFPerProc - 1; 
+        if (DOF0 > DOF1) break;
+        m_kron.recv_rank.push_back(rank);
+        m_kron.recv_DOF0.push_back(DOF0);
+        m_kron.recv_nDOF.push_back(DOF1 - DOF0 + 1);
+    }
+}
+
+
+/* Expand block row of the DOF with index indOnProc on process from Kronecker-product 
+    form into CSR structure with global column indices.
+
+NOTES:
+    -Entries of the merged pattern of M and L are summed in each block, and entries 
+        of L with magnitude <= 1e-16 are dropped. So, the CSR structure is the same as 
+        that from RKSpaceTimeBlock/BDFSpaceTimeBlock up to explicit zeros and the 
+        ordering of repeated column indices.
+    -Arrays are allocated here and must be deleted by the caller.
+*/
+void SpaceTimeMatrix::GetKroneckerBlockRow(int       indOnProc, 
+                                           int    * &rowptr, 
+                                           int    * &colinds, 
+                                           double * &data)
+{
+    int spatialDOFs = m_kron.spatialDOFs;
+    
+    // Couplings to expand. The coupling to myself is always stored last
+    int c0 = m_kron.coupling_ptr[indOnProc];
+    int c1 = m_kron.coupling_ptr[indOnProc+1];
+    
+    int nnz = 0;
+    for (int c = c0; c < c1; c++) {
+        nnz += MLCouplingNnz(m_kron.ML, m_kron.coupling_M[c] != 0.0, m_kron.coupling_L[c] != 0.0);
+    }
+    
+    rowptr    = new int[spatialDOFs + 1];
+    colinds   = new int[nnz];
+    data      = new double[nnz];
+    rowptr[0] = 0;
+    
+    int dataInd = 0;
+    for (int row = 0; row < spatialDOFs; row++) {
+        for (int c = c0; c < c1; c++) {
+            FillMLRow(m_kron.ML, row, m_kron.coupling_M[c] != 0.0, m_kron.coupling_M[c], 
+                        m_kron.coupling_L[c] != 0.0, m_kron.coupling_L[c], &m_kron.M_data[0], 
+                        &m_kron.L_data[0], m_kron.coupling_DOF[c] * spatialDOFs, 1.0, colinds, data, dataInd);
+        }
+        rowptr[row+1] = dataInd;
+    }
+}
+
+
+/* Expand space-time matrix from Kronecker-product form into the hypre matrix m_A, one 
+    block row at a time, so that only a single block row is held outside of hypre. If 
+    refresh == true, the values of the existing m_A are rewritten instead, unless its 
+    structure has changed on some process. */
+void SpaceTimeMatrix::MaterializeKroneckerMatrix(int  ilower, 
+                                                 int  iupper,
+                                                 bool refresh)
+{
+    int spatialDOFs = m_kron.spatialDOFs;
+    
+    // Rewrite values of existing matrix if its structure is unchanged on all processes
+    if (refresh) {
+        int valuesSet = 1;
+        for (int indOnProc = 0; valuesSet && indOnProc < m_nDOFPerProc; indOnProc++) {
+            int    * rowptr;
+            int    * colinds;
+            double * data;
+            GetKroneckerBlockRow(indOnProc, rowptr, colinds, data);
+            
+            int rowOffset = ilower + indOnProc*spatialDOFs;
+            valuesSet = SetHypreMatrixValuesFromCRSData(m_A, rowptr, colinds, data, rowOffset, rowOffset + spatialDOFs - 1);
+            
+            delete[] rowptr;
+            delete[] colinds;
+            delete[] data;
+        }
+        MPI_Allreduce(MPI_IN_PLACE, &valuesSet, 1, MPI_INT, MPI_MIN, m_globComm);
+        if (valuesSet) return;
+        if (m_globRank == 0) std::cout << "Structure of space-time matrix has changed; rebuilding it.\n";
+    }
+    
+    if (m_Aij) HYPRE_IJMatrixDestroy(m_Aij);
+    
+    /* --- Count nnz in diagonal and off-diagonal blocks from the couplings --- */
+    // Each coupling is a whole spatial block, in the diagonal block if its DOF is on process
+    int globalInd0 = m_globRank * m_nDOFPerProc; // Index of first DOF on process
+    int diag_nnz   = 0;
+    int offd_nnz   = 0;
+    std::map<int, std::pair<bool, bool>> offd_DOFs; // Whether off-process DOFs are coupled through M and L
+    for (size_t c = 0; c < m_kron.coupling_DOF.size(); c++) {
+        bool useM = m_kron.coupling_M[c] != 0.0;
+        bool useL = m_kron.coupling_L[c] != 0.0;
+        int  DOF  = m_kron.coupling_DOF[c];
+        if (DOF >= globalInd0 && DOF < globalInd0 + m_nDOFPerProc) {
+            diag_nnz += MLCouplingNnz(m_kron.ML, useM, useL);
+        } else {
+            offd_nnz += MLCouplingNnz(m_kron.ML, useM, useL);
+            offd_DOFs[DOF].first  |= useM;
+            offd_DOFs[DOF].second |= useL;
+        }
+    }
+    
+    // Global indices of off-diagonal columns: Spatial columns of pattern used by each off-process DOF
+    std::vector<int> offd_cols;
+    std::vector<int> spatialCols;
+    for (std::map<int, std::pair<bool, bool>>::iterator it = offd_DOFs.begin(); it != offd_DOFs.end(); ++it) {
+        spatialCols.clear();
+        for (size_t slot = 0; slot < m_kron.ML.colinds.size(); slot++) {
+            bool hasM = it->second.first && m_kron.ML.M_ind[slot] >= 0;
+            bool hasL = it->second.second && m_kron.ML.L_ptr[slot] < m_kron.ML.L_ptr[slot+1];
+            if (hasM || hasL) spatialCols.push_back(m_kron.ML.colinds[slot]);
+        }
+        std::sort(spatialCols.begin(), spatialCols.end());
+        spatialCols.erase(std::unique(spatialCols.begin(), spatialCols.end()), spatialCols.end());
+        for (size_t i = 0; i < spatialCols.size(); i++) offd_cols.push_back(it->first * spatialDOFs + spatialCols[i]);
+    }
+    
+    /* --- Split each block row into the diagonal and off-diagonal blocks --- */
+    CreateHypreMatrix(m_A, m_globComm, ilower, iupper, diag_nnz, offd_nnz, offd_cols);
+    for (int indOnProc = 0; indOnProc < m_nDOFPerProc; indOnProc++) {
+        int    * rowptr;
+        int    * colinds;
+        double * data;
+        GetKroneckerBlockRow(indOnProc, rowptr, colinds, data);
+        
+        int rowOffset = ilower + indOnProc*spatialDOFs;
+        FillHypreMatrixRows(m_A, offd_cols, rowptr, colinds, data, rowOffset, rowOffset + spatialDOFs - 1);
+        
+        delete[] rowptr;
+        delete[] colinds;
+        delete[] data;
+    }
+    FinalizeHypreMatrix(m_A, m_Aij, m_globComm, ilower, iupper);
+}
+
+
+/* Apply space-time matrix without assembling it: y <- alpha*A*x + beta*y.
+
+NOTES:
+    -The halo of x required by this process is first received from earlier processes
+    -Must be called by all processes in global communicator.
+*/
+void SpaceTimeMatrix::MatrixFreeMatvec(double          alpha, 
+                                       HYPRE_ParVector x, 
+                                       double          beta, 
+                                       HYPRE_ParVector y)
+{
+    int      spatialDOFs = m_kron.spatialDOFs;
+    int      globalInd0  = m_globRank * m_nDOFPerProc;
+    double * x_data      = hypre_VectorData(hypre_ParVectorLocalVector(x));
+    double * y_data      = hypre_VectorData(hypre_ParVectorLocalVector(y));
+    
+    /* --- Exchange halo --- */
+    int numRequests = m_kron.send_rank.size() + m_kron.recv_rank.size();
+    std::vector<MPI_Request> requests(numRequests);
+    int requestInd = 0;
+    for (size_t i = 0; i < m_kron.recv_rank.size(); i++) {
+        MPI_Irecv(&m_kron.halo[(m_kron.recv_DOF0[i] - m_kron.haloDOF0) * spatialDOFs], m_kron.recv_nDOF[i] * spatialDOFs, 
+                    MPI_DOUBLE, m_kron.recv_rank[i], 0, m_globComm, &requests[requestInd++]);
+    }
+    for (size_t i = 0; i < m_kron.send_rank.size(); i++) {
+        MPI_Isend(&x_data[(m_kron.send_DOF0[i] - globalInd0) * spatialDOFs], m_kron.send_nDOF[i] * spatialDOFs, 
+                    MPI_DOUBLE, m_kron.send_rank[i], 0, m_globComm, &requests[requestInd++]);
+    }
+    if (numRequests > 0) MPI_Waitall(numRequests, &requests[0], MPI_STATUSES_IGNORE);
+    
+    /* --- Apply block rows of DOFs on process --- */
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < m_nDOFPerProc * spatialDOFs; i++) {
+        int indOnProc = i / spatialDOFs;
+        int row       = i % spatialDOFs;
+        double sum    = 0.0;
+        
+        for (int c = m_kron.coupling_ptr[indOnProc]; c < m_kron.coupling_ptr[indOnProc+1]; c++) {
+            // Values of x at DOF being coupled to
+            const double * x_DOF;
+            if (m_kron.coupling_DOF[c] >= globalInd0) {
+                x_DOF = &x_data[(m_kron.coupling_DOF[c] - globalInd0) * spatialDOFs];
+            } else {
+                x_DOF = &m_kron.halo[(m_kron.coupling_DOF[c] - m_kron.haloDOF0) * spatialDOFs];
+            }
+            
+            if (m_kron.coupling_M[c] != 0.0) {
+                for (int p = m_kron.M_rowptr[row]; p < m_kron.M_rowptr[row+1]; p++) {
+                    sum += m_kron.coupling_M[c] * m_kron.M_data[p] * x_DOF[m_kron.M_colinds[p]];
+                }
+            }
+            if (m_kron.coupling_L[c] != 0.0) {
+                for (int p = m_kron.L_rowptr[row]; p < m_kron.L_rowptr[row+1]; p++) {
+                    sum += m_kron.coupling_L[c] * m_kron.L_data[p] * x_DOF[m_kron.L_colinds[p]];
+                }
+            }
+        }
+        
+        // Don't read y if beta is zero, since it may not be initialized
+        if (beta == 0.0) y_data[i] = alpha * sum;
+        else             y_data[i] = alpha * sum + beta * y_data[i];
+    }
+}
+
+
+/* Create GMRES solver that applies the space-time matrix matrix-free. The "matrix"
+    passed to this solver is the SpaceTimeMatrix object itself, and all other 
+    operations use the standard ParCSR Krylov functions. */
+void SpaceTimeMatrix::MatrixFreeGMRESCreate()
+{
+    hypre_GMRESFunctions * gmres_functions = 
+        hypre_GMRESFunctionsCreate(hypre_CAlloc, hypre_ParKrylovFree, MatrixFreeCommInfo,
+                                   hypre_ParKrylovCreateVector, hypre_ParKrylovCreateVectorArray,
+                                   hypre_ParKrylovDestroyVector, MatrixFreeMatvecCreate,
+                                   MatrixFreeMatvecCompute, MatrixFreeMatvecDestroy,
+                                   hypre_ParKrylovInnerProd, hypre_ParKrylovCopyVector,
+                                   hypre_ParKrylovClearVector, hypre_ParKrylovScaleVector,
+                                   hypre_ParKrylovAxpy, hypre_ParKrylovIdentitySetup,
+                                   hypre_ParKrylovIdentity);
+    m_gmres = (HYPRE_Solver) hypre_GMRESCreate(gmres_functions);
+}
+
+
+/* Matrix-free callbacks for hypre's generic GMRES: A is the SpaceTimeMatrix object */
+HYPRE_Int SpaceTimeMatrix::MatrixFreeCommInfo(void *A, HYPRE_Int *my_id, HYPRE_Int *num_procs)
+{
+    SpaceTimeMatrix * STmatrix = (SpaceTimeMatrix *) A;
+    MPI_Comm_rank(STmatrix->m_globComm, my_id);
+    MPI_Comm_size(STmatrix->m_globComm, num_procs);
+    return 0;
+}
+void * SpaceTimeMatrix::MatrixFreeMatvecCreate(void *A, void *x)
+{
+    return NULL;
+}
+HYPRE_Int SpaceTimeMatrix::MatrixFreeMatvecCompute(void *matvec_data, HYPRE_Complex alpha, void *A, 
+                                                   void *x, HYPRE_Complex beta, void *y)
+{
+    ((SpaceTimeMatrix *) A)->MatrixFreeMatvec(alpha, (HYPRE_ParVector) x, beta, (HYPRE_ParVector) y);
+    return 0;
+}
+HYPRE_Int SpaceTimeMatrix::MatrixFreeMatvecDestroy(void *matvec_data)
+{
+    return 0;
+}
+
+
+/* ----------------------------------------------------------------------------- */
+/* ------------- Block forward-substitution preconditioner for GMRES ------------- */
+/* ----------------------------------------------------------------------------- */
+
+/* Decide whether GMRES is preconditioned by block forward substitution. This requires the 
+    space-time system (not a spatial system solved during time-stepping, e.g., for 
+    multistep starting values) and no spatial parallelism; otherwise AMG is used. */
+bool SpaceTimeMatrix::UseBlockForwardSubstitution()
+{
+    if (m_solver_parameters.gmres_preconditioner != 3) return false;
+    if (!m_pit || m_solverComm != m_globComm) return false; 
+    
+    if (m_useSpatialParallel) {
+        if (m_globRank == 0) std::cout << "Block forward substitution cannot be used with spatial parallelism; preconditioning with AMG.\n";
+        return false;
+    }
+    return true;
+}
+
+
+/* Set up block forward-substitution preconditioner for space-time matrix A 
+
+NOTES:
+    -The diagonal block of each temporal DOF on process is extracted from A, and an AMG 
+        solver is set up for each distinct block. Blocks equal to one from a previous 
+        setup (e.g., of a space-time matrix whose values have been refreshed) keep its solver.
+    -Entries of A coupling a DOF to later DOFs are ignored.
+    -A block solve is m_solver_parameters.AMGiters AMG iterations from a zero initial guess.
+*/
+void SpaceTimeMatrix::SetupBlockForwardSubstitution(HYPRE_ParCSRMatrix A)
+{
+    BlockFS_preconditioner &pre = m_blockFS;
+    
+    hypre_CSRMatrix * diag         = hypre_ParCSRMatrixDiag(A);
+    hypre_CSRMatrix * offd         = hypre_ParCSRMatrixOffd(A);
+    HYPRE_Int       * diag_i       = hypre_CSRMatrixI(diag);
+    HYPRE_Int       * diag_j       = hypre_CSRMatrixJ(diag);
+    HYPRE_Complex   * diag_data    = hypre_CSRMatrixData(diag);
+    HYPRE_BigInt    * col_map_offd = hypre_ParCSRMatrixColMapOffd(A);
+    int               onProcSize   = hypre_CSRMatrixNumRows(diag);
+    int               firstRow     = hypre_ParCSRMatrixFirstRowIndex(A);
+    
+    int spatialDOFs = onProcSize / m_nDOFPerProc;
+    if (spatialDOFs != pre.spatialDOFs) {
+        ClearBlockForwardSubstitution();
+        double * zeros = new double[spatialDOFs]();
+        GetHypreVectorFromData(pre.r, pre.rij, MPI_COMM_SELF, zeros, 0, spatialDOFs-1);
+        GetHypreVectorFromData(pre.z, pre.zij, MPI_COMM_SELF, zeros, 0, spatialDOFs-1);
+        delete[] zeros;
+    }
+    pre.spatialDOFs = spatialDOFs;
+    pre.nBlocks     = m_nDOFPerProc;
+    
+    /* --- Find diagonal block of each DOF among distinct blocks, adding it if it's new --- */
+    for (size_t i = 0; i < pre.systems.size(); i++) pre.systems[i].used = false;
+    pre.blockSystem.resize(pre.nBlocks);
+    
+    BlockFS_system block;
+    block.rowptr.resize(spatialDOFs + 1);
+    for (int blockInd = 0; blockInd < pre.nBlocks; blockInd++) {
+        int col0 = blockInd * spatialDOFs;
+        block.rowptr[0] = 0;
+        block.colinds.clear();
+        block.data.clear();
+        for (int i = 0; i < spatialDOFs; i++) {
+            for (int p = diag_i[col0 + i]; p < diag_i[col0 + i + 1]; p++) {
+                if (diag_j[p] >= col0 && diag_j[p] < col0 + spatialDOFs) {
+                    block.colinds.push_back(diag_j[p] - col0);
+                    block.data.push_back(diag_data[p]);
+                }
+            }
+            block.rowptr[i+1] = block.colinds.size();
+        }
+        
+        int systemInd = -1;
+        for (size_t i = 0; i < pre.systems.size(); i++) {
+            if (pre.systems[i].rowptr == block.rowptr && pre.systems[i].colinds == block.colinds 
+                    && pre.systems[i].data == block.data) {
+                systemInd = i;
+                break;
+            }
+        }
+        if (systemInd == -1) {
+            block.Aij = NULL;
+            block.amg = NULL;
+            GetHypreMatrixFromCRSData(block.A, block.Aij, MPI_COMM_SELF, &block.rowptr[0], &block.colinds[0], 
+                                        &block.data[0], 0, spatialDOFs-1);
+            pre.systems.push_back(block);
+            systemInd = pre.systems.size() - 1;
+        }
+        pre.systems[systemInd].used = true;
+        pre.blockSystem[blockInd]   = systemInd;
+    }
+    
+    // Destroy blocks no longer used, and set up AMG solvers of new ones
+    std::vector<int> newInd(pre.systems.size(), -1);
+    int numSystems = 0;
+    for (size_t i = 0; i < pre.systems.size(); i++) {
+        if (!pre.systems[i].used) {
+            if (pre.systems[i].amg) HYPRE_BoomerAMGDestroy(pre.systems[i].amg);
+            HYPRE_IJMatrixDestroy(pre.systems[i].Aij);
+            continue;
+        }
+        if (!pre.systems[i].amg) {
+            CreateBoomerAMG(pre.systems[i].amg, 0, m_solver_parameters.AMGiters, 0.0);
+            HYPRE_BoomerAMGSetup(pre.systems[i].amg, pre.systems[i].A, pre.r, pre.z);
+        }
+        newInd[i] = numSystems;
+        pre.systems[numSystems++] = pre.systems[i];
+    }
+    pre.systems.resize(numSystems);
+    for (int blockInd = 0; blockInd < pre.nBlocks; blockInd++) {
+        pre.blockSystem[blockInd] = newInd[pre.blockSystem[blockInd]];
+    }
+    
+    /* --- Values needed from earlier processes, and values needed by later processes --- */
+    // Columns of earlier DOFs are those before the first row on process
+    int numColsOffd = hypre_CSRMatrixNumCols(offd);
+    pre.numLowerCols = 0;
+    while (pre.numLowerCols < numColsOffd && col_map_offd[pre.numLowerCols] < firstRow) pre.numLowerCols++;
+    pre.lowerValues.resize(pre.numLowerCols);
+    
+    // Columns are sorted, so those on each process are contiguous
+    std::vector<int> sendCounts(m_numProc, 0);
+    pre.recv_rank.clear();
+    pre.recv_ptr.clear();
+    for (int k = 0; k < pre.numLowerCols; k++) {
+        int owner = col_map_offd[k] / onProcSize;
+        if (pre.recv_rank.empty() || pre.recv_rank.back() != owner) {
+            pre.recv_rank.push_back(owner);
+            pre.recv_ptr.push_back(k);
+        }
+        sendCounts[owner]++;
+    }
+    pre.recv_ptr.push_back(pre.numLowerCols);
+    
+    // Tell earlier processes which of their rows are needed
+    std::vector<int> recvCounts(m_numProc);
+    MPI_Alltoall(&sendCounts[0], 1, MPI_INT, &recvCounts[0], 1, MPI_INT, m_globComm);
+    std::vector<int> sendDispls(m_numProc + 1, 0);
+    std::vector<int> recvDispls(m_numProc + 1, 0);
+    for (int q = 0; q < m_numProc; q++) {
+        sendDispls[q+1] = sendDispls[q] + sendCounts[q];
+        recvDispls[q+1] = recvDispls[q] + recvCounts[q];
+    }
+    std::vector<int> neededCols(col_map_offd, col_map_offd + pre.numLowerCols);
+    pre.send_rows.resize(recvDispls[m_numProc]);
+    MPI_Alltoallv(neededCols.data(), &sendCounts[0], &sendDispls[0], MPI_INT, 
+                    pre.send_rows.data(), &recvCounts[0], &recvDispls[0], MPI_INT, m_globComm);
+    
+    pre.send_rank.clear();
+    pre.send_ptr.assign(1, 0);
+    for (int q = 0; q < m_numProc; q++) {
+        if (recvCounts[q] == 0) continue;
+        pre.send_rank.push_back(q);
+        pre.send_ptr.push_back(recvDispls[q+1]);
+    }
+    for (size_t i = 0; i < pre.send_rows.size(); i++) pre.send_rows[i] -= firstRow;
+    pre.send_values.resize(pre.send_rows.size());
+    
+    if (m_globRank == 0 && m_solver_parameters.printLevel > 0) {
+        std::cout << "Block forward substitution: " << pre.systems.size() << " distinct diagonal block(s) of " 
+                    << pre.nBlocks << " on process 0\n";
+    }
+}
+
+
+/* Apply block forward-substitution preconditioner, x <- approximately inv(A)*b, where A is 
+    the space-time matrix it was set up for. Each process waits for the values of the 
+    solution at earlier DOFs it's coupled to, sweeps through its DOFs, and then sends the 
+    values needed by later processes, so the sweep is pipelined across processes. */
+void SpaceTimeMatrix::ApplyBlockForwardSubstitution(HYPRE_ParCSRMatrix A, 
+                                                    HYPRE_ParVector    b, 
+                                                    HYPRE_ParVector    x)
+{
+    BlockFS_preconditioner &pre = m_blockFS;
+    
+    hypre_CSRMatrix * diag        = hypre_ParCSRMatrixDiag(A);
+    hypre_CSRMatrix * offd        = hypre_ParCSRMatrixOffd(A);
+    HYPRE_Int       * diag_i      = hypre_CSRMatrixI(diag);
+    HYPRE_Int       * diag_j      = hypre_CSRMatrixJ(diag);
+    HYPRE_Complex   * diag_data   = hypre_CSRMatrixData(diag);
+    HYPRE_Int       * offd_i      = hypre_CSRMatrixI(offd);
+    HYPRE_Int       * offd_j      = hypre_CSRMatrixJ(offd);
+    HYPRE_Complex   * offd_data   = hypre_CSRMatrixData(offd);
+    double          * b_data      = hypre_VectorData(hypre_ParVectorLocalVector(b));
+    double          * x_data      = hypre_VectorData(hypre_ParVectorLocalVector(x));
+    double          * r_data      = hypre_VectorData(hypre_ParVectorLocalVector(pre.r));
+    double          * z_data      = hypre_VectorData(hypre_ParVectorLocalVector(pre.z));
+    int               spatialDOFs = pre.spatialDOFs;
+    
+    // Wait for values at earlier DOFs
+    std::vector<MPI_Request> requests(std::max(pre.recv_rank.size(), pre.send_rank.size()));
+    for (size_t i = 0; i < pre.recv_rank.size(); i++) {
+        MPI_Irecv(&pre.lowerValues[pre.recv_ptr[i]], pre.recv_ptr[i+1] - pre.recv_ptr[i], 
+                    MPI_DOUBLE, pre.recv_rank[i], 0, m_globComm, &requests[i]);
+    }
+    if (pre.recv_rank.size() > 0) MPI_Waitall(pre.recv_rank.size(), &requests[0], MPI_STATUSES_IGNORE);
+    
+    /* --- Sweep through DOFs on process --- */
+    for (int blockInd = 0; blockInd < pre.nBlocks; blockInd++) {
+        int col0 = blockInd * spatialDOFs;
+        
+        // r <- b - (coupling to earlier DOFs)*x
+        for (int i = 0; i < spatialDOFs; i++) {
+            int    row = col0 + i;
+            double sum = b_data[row];
+            for (int p = diag_i[row]; p < diag_i[row+1]; p++) {
+                if (diag_j[p] < col0) sum -= diag_data[p] * x_data[diag_j[p]];
+            }
+            for (int p = offd_i[row]; p < offd_i[row+1]; p++) {
+                if (offd_j[p] < pre.numLowerCols) sum -= offd_data[p] * pre.lowerValues[offd_j[p]];
+            }
+            r_data[i] = sum;
+            z_data[i] = 0.0;
+        }
+        
+        // x <- approximately inv(diagonal block)*r
+        BlockFS_system &system = pre.systems[pre.blockSystem[blockInd]];
+        HYPRE_BoomerAMGSolve(system.amg, system.A, pre.r, pre.z);
+        std::copy(z_data, z_data + spatialDOFs, x_data + col0);
+    }
+    
+    // Send values needed at later DOFs
+    for (size_t i = 0; i < pre.send_rows.size(); i++) pre.send_values[i] = x_data[pre.send_rows[i]];
+    for (size_t i = 0; i < pre.send_rank.size(); i++) {
+        MPI_Isend(&pre.send_values[pre.send_ptr[i]], pre.send_ptr[i+1] - pre.send_ptr[i], 
+                    MPI_DOUBLE, pre.send_rank[i], 0, m_globComm, &requests[i]);
+    }
+    if (pre.send_rank.size() > 0) MPI_Waitall(pre.send_rank.size(), &requests[0], MPI_STATUSES_IGNORE);
+}
+
+
+/* Destroy block forward-substitution preconditioner */
+void SpaceTimeMatrix::ClearBlockForwardSubstitution()
+{
+    BlockFS_preconditioner &pre = m_blockFS;
+    for (size_t i = 0; i < pre.systems.size(); i++) {
+        if (pre.systems[i].amg) HYPRE_BoomerAMGDestroy(pre.systems[i].amg);
+        HYPRE_IJMatrixDestroy(pre.systems[i].Aij);
+    }
+    pre.systems.clear();
+    if (pre.rij) HYPRE_IJVectorDestroy(pre.rij);
+    if (pre.zij) HYPRE_IJVectorDestroy(pre.zij);
+    pre.rij         = NULL;
+    pre.zij         = NULL;
+    pre.spatialDOFs = 0;
+}
+
+
+/* Preconditioner callbacks for hypre's GMRES: solver is the SpaceTimeMatrix object */
+HYPRE_Int SpaceTimeMatrix::BlockForwardSubstitutionSetup(HYPRE_Solver solver, HYPRE_ParCSRMatrix A, 
+                                                         HYPRE_ParVector b, HYPRE_ParVector x)
+{
+    ((SpaceTimeMatrix *) solver)->SetupBlockForwardSubstitution(A);
+    return 0;
+}
+HYPRE_Int SpaceTimeMatrix::BlockForwardSubstitutionSolve(HYPRE_Solver solver, HYPRE_ParCSRMatrix A, 
+                                                         HYPRE_ParVector b, HYPRE_ParVector x)
+{
+    ((SpaceTimeMatrix *) solver)->ApplyBlockForwardSubstitution(A, b, x);
+    return 0;
+}
+
+
+/* ----------------------------------------------------------------------------- */
+/* ------ Cache of spatial discretizations evaluated at different times ------ */
+/* ----------------------------------------------------------------------------- */
+
+/* Set memory budget of the cache of spatial discretizations. A budget of 0 means only 
+    the most recently used L and G are held. */
+void SpaceTimeMatrix::SetSpatialDiscretizationCacheSize(double megabytes)
+{
+    m_cache_budget = megabytes * 1024 * 1024;
+}
+
+
+/* Get spatial discretization L (and initial guess U0) at time t, reusing the one 
+    stored in the cache if L has previously been evaluated at t. No spatial parallelism.
+    
+NOTES:
+    -The returned arrays are owned by the cache (or lent to it by the spatial 
+        discretization) and must not be deleted. They remain valid until the next 
+        call to GetCachedSpatialDiscretizationL, or until the cache is unpinned if 
+        m_cache_pinned is set.
+    -Times are considered equal if they differ by less than 1e-10*dt, so that, e.g., 
+        t_n + dt and t_{n+1} are identified.
+*/
+void SpaceTimeMatrix::GetCachedSpatialDiscretizationL(int    * &L_rowptr, 
+                                                      int    * &L_colinds, 
+                                                      double * &L_data,
+                                                      double * &U0, 
+                                                      int      &spatialDOFs,
+                                                      double    t)
+{
+    m_cache_useCount++;
+    
+    int entryInd = -1;
+    for (size_t i = 0; i < m_L_cache.size(); i++) {
+        if (std::abs(m_L_cache[i].t - t) < 1e-10*m_dt) {
+            entryInd = i;
+            break;
+        }
+    }
+    
+    // Not in cache: Get spatial discretization and store it
+    if (entryInd == -1) {
+        m_cache_misses++;
+        SpatialDisc_cacheEntry entry = {};
+        entry.t = t;
+        double discStart = MPI_Wtime();
+        getSpatialDiscretizationL(entry.L, entry.U0, true, entry.spatialDOFs, t, m_bsize);
+        m_phase_time[TIMER_SPATIAL_DISC] += MPI_Wtime() - discStart;
+        entry.bsize = m_bsize;
+        entry.bytes = 0; // Borrowed storage does not count against the budget
+        if (entry.L.owned)  entry.bytes += (entry.spatialDOFs + 1) * sizeof(int) 
+                                + entry.L.rowptr[entry.spatialDOFs] * (sizeof(int) + sizeof(double));
+        if (entry.U0.owned) entry.bytes += entry.spatialDOFs * sizeof(double);
+        EvictSpatialDiscretizationCache(entry.bytes);
+        m_L_cache.push_back(entry);
+        entryInd = m_L_cache.size() - 1;
+    } else {
+        m_cache_hits++;
+    }
+    
+    m_L_cache[entryInd].lastUse = m_cache_useCount;
+    L_rowptr    = m_L_cache[entryInd].L.rowptr;
+    L_colinds   = m_L_cache[entryInd].L.colinds;
+    L_data      = m_L_cache[entryInd].L.data;
+    U0          = m_L_cache[entryInd].U0.data;
+    spatialDOFs = m_L_cache[entryInd].spatialDOFs;
+    m_bsize     = m_L_cache[entryInd].bsize;
+}
+
+
+/* Get PDE source term G at time t, reusing the one stored in the cache if G has 
+    previously been evaluated at t. No spatial parallelism.
+    
+NOTES:
+    -The returned array is owned by the cache (or lent to it by the spatial 
+        discretization) and must not be deleted. It remains valid until the next 
+        call to GetCachedSpatialDiscretizationG, or until the cache is unpinned if 
+        m_cache_pinned is set.
+*/
+void SpaceTimeMatrix::GetCachedSpatialDiscretizationG(double * &G, 
+                                                      int      &spatialDOFs, 
+                                                      double    t)
+{
+    m_cache_useCount++;
+    
+    int entryInd = -1;
+    for (size_t i = 0; i < m_G_cache.size(); i++) {
+        if (std::abs(m_G_cache[i].t - t) < 1e-10*m_dt) {
+            entryInd = i;
+            break;
+        }
+    }
+    
+    // Not in cache: Get source term and store it
+    if (entryInd == -1) {
+        m_cache_misses++;
+        SpatialDisc_cacheEntry entry = {};
+        entry.t = t;
+        double discStart = MPI_Wtime();
+        getSpatialDiscretizationG(entry.G, entry.spatialDOFs, t);
+        m_phase_time[TIMER_SPATIAL_DISC] += MPI_Wtime() - discStart;
+        entry.bytes = entry.G.owned ? entry.spatialDOFs * sizeof(double) : 0;
+        EvictSpatialDiscretizationCache(entry.bytes);
+        m_G_cache.push_back(entry);
+        entryInd = m_G_cache.size() - 1;
+    } else {
+        m_cache_hits++;
+    }
+    
+    m_G_cache[entryInd].lastUse = m_cache_useCount;
+    G           = m_G_cache[entryInd].G.data;
+    spatialDOFs = m_G_cache[entryInd].spatialDOFs;
+}
+
+
+/* Evict least recently used entries from the cache until an entry of size bytesNeeded 
+    fits within the memory budget. The most recently used L and G are never evicted 
+    since they may still be in use, and nothing is evicted while the cache is pinned. */
+void SpaceTimeMatrix::EvictSpatialDiscretizationCache(double bytesNeeded)
+{
+    if (m_cache_pinned) return;
+    
+    std::vector<SpatialDisc_cacheEntry> * caches[2] = {&m_L_cache, &m_G_cache};
+    
+    while (true) {
+        double bytes = bytesNeeded;
+        long   newestUse[2] = {-1, -1};
+        for (int c = 0; c < 2; c++) {
+            for (size_t i = 0; i < caches[c]->size(); i++) {
+                bytes += (*caches[c])[i].bytes;
+                newestUse[c] = std::max(newestUse[c], (*caches[c])[i].lastUse);
+            }
+        }
+        if (bytes <= m_cache_budget) return;
+        
+        // Find least recently used entry that can be evicted
+        int evictCache = -1;
+        int evictInd   = -1;
+        for (int c = 0; c < 2; c++) {
+            for (size_t i = 0; i < caches[c]->size(); i++) {
+                long lastUse = (*caches[c])[i].lastUse;
+                if (lastUse == newestUse[c]) continue;
+                if (evictCache == -1 || lastUse < (*caches[evictCache])[evictInd].lastUse) {
+                    evictCache = c;
+                    evictInd   = i;
+                }
+            }
+        }
+        if (evictCache == -1) return;
+        
+        SpatialDisc_cacheEntry &entry = (*caches[evictCache])[evictInd];
+        FreeBuffer(entry.L);
+        FreeBuffer(entry.U0);
+        FreeBuffer(entry.G);
+        caches[evictCache]->erase(caches[evictCache]->begin() + evictInd);
+    }
+}
+
+
+/* Free all entries in the cache of spatial discretizations */
+void SpaceTimeMatrix::ClearSpatialDiscretizationCache()
+{
+    std::vector<SpatialDisc_cacheEntry> * caches[2] = {&m_L_cache, &m_G_cache};
+    for (int c = 0; c < 2; c++) {
+        for (size_t i = 0; i < caches[c]->size(); i++) {
+            SpatialDisc_cacheEntry &entry = (*caches[c])[i];
+            FreeBuffer(entry.L);
+            FreeBuffer(entry.U0);
+            FreeBuffer(entry.G);
+        }
+        caches[c]->clear();
+    }
+}
+
+
+/* Print total number of cache hits and misses across all processes. Must be called 
+    by all processes in global communicator. */
+void SpaceTimeMatrix::ReportSpatialDiscretizationCache()
+{
+    int localCounts[2] = {m_cache_hits, m_cache_misses};
+    int globalCounts[2];
+    MPI_Reduce(localCounts, globalCounts, 2, MPI_INT, MPI_SUM, 0, m_globComm);
+    if (m_globRank == 0) {
+        std::cout << "Spatial discretization cache: hits = " << globalCounts[0] 
+                    << ", misses = " << globalCounts[1] << "\n";
+    }
+}
+
+
+/* ----------------------------------------------------------------------------- */
+/* ------------ Cache of DIRK matrices and their solvers ------------ */
+/* ----------------------------------------------------------------------------- */
+
+/* Set memory budget of the cache of DIRK matrices and their solvers. Systems are evicted, 
+    least recently used first, while the budget is exceeded, but the one most recently used 
+    is always kept, so a budget of 0 means a new matrix and solver each time dt*a_ii changes. */
+void SpaceTimeMatrix::SetDIRKCacheSize(double megabytes)
+{
+    m_DIRK_budget = megabytes * 1024 * 1024;
+}
+
+
+/* Memory of the local rows of A */
+double SpaceTimeMatrix::ParCSRMatrixBytes(HYPRE_ParCSRMatrix A)
+{
+    hypre_CSRMatrix * diag = hypre_ParCSRMatrixDiag((hypre_ParCSRMatrix *) A);
+    hypre_CSRMatrix * offd = hypre_ParCSRMatrixOffd((hypre_ParCSRMatrix *) A);
+    double nnz  = hypre_CSRMatrixNumNonzeros(diag) + hypre_CSRMatrixNumNonzeros(offd);
+    double rows = hypre_CSRMatrixNumRows(diag);
+    return nnz * (sizeof(double) + sizeof(int)) + 2 * (rows + 1) * sizeof(int);
+}
+
+
+/* Get index of DIRK matrix M/(dt*a_ii) + L, where 1/(dt*a_ii) == scaling, in the cache, 
+    assembling it if it's not cached. 
+    
+NOTES:
+    -Only valid if L is time-independent. If the matrix is assembled, L is evaluated at t.
+    -M_scaled_data must be the data of the local rows of M scaled by scaling. 
+    -The system's solver is NULL until StoreCachedDIRKSolver is called after its first solve.
+*/
+int SpaceTimeMatrix::GetCachedDIRKSystem(double   scaling, 
+                                         double   t,
+                                         int      ilower, 
+                                         int      iupper, 
+                                         int    * M_rowptr, 
+                                         int    * M_colinds, 
+                                         double * M_scaled_data)
+{
+    m_DIRK_useCount++;
+    
+    for (size_t i = 0; i < m_DIRK_cache.size(); i++) {
+        if (std::abs(m_DIRK_cache[i].scaling - scaling) <= 1e-12 * std::abs(scaling)) {
+            m_DIRK_hits++;
+            m_DIRK_cache[i].lastUse = m_DIRK_useCount;
+            return i;
+        }
+    }
+    
+    m_DIRK_misses++;
+    DIRK_system system = {};
+    system.scaling = scaling;
+    system.lastUse = m_DIRK_useCount;
+    GetHypreSpatialDiscretizationL(system.A, system.Aij, t);
+    AddHypreMatrixValuesFromCRSData(system.A, M_rowptr, M_colinds, M_scaled_data, ilower, iupper); // A <- M/(dt*a_ii) + L
+    system.bytes   = ParCSRMatrixBytes(system.A);
+    m_DIRK_cache.push_back(system);
+    return m_DIRK_cache.size() - 1;
+}
+
+
+/* Move solver just used to solve with cached DIRK system systemInd, m_solver and m_gmres, 
+    into the cache, then evict least recently used systems while over budget 
+
+NOTES:
+    -Memory of an AMG solver is estimated from the local rows of its coarse-grid, 
+        interpolation and restriction matrices.
+    -Eviction is decided from the largest memory of the cache over the spatial 
+        communicator, so that all processes evict the same systems.
+*/
+void SpaceTimeMatrix::StoreCachedDIRKSolver(int systemInd)
+{
+    DIRK_system &system = m_DIRK_cache[systemInd];
+    
+    // Solver was set up with this system: Account for its memory
+    if (!system.amg && !system.gmres && m_solver) {
+        hypre_ParAMGData    * amg_data  = (hypre_ParAMGData *) m_solver;
+        int                   numLevels = hypre_ParAMGDataNumLevels(amg_data);
+        hypre_ParCSRMatrix ** A_array   = hypre_ParAMGDataAArray(amg_data);
+        hypre_ParCSRMatrix ** P_array   = hypre_ParAMGDataPArray(amg_data);
+        hypre_ParCSRMatrix ** R_array   = hypre_ParAMGDataRArray(amg_data);
+        for (int level = 0; level < numLevels; level++) {
+            if (level > 0) system.bytes += ParCSRMatrixBytes((HYPRE_ParCSRMatrix) A_array[level]); // A_array[0] is system.A
+            if (level < numLevels-1) {
+                if (P_array && P_array[level]) system.bytes += ParCSRMatrixBytes((HYPRE_ParCSRMatrix) P_array[level]);
+                if (R_array && R_array[level] && R_array[level] != P_array[level]) {
+                    system.bytes += ParCSRMatrixBytes((HYPRE_ParCSRMatrix) R_array[level]);
+                }
+            }
+        }
+    }
+    // Scaled matrix was computed for this system: Account for its memory
+    if (!system.A_s && m_A_s) system.bytes += ParCSRMatrixBytes(m_A_s);
+    
+    system.amg   = m_solver;
+    system.gmres = m_gmres;
+    system.A_s   = m_A_s;
+    m_solver     = NULL;
+    m_gmres      = NULL;
+    m_A_s        = NULL;
+    m_binv_A     = NULL;
+    
+    double bytes = 0.0;
+    for (size_t i = 0; i < m_DIRK_cache.size(); i++) bytes += m_DIRK_cache[i].bytes;
+    m_DIRK_maxBytes = std::max(m_DIRK_maxBytes, bytes);
+    MPI_Allreduce(MPI_IN_PLACE, &bytes, 1, MPI_DOUBLE, MPI_MAX, m_spatialComm);
+    
+    // Evict least recently used systems
+    while (bytes > m_DIRK_budget && m_DIRK_cache.size() > 1) {
+        int lruInd = -1;
+        for (size_t i = 0; i < m_DIRK_cache.size(); i++) {
+            if (m_DIRK_cache[i].lastUse == m_DIRK_useCount) continue; // Most recently used is kept
+            if (lruInd == -1 || m_DIRK_cache[i].lastUse < m_DIRK_cache[lruInd].lastUse) lruInd = i;
+        }
+        DIRK_system &lru = m_DIRK_cache[lruInd];
+        if (lru.gmres) HYPRE_ParCSRGMRESDestroy(lru.gmres);
+        if (lru.amg)   HYPRE_BoomerAMGDestroy(lru.amg);
+        if (lru.A_s)   hypre_ParCSRMatrixDestroy(lru.A_s);
+        HYPRE_IJMatrixDestroy(lru.Aij);
+        m_DIRK_cache.erase(m_DIRK_cache.begin() + lruInd);
+        
+        bytes = 0.0;
+        for (size_t i = 0; i < m_DIRK_cache.size(); i++) bytes += m_DIRK_cache[i].bytes;
+        MPI_Allreduce(MPI_IN_PLACE, &bytes, 1, MPI_DOUBLE, MPI_MAX, m_spatialComm);
+    }
+}
+
+
+/* Destroy all cached DIRK matrices and their solvers */
+void SpaceTimeMatrix::ClearDIRKCache()
+{
+    for (size_t i = 0; i < m_DIRK_cache.size(); i++) {
+        if (m_DIRK_cache[i].gmres) HYPRE_ParCSRGMRESDestroy(m_DIRK_cache[i].gmres);
+        if (m_DIRK_cache[i].amg)   HYPRE_BoomerAMGDestroy(m_DIRK_cache[i].amg);
+        if (m_DIRK_cache[i].A_s)   hypre_ParCSRMatrixDestroy(m_DIRK_cache[i].A_s);
+        HYPRE_IJMatrixDestroy(m_DIRK_cache[i].Aij);
+    }
+    m_DIRK_cache.clear();
+}
+
+
+/* Print number of solves with a cached DIRK system and how many systems were assembled 
+    (which are the same on all processes), and the largest memory of the cache, summed 
+    over all processes */
+void SpaceTimeMatrix::ReportDIRKCache()
+{
+    double maxBytes;
+    MPI_Reduce(&m_DIRK_maxBytes, &maxBytes, 1, MPI_DOUBLE, MPI_SUM, 0, m_spatialComm);
+    if (m_spatialRank == 0) {
+        std::cout << "DIRK system cache: hits = " << m_DIRK_hits 
+                    << ", systems assembled = " << m_DIRK_misses 
+                    << ", peak bytes = " << maxBytes 
+                    << " (budget per process = " << m_DIRK_budget << ")\n";
+    }
+}
+
+
+/* Symbolic phase of assembling couplings of the form alpha*M + beta*L: Compute 
+    the merged sparsity pattern of the rows of M and L owned by the process.
+
+NOTES:
+    -Entries of M and L with magnitude <= 1e-16 are dropped from the pattern
+    -Columns within each row of the merged pattern are sorted. Where columns are 
+        repeated in M, the last entry is used; where they're repeated in L, all 
+        entries are summed (in their order in L).
+    -The pattern only depends on the sparsity (and small entries) of M and L,
+        so it needs to be recomputed only when either of them is rebuilt.
+*/
+void SpaceTimeMatrix::GetMLPattern(ML_pattern &pattern, 
+                                   int         numRows, 
+                                   int       * M_rowptr, 
+                                   int       * M_colinds, 
+                                   double    * M_data, 
+                                   int       * L_rowptr, 
+                                   int       * L_colinds, 
+                                   double    * L_data)
+{
+    int maxSlots = (M_rowptr[numRows] - M_rowptr[0]) + (L_rowptr[numRows] - L_rowptr[0]);
+    pattern.rowptr.resize(numRows + 1);
+    pattern.colinds.clear();
+    pattern.M_ind.clear();
+    pattern.L_ptr.clear();
+    pattern.L_ind.clear();
+    pattern.colinds.reserve(maxSlots);
+    pattern.M_ind.reserve(maxSlots);
+    pattern.L_ptr.reserve(maxSlots + 1);
+    pattern.L_ind.reserve(L_rowptr[numRows] - L_rowptr[0]);
+    
+    // (column, index) pairs of entries in current row of M and L
+    std::vector<std::pair<int, int>> M_row;
+    std::vector<std::pair<int, int>> L_row;
+    
+    pattern.M_slots   = 0;
+    pattern.L_slots   = 0;
+    pattern.rowptr[0] = 0;
+    pattern.L_ptr.push_back(0);
+    for (int row = 0; row < numRows; row++) {
+        M_row.clear();
+        L_row.clear();
+        for (int j = M_rowptr[row]; j < M_rowptr[row+1]; j++) {
+            if (std::abs(M_data[j]) > 1e-16) M_row.push_back(std::make_pair(M_colinds[j], j));
+        }
+        for (int j = L_rowptr[row]; j < L_rowptr[row+1]; j++) {
+            if (std::abs(L_data[j]) > 1e-16) L_row.push_back(std::make_pair(L_colinds[j], j));
+        }
+        std::sort(M_row.begin(), M_row.end());
+        std::sort(L_row.begin(), L_row.end());
+        
+        // Sorted merge of columns in M and L
+        size_t m = 0;
+        size_t l = 0;
+        while (m < M_row.size() || l < L_row.size()) {
+            int col;
+            if (l == L_row.size() || (m < M_row.size() && M_row[m].first <= L_row[l].first)) {
+                col = M_row[m].first;
+            } else {
+                col = L_row[l].first;
+            }
+            
+            int M_ind = -1;
+            while (m < M_row.size() && M_row[m].first == col) {
+                M_ind = M_row[m].second;
+                m++;
+            }
+            while (l < L_row.size() && L_row[l].first == col) {
+                pattern.L_ind.push_back(L_row[l].second);
+                l++;
+            }
+            
+            if (M_ind != -1) pattern.M_slots++;
+            if ((int) pattern.L_ind.size() > pattern.L_ptr.back()) pattern.L_slots++;
+            pattern.colinds.push_back(col);
+            pattern.M_ind.push_back(M_ind);
+            pattern.L_ptr.push_back(pattern.L_ind.size());
+        }
+        pattern.rowptr[row+1] = pattern.colinds.size();
+    }
+}
+
+
+/* Numeric phase of assembling couplings of the form alpha*M + beta*L: Write entries 
+    sign*(M_coeff*M + L_coeff*L) of given row of merged pattern into colinds/data, 
+    starting at dataInd, with column indices shifted by colOffset.
+
+NOTES:
+    -Only slots holding an entry of M (if useM) or of L (if useL) are written
+    -dataInd is incremented by the number of entries written
+*/
+void SpaceTimeMatrix::FillMLRow(const ML_pattern &pattern, 
+                                int               row, 
+                                bool              useM,
+                                double            M_coeff,
+                                bool              useL,
+                                double            L_coeff,
+                                double          * M_data, 
+                                double          * L_data, 
+                                int               colOffset,
+                                double            sign,
+                                int             * colinds, 
+                                double          * data, 
+                                int              &dataInd)
+{
+    for (int slot = pattern.rowptr[row]; slot < pattern.rowptr[row+1]; slot++) {
+        bool hasM = useM && pattern.M_ind[slot] >= 0;
+        bool hasL = useL && pattern.L_ptr[slot] < pattern.L_ptr[slot+1];
+        if (!hasM && !hasL) continue;
+        
+        double value = 0.0;
+        if (hasM) value = M_coeff * M_data[pattern.M_ind[slot]];
+        if (hasL) {
+            for (int j = pattern.L_ptr[slot]; j < pattern.L_ptr[slot+1]; j++) {
+                value += L_coeff * L_data[pattern.L_ind[j]];
+            }
+        }
+        
+        colinds[dataInd] = colOffset + pattern.colinds[slot];
+        data[dataInd]    = sign * value;
+        dataInd         += 1;
+    }
+}
+
+
+/* Number of entries written by FillMLRow over all rows of the merged pattern
+    for the given choice of including M and/or L */
+int SpaceTimeMatrix::MLCouplingNnz(const ML_pattern &pattern, 
+                                   bool              useM, 
+                                   bool              useL)
+{
+    if (useM && useL) return pattern.colinds.size();
+    if (useM)         return pattern.M_slots;
+    if (useL)         return pattern.L_slots;
+    return 0;
+}
+
+
+/* Exact nnz of the block row of the s-stage RK space-time matrix belonging to 
+    DOF with local index localInd in block blockInd. L_nnz is the nnz of the
+    spatial discretization (including any small entries). */
+int SpaceTimeMatrix::RKBlockRowNnz(const ML_pattern &pattern, 
+                                   int               localInd, 
+                                   int               blockInd, 
+                                   int               L_nnz)
+{
+    int nnz = 0;
+    double temp;
+    
+    /* --- Solution-type DOF --- */
+    if (localInd == m_s_butcher-1) {
+        // Coupling to solution DOF at previous time. No such coupling for u_1
+        if (blockInd > 0) {
+            temp = m_A_butcher[m_s_butcher-1][m_s_butcher-1] - m_b_butcher[m_s_butcher-1];
+            nnz += MLCouplingNnz(pattern, true, temp != 0.0);
+        }
+        
+        // Coupling to stage DOFs
+        for (int i = 0; i < m_s_butcher-1; i++) {
+            temp = m_b_butcher[i] * m_A_butcher[m_s_butcher-1][m_s_butcher-1] - m_b_butcher[m_s_butcher-1] * m_A_butcher[m_s_butcher-1][i];
+            nnz += MLCouplingNnz(pattern, m_b_butcher[i] != 0.0, temp != 0.0);
+        }
+        
+        // Coupling to myself
+        nnz += MLCouplingNnz(pattern, true, m_A_butcher[m_s_butcher-1][m_s_butcher-1] != 0.0);
+    
+    /* --- Stage-type DOF --- */     
+    } else {
+        // Coupling to solution at previous time. No such coupling for first set of stages at t=0
+        if (blockInd > 0) nnz += L_nnz;
+        
+        // Coupling to previous stages
+        for (int j = 0; j < localInd; j++) {
+            if (m_A_butcher[localInd][j] != 0.0) nnz += pattern.L_ind.size();
+        }
+        
+        // Coupling to myself
+        nnz += MLCouplingNnz(pattern, true, m_A_butcher[localInd][localInd] != 0.0);
+    }
+    
+    return nnz;
+}
+
+
+/* Exact nnz of the block row of the s-step BDF space-time matrix belonging to 
+    DOF globalInd. M_nnz is the nnz of the mass matrix (including any small entries). */
+int SpaceTimeMatrix::BDFBlockRowNnz(const ML_pattern &pattern, 
+                                    int               globalInd, 
+                                    int               M_nnz)
+{
+    // Coupling to DOFs at s previous times, or n times if n < s
+    int s_effective = (globalInd > m_s_multi - 1) ? m_s_multi : globalInd;
+    
+    // Coupling to myself
+    return s_effective * M_nnz + MLCouplingNnz(pattern, true, true);
+}
+
+
+/* Print total nnz allocated for space-time CSR data across all processes relative 
+    to that actually used. Must be called by all processes in global communicator. */
+void SpaceTimeMatrix::ReportCSRAllocation(int allocatedNnz, 
+                                          int usedNnz)
+{
+    double localNnz[2] = {(double) allocatedNnz, (double) usedNnz};
+    double globalNnz[2];
+    MPI_Reduce(localNnz, globalNnz, 2, MPI_DOUBLE, MPI_SUM, 0, m_globComm);
+    if (m_globRank == 0) {
+        std::cout << "Space-time matrix: nnz allocated = " << globalNnz[0] << ", nnz used = " << globalNnz[1] 
+                    << ", allocated/used = " << globalNnz[0] / globalNnz[1] << "\n";
+    }
+}
+
+
+/* ----------------------------------------------------------- */
+/* ----------------- No spatial parallelism ------------------ */
+/* ----------------------------------------------------------- */
+/* NOTES:
+    -Space-time CSR arrays are sized by exactly counting the nnz of each block row 
+        based on the merged sparsity pattern of the spatial discretization and mass 
+        matrix at the time the block row is evaluated at.
+    -Block rows of the DOFs on process are assembled in two passes: Spatial 
+        discretizations for all DOFs are first gathered (serially, since the spatial
+        discretization and cache are not thread safe), then the block rows are filled
+        in parallel over DOFs using OpenMP, with each DOF writing into its own slice 
+        of the CSR arrays as given by a prefix sum over block row nnz. The result 
+        is identical to a serial fill, independent of the number of threads.
+    -While a block row is being assembled, the spatial discretizations of all DOFs 
+        on process are held in memory, regardless of the budget of the cache.
+    -If assembleMatrix == false, only the RHS vector and initial guess are computed and 
+        the CSR arrays are NULL. The matrix is stored in Kronecker-product form instead 
+        if storeKronecker == true.
+ */
+
+
+
+/* Gets block row (or multiple if there are > 1 DOFs per process) of s-step BDF 
+    space-time equations. No spatial parallelism.
+
+NOTEs: 
+    -m_t0 is assumed to be 0, and so the spatial discretization is evaluated at
+        time t0 + (n+s)*dt == (n+s)*dt.
+*/
+void SpaceTimeMatrix::BDFSpaceTimeBlock(int    * &rowptr, 
+                                        int    * &colinds, 
+                                        double * &data, 
+                                        double * &B, 
+                                        double * &V, 
+                                        int      &onProcSize,
+                                        bool      assembleMatrix,
+                                        bool      storeKronecker)
+{
+    int globalInd0 = m_globRank * m_nDOFPerProc;    // Index of first DOF on process
+    
+    /* --- Get spatial discretization at times required by all DOFs on process --- */
+    int                     spatialDOFs;    
+    std::vector<int *>      L_rowptr(m_nDOFPerProc);
+    std::vector<int *>      L_colinds(m_nDOFPerProc);
+    std::vector<double *>   L_data(m_nDOFPerProc);
+    std::vector<double *>   B0(m_nDOFPerProc);
+    std::vector<double *>   V0(m_nDOFPerProc);
+    // NOTE: Spatial discretization arrays are owned by the cache and must not be deleted here
+    m_cache_pinned = true;
+    for (int indOnProc = 0; indOnProc < m_nDOFPerProc; indOnProc++) {
+        double t = m_t0 + (globalInd0+indOnProc+m_s_multi)*m_dt;
+        
+        // Rebuild spatial discretization if it's time dependent
+        if (indOnProc == 0 || m_G_isTimedependent) {
+            GetCachedSpatialDiscretizationG(B0[indOnProc], spatialDOFs, t);
+        } else {
+            B0[indOnProc] = B0[0];
+        }
+        
+        if (indOnProc == 0 || m_L_isTimedependent) {
+            GetCachedSpatialDiscretizationL(L_rowptr[indOnProc], L_colinds[indOnProc], 
+                                            L_data[indOnProc], V0[indOnProc], spatialDOFs, t);
+        } else {
+            L_rowptr[indOnProc]  = L_rowptr[0];
+            L_colinds[indOnProc] = L_colinds[0];
+            L_data[indOnProc]    = L_data[0];
+            V0[indOnProc]        = V0[0];
+        }
+    }
+    
+    /* --- Get mass matrix ---*/
+    int      M_nnz;
+    int    * M_rowptr;
+    int    * M_colinds;
+    double * M_data;
+    // Set range of identity mass matix to assemble if needed (all fits on process)
+    if (!m_M_exists) setIdentityMassLocalRange(0, spatialDOFs-1); 
+    getMassMatrix(M_rowptr, M_colinds, M_data);
+    M_nnz = M_rowptr[spatialDOFs];
+    
+    /* --- Get merged sparsity pattern of M and L for each distinct L --- */
+    int numPatterns = assembleMatrix ? (m_L_isTimedependent ? m_nDOFPerProc : 1) : 0;
+    std::vector<ML_pattern> ML(numPatterns);
+    #pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < numPatterns; i++) {
+        GetMLPattern(ML[i], spatialDOFs, M_rowptr, M_colinds, M_data, L_rowptr[i], L_colinds[i], L_data[i]);
+    }
+
+    /* --- Get offset of each DOF's block row into CSR arrays, and total NNZ on process --- */
+    std::vector<int> DOFOffset(m_nDOFPerProc + 1, 0);
+    for (int indOnProc = 0; assembleMatrix && indOnProc < m_nDOFPerProc; indOnProc++) {
+        const ML_pattern &DOF_ML = ML[m_L_isTimedependent ? indOnProc : 0];
+        DOFOffset[indOnProc+1] = DOFOffset[indOnProc] + BDFBlockRowNnz(DOF_ML, globalInd0 + indOnProc, M_nnz);
+    }
+    int onProcNnz = DOFOffset[m_nDOFPerProc];
+    
+    onProcSize = m_nDOFPerProc * spatialDOFs; // Number of rows on process
+    B          = new double[onProcSize];
+    V          = new double[onProcSize];
+    if (assembleMatrix) {
+        rowptr    = new int[onProcSize + 1];
+        rowptr[0] = 0; 
+        colinds   = new int[onProcNnz];
+        data      = new double[onProcNnz];
+    
+    // Matrix is not assembled: Store what's needed to apply it instead (if it's needed at all)
+    } else {
+        rowptr    = NULL;
+        colinds   = NULL;
+        data      = NULL;
+        if (storeKronecker) SetKroneckerOperator(spatialDOFs, M_rowptr, M_colinds, M_data, L_rowptr[0], L_colinds[0], L_data[0]);
+    }
+    
+    
+    /* ----------------------------------------------------- */
+    /* ------ Build block row for all DOFs on process ------ */
+    /* ----------------------------------------------------- */
+    #pragma omp parallel for schedule(dynamic)
+    for (int indOnProc = 0; indOnProc < m_nDOFPerProc; indOnProc++) {
+        int globalInd    = globalInd0 + indOnProc;
+        int dataInd      = DOFOffset[indOnProc];     // Start of current DOF's slice of CSR arrays
+        int colOffset    = 0;                        // Global index of first column for DOF that we're coupling to
+        int rowptrOffset = indOnProc * spatialDOFs;  // Offset for accessing rowptr array for current DOF
+        double temp      = 0.0;
+        
+        // Spatial discretization for current DOF
+        double           *DOF_L_data  = L_data[indOnProc];
+        double           *DOF_B0      = B0[indOnProc];
+        double           *DOF_V0      = V0[indOnProc];
+        
+        // RHS vector and initial guess at solution
+        for (int row = 0; row < spatialDOFs; row++) {
+            B[rowptrOffset + row] = m_dt*m_b_multi[0]*DOF_B0[row]; // PDE source term. NOTE: Only b_s is stored for BDF schemes 
+            V[rowptrOffset + row] = DOF_V0[row];                   // Initial guess at solution
+            
+            // First s DOFs: Add precomputed w[n] vector holding all necessary starting-value information
+            if (globalInd <= m_s_multi - 1) B[rowptrOffset + row] += m_w_multi[globalInd][row];
+        }
+        
+        if (!assembleMatrix) continue;
+        const ML_pattern &DOF_ML = ML[m_L_isTimedependent ? indOnProc : 0];
+    
+        // Loop over each row in spatial discretization, working from earliest DOFs to the current one
+        for (int row = 0; row < spatialDOFs; row++) {
+            // Number of previous DOFs current DOF couples to. First s DOFs only couple 
+            // to the n times before them rather than all s
+            int s_effective = (globalInd <= m_s_multi - 1) ? globalInd : m_s_multi;
+            
+            // Global index of furthest DOF current DOF couples back to
+            colOffset = (globalInd - s_effective) * spatialDOFs;
+            
+            /* ------ Off-block-diagonal component that reaches back s_effective DOFs with mass matrix couplings ------ */
+            for (int j = s_effective; j >= 1; j--)  {
+                // Get mass-matrix data
+                for (int p = M_rowptr[row]; p < M_rowptr[row+1]; p++) {                
+                    data[dataInd]    = m_a_multi[m_s_multi-j]*M_data[p];
+                    colinds[dataInd] = M_colinds[p] + colOffset;
+                    dataInd         += 1;
+                }
+                colOffset += spatialDOFs;
             }
+        
+            /* ------ Block-diagonal component: M + dt*b_s*L ------ */
+            temp = m_dt * m_b_multi[0]; // Note only b_s is stored for BDF schemes
+            FillMLRow(DOF_ML, row, true, 1.0, true, temp, M_data, DOF_L_data, colOffset, 1.0, colinds, data, dataInd);
 
             // Move to next row of spatial discretization for current DOF
             rowptr[rowptrOffset + row+1] = dataInd;
         }
-        
-        // Finished assembling component for current DOF, move to next DOF on process
-        rowptrOffset += spatialDOFs;
     }
     
-    // Check that sufficient data was allocated
-    if (dataInd > onProcNnz) {
-        std::cout << "WARNING: Space-time BDF matrix has more nonzeros than allocated on process " << m_globRank << " of " << m_numProc << ".\n";
-    }
+    // Spatial discretizations no longer in use may now be evicted from cache
+    m_cache_pinned = false;
+    EvictSpatialDiscretizationCache(0.0);
     
-    // Clean up.
-    delete[] L_rowptr;
-    delete[] L_colinds;
-    delete[] L_data;
-    delete[] M_rowptr;
-    delete[] M_colinds;
-    delete[] M_data;
-    delete[] B0;
-    delete[] V0;
+    // Report memory allocated for space-time matrix relative to that used, and use of cache
+    if (assembleMatrix) ReportCSRAllocation(onProcNnz, rowptr[onProcSize]);
+    ReportSpatialDiscretizationCache();
+    
+    // NOTE: Mass matrix arrays are owned by the spatial discretization and must not be deleted here
     
     // Information for initializing space-time RHS vector no longer needed.
     for (int i = 0; i < m_w_multi.size(); i++) {
@@ -3186,7 +7132,9 @@ void SpaceTimeMatrix::RKSpaceTimeBlock(int    * &rowptr,
                                        double * &data,
                                        double * &B, 
                                        double * &V,     
-                                       int      &onProcSize)
+                                       int      &onProcSize,
+                                       bool      assembleMatrix,
+                                       bool      storeKronecker)
 {
     int globalInd0 = m_globRank * m_nDOFPerProc;        // Global index of first variable on process
     int globalInd1 = globalInd0 + m_nDOFPerProc - 1;    // Global index of last variable on process
@@ -3198,23 +7146,38 @@ void SpaceTimeMatrix::RKSpaceTimeBlock(int    * &rowptr,
         blockInd[globalInd - globalInd0] = globalInd / m_s_butcher; 
     }
     
-    /* --- Get spatial discretization at time required by 1st DOF on process --- */    
-    int      L_nnz;
-    int    * L_rowptr;
-    int    * L_colinds;
-    double * L_data;
-    double * B0;
-    double * V0;
-    int      spatialDOFs;
-    bool     getV0 = true; // Get initial guess at solution from getSpatialDiscretizationL
-    double   t = m_dt*blockInd[0] + m_dt*m_c_butcher[localInd[0]]; // Time to evaluate spatial discretization, as required by first DOF on process. 
-    
-    getSpatialDiscretizationG(B0, spatialDOFs, t);
-    getSpatialDiscretizationL(L_rowptr, L_colinds, L_data, V0, getV0, spatialDOFs, t, m_bsize);
-    L_nnz = L_rowptr[spatialDOFs];   
+    /* --- Get spatial discretization at times required by all DOFs on process --- */    
+    int                     spatialDOFs;
+    std::vector<int *>      L_rowptr(m_nDOFPerProc);
+    std::vector<int *>      L_colinds(m_nDOFPerProc);
+    std::vector<double *>   L_data(m_nDOFPerProc);
+    std::vector<double *>   B0(m_nDOFPerProc);
+    std::vector<double *>   V0(m_nDOFPerProc);
+    // NOTE: Spatial discretization arrays are owned by the cache and must not be deleted here
+    m_cache_pinned = true;
+    for (int indOnProc = 0; indOnProc < m_nDOFPerProc; indOnProc++) {
+        // Time to evaluate spatial discretization at
+        double t = m_t0 + m_dt*blockInd[indOnProc] + m_dt*m_c_butcher[localInd[indOnProc]]; 
+        
+        // Rebuild spatial discretization if it's time dependent
+        if (indOnProc == 0 || m_G_isTimedependent) {
+            GetCachedSpatialDiscretizationG(B0[indOnProc], spatialDOFs, t);
+        } else {
+            B0[indOnProc] = B0[0];
+        }
+        
+        if (indOnProc == 0 || m_L_isTimedependent) {
+            GetCachedSpatialDiscretizationL(L_rowptr[indOnProc], L_colinds[indOnProc], 
+                                            L_data[indOnProc], V0[indOnProc], spatialDOFs, t);
+        } else {
+            L_rowptr[indOnProc]  = L_rowptr[0];
+            L_colinds[indOnProc] = L_colinds[0];
+            L_data[indOnProc]    = L_data[0];
+            V0[indOnProc]        = V0[0];
+        }
+    }
     
     /* --- Get mass matrix ---*/
-    int      M_nnz;
     int    * M_rowptr;
     int    * M_colinds;
     double * M_data;
@@ -3222,65 +7185,46 @@ void SpaceTimeMatrix::RKSpaceTimeBlock(int    * &rowptr,
     // Setup range of identity matrix to assemble if spatial discretization doesn't use a mass matrix
     if (!m_M_exists) setIdentityMassLocalRange(0, spatialDOFs-1); // Entire spatial discretization fits on process
     getMassMatrix(M_rowptr, M_colinds, M_data);
-    M_nnz = M_rowptr[spatialDOFs];
 
-    /* ------ Get total NNZ on this processor. ------ */
-    //  -Assumes NNZ of spatial discretization does not change with time
-    //  -Doesn't assume sparsity of M and L overlap: This nnz count is an upperbound.
-    int onProcNnz = 0;
-    for (int indOnProc = 0; indOnProc <= globalInd1 - globalInd0; indOnProc++) {
-        /* --- Solution-type DOF --- */
-        if (localInd[indOnProc] == m_s_butcher-1) 
-        {
-            // Coupling to solution DOF at previous time. No such coupling for u_1
-            if (blockInd[indOnProc] > 0) {                
-                onProcNnz += M_nnz;
-                if (m_A_butcher[m_s_butcher-1][m_s_butcher-1] - m_b_butcher[m_s_butcher-1] != 0.0) onProcNnz += L_nnz; 
-            }
-            
-            // Coupling to stage DOFs
-            for (int i = 0; i < m_s_butcher-1; i++) {
-                if (m_b_butcher[i] != 0.0) onProcNnz += M_nnz;
-                if (m_A_butcher[m_s_butcher-1][m_s_butcher-1]*m_b_butcher[i] - m_A_butcher[m_s_butcher-1][i]*m_b_butcher[m_s_butcher-1] != 0.0) onProcNnz += L_nnz;
-            }
-            
-            // Coupling to myself
-            onProcNnz += M_nnz;
-            if (m_A_butcher[m_s_butcher-1][m_s_butcher-1] != 0.0) onProcNnz += L_nnz;
-    
-        }
-        /* --- Stage-type DOF --- */ 
-        else 
-        {
-            // Coupling to solution at previous time. No such coupling for first set of stages at t=0
-            if (blockInd[indOnProc] > 0) onProcNnz += L_nnz;
-    
-            // Coupling to previous stages 
-            for (int j = 0; j < localInd[indOnProc]; j++) {
-                if (m_A_butcher[localInd[indOnProc]][j] != 0.0) onProcNnz += L_nnz;
-            }
-            
-            // Coupling to myself
-            onProcNnz += M_nnz;
-            if (m_A_butcher[localInd[indOnProc]][localInd[indOnProc]] != 0.0) onProcNnz += L_nnz;
-        }
+    /* --- Get merged sparsity pattern of M and L for each distinct L --- */
+    int numPatterns = assembleMatrix ? (m_L_isTimedependent ? m_nDOFPerProc : 1) : 0;
+    std::vector<ML_pattern> ML(numPatterns);
+    #pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < numPatterns; i++) {
+        GetMLPattern(ML[i], spatialDOFs, M_rowptr, M_colinds, M_data, L_rowptr[i], L_colinds[i], L_data[i]);
+    }
+
+    /* --- Get offset of each DOF's block row into CSR arrays, and total NNZ on process --- */
+    std::vector<int> DOFOffset(m_nDOFPerProc + 1, 0);
+    for (int indOnProc = 0; assembleMatrix && indOnProc < m_nDOFPerProc; indOnProc++) {
+        const ML_pattern &DOF_ML = ML[m_L_isTimedependent ? indOnProc : 0];
+        int L_nnz = L_rowptr[indOnProc][spatialDOFs];
+        DOFOffset[indOnProc+1] = DOFOffset[indOnProc] + RKBlockRowNnz(DOF_ML, localInd[indOnProc], blockInd[indOnProc], L_nnz);
     }
+    int onProcNnz = DOFOffset[m_nDOFPerProc];
     
     onProcSize = m_nDOFPerProc * spatialDOFs; // Number of rows on process
-    rowptr     = new int[onProcSize + 1];
-    colinds    = new int[onProcNnz];
-    data       = new double[onProcNnz];
     B          = new double[onProcSize];
     V          = new double[onProcSize];
-    rowptr[0]  = 0; 
+    if (assembleMatrix) {
+        rowptr    = new int[onProcSize + 1];
+        colinds   = new int[onProcNnz];
+        data      = new double[onProcNnz];
+        rowptr[0] = 0; 
     
-    int dataInd        = 0;
-    int rowptrOffset   = 0;    // Row offset for current DOF w.r.t rows on process
-    int blockColOffset = 0;    // Global space-time column index of first DOF in current block
-    int localColOffset = 0;    // Temporary variable to help indexing
-    double temp        = 0.0;  // Temporary constant 
+    // Matrix is not assembled: Store what's needed to apply it instead (if it's needed at all)
+    } else {
+        rowptr    = NULL;
+        colinds   = NULL;
+        data      = NULL;
+        if (storeKronecker) SetKroneckerOperator(spatialDOFs, M_rowptr, M_colinds, M_data, L_rowptr[0], L_colinds[0], L_data[0]);
+    }
+    double temp = 0.0;  // Temporary constant 
     
     
+    /* ------------------------------------------------------------------------------ */
+    /* ------ Compute RHS data depending on u0 for DOFs in first block v0 --------- */
+    /* ------------------------------------------------------------------------------ */
     // Data structures needed to eliminate u0 to RHS of system (only used if a DOF from first block v0 is on process)
     HYPRE_ParVector      u0         = NULL; // Initial condition  
     HYPRE_IJVector       u0ij       = NULL;
@@ -3292,82 +7236,93 @@ void SpaceTimeMatrix::RKSpaceTimeBlock(int    * &rowptr,
     HYPRE_IJMatrix       Lij        = NULL;
     HYPRE_ParCSRMatrix   M          = NULL; // Mass matrix
     HYPRE_IJMatrix       Mij        = NULL;
-    double             * w          = NULL; // Data to add directly to RHS
-        
-    /* ------------------------------------------------------------------------------------------------- */
-    /* ------ Loop over all DOFs on this processor building their block rows in space-time matrix ------ */
-    /* ------------------------------------------------------------------------------------------------- */
-    for (int indOnProc = 0; indOnProc <= globalInd1 - globalInd0; indOnProc++) {
-    
-        // Global space-time column index for first DOF in current block
-        blockColOffset = spatialDOFs * m_s_butcher * blockInd[indOnProc];
+    std::vector<double *> w(m_nDOFPerProc, NULL); // Data to add directly to RHS of each DOF
     
-        // Rebuild spatial discretization if it's time dependent
-        if (indOnProc > 0 && (m_L_isTimedependent || m_G_isTimedependent)) {
-            // Time to evaluate spatial discretization at            
-            t = m_dt*blockInd[indOnProc] + m_dt*m_c_butcher[localInd[indOnProc]];
-            
-            if (m_G_isTimedependent) {
-                delete[] B0;
-                getSpatialDiscretizationG(B0, spatialDOFs, t);
-            }
-            
-            if (m_L_isTimedependent) {    
-                delete[] L_rowptr;
-                delete[] L_colinds;
-                delete[] L_data;
-                delete[] V0;
-                getSpatialDiscretizationL(L_rowptr, L_colinds, L_data, V0, getV0, spatialDOFs, t, m_bsize);
-            }
-        }
+    // NOTE: Done serially for each DOF since HYPRE objects are used
+    for (int indOnProc = 0; indOnProc < m_nDOFPerProc && blockInd[indOnProc] == 0; indOnProc++) {
         
-        /* --- Compute RHS data depending on u0 if DOF is in first block DOF v0 --- */
-        if (blockInd[indOnProc] == 0) {
+        // Get data that only needs to be obtained once
+        if (indOnProc == 0) {
+            // Get initial condition as HYPRE vector. 
+            GetSpaceTimeInitialCondition(u0_data, spatialDOFs);
             
-            // Get data that only needs to be obtained once
-            if (indOnProc == 0) {
-                // Get initial condition as HYPRE vector. 
-                getInitialCondition(u0_data, spatialDOFs);
-                
-                // Get row indices for u0
-                u0_indices = new int[spatialDOFs];
-                for (int i = 0; i < spatialDOFs; i++) {
-                    u0_indices[i] = i;
-                }
-                
-                // Get u0 as HYPRE vector
-                GetHypreVectorFromData(u0, u0ij, m_spatialComm, u0_data, 0, spatialDOFs-1);
-                
-                // Get temporary HYPRE vector.
-                GetHypreVectorFromData(b, bij, m_spatialComm, u0_data, 0, spatialDOFs-1);
-                
-                // Allocate memory for array holding eliminated data. 
-                w = new double[spatialDOFs];
+            // Get row indices for u0
+            u0_indices = new int[spatialDOFs];
+            for (int i = 0; i < spatialDOFs; i++) {
+                u0_indices[i] = i;
             }
             
-            // Get L as a HYPRE matrix (all rows fit on process).
-            if (!Lij || m_L_isTimedependent) GetHypreMatrixFromCRSData(L, Lij, m_spatialComm, L_rowptr, L_colinds, L_data, 0, spatialDOFs-1); 
+            // Get u0 as HYPRE vector
+            GetHypreVectorFromData(u0, u0ij, m_spatialComm, u0_data, 0, spatialDOFs-1);
             
-            // Stage-type DOF RHS
-            if (localInd[indOnProc] < m_s_butcher - 1) {
-                hypre_ParCSRMatrixMatvec(-1.0, L, u0, 0.0, b); // b <- -1.0*L*u0 + 0.0*b
+            // Get temporary HYPRE vector.
+            GetHypreVectorFromData(b, bij, m_spatialComm, u0_data, 0, spatialDOFs-1);
+        }
+        
+        // Get L as a HYPRE matrix (all rows fit on process).
+        if (!Lij || m_L_isTimedependent) {
+            GetHypreMatrixFromCRSData(L, Lij, m_spatialComm, L_rowptr[indOnProc], L_colinds[indOnProc], 
+                                        L_data[indOnProc], 0, spatialDOFs-1); 
+        }
+        
+        // Stage-type DOF RHS
+        if (localInd[indOnProc] < m_s_butcher - 1) {
+            hypre_ParCSRMatrixMatvec(-1.0, L, u0, 0.0, b); // b <- -1.0*L*u0 + 0.0*b
 
-            // Solution-type DOF RHS (note this is only ever called once at most)
-            } else {
-                // Assemble MASS matrix (all rows fit on process).
-                GetHypreMatrixFromCRSData(M, Mij, m_spatialComm, M_rowptr, M_colinds, M_data, 0, spatialDOFs-1); 
+        // Solution-type DOF RHS (note this is only ever called once at most)
+        } else {
+            // Assemble MASS matrix (all rows fit on process).
+            GetHypreMatrixFromCRSData(M, Mij, m_spatialComm, M_rowptr, M_colinds, M_data, 0, spatialDOFs-1); 
 
-                hypre_ParCSRMatrixMatvec(1.0, M, u0, 0.0, b); // b <- 1.0*M*u0 + 0.0*b            
-                temp = m_A_butcher[m_s_butcher-1][m_s_butcher-1] - m_b_butcher[m_s_butcher-1];
-                if (temp != 0.0) hypre_ParCSRMatrixMatvec(m_dt*temp, L, u0, 1.0, b); // b <- dt*temp*L*u0 + 1.0*b
+            hypre_ParCSRMatrixMatvec(1.0, M, u0, 0.0, b); // b <- 1.0*M*u0 + 0.0*b            
+            temp = m_A_butcher[m_s_butcher-1][m_s_butcher-1] - m_b_butcher[m_s_butcher-1];
+            if (temp != 0.0) hypre_ParCSRMatrixMatvec(m_dt*temp, L, u0, 1.0, b); // b <- dt*temp*L*u0 + 1.0*b
+        }
+        
+        // Copy data from HYPRE vector b into double array w
+        w[indOnProc] = new double[spatialDOFs];
+        HYPRE_IJVectorGetValues(bij, spatialDOFs, u0_indices, w[indOnProc]);
+    }
+    
+        
+    /* ------------------------------------------------------------------------------------------------- */
+    /* ------ Loop over all DOFs on this processor building their block rows in space-time matrix ------ */
+    /* ------------------------------------------------------------------------------------------------- */
+    #pragma omp parallel for schedule(dynamic)
+    for (int indOnProc = 0; indOnProc < m_nDOFPerProc; indOnProc++) {
+        int dataInd        = DOFOffset[indOnProc];      // Start of current DOF's slice of CSR arrays
+        int rowptrOffset   = indOnProc * spatialDOFs;   // Row offset for current DOF w.r.t rows on process
+        int blockColOffset = 0;    // Global space-time column index of first DOF in current block
+        int localColOffset = 0;    // Temporary variable to help indexing
+        double temp        = 0.0;  // Temporary constant 
+        
+        // Spatial discretization for current DOF
+        int              *DOF_L_rowptr  = L_rowptr[indOnProc];
+        int              *DOF_L_colinds = L_colinds[indOnProc];
+        double           *DOF_L_data    = L_data[indOnProc];
+        double           *DOF_B0        = B0[indOnProc];
+        double           *DOF_V0        = V0[indOnProc];
+        double           *DOF_w         = w[indOnProc];
+    
+        // RHS vector and initial guess at solution
+        for (int row = 0; row < spatialDOFs; row++) {
+            if (localInd[indOnProc] == m_s_butcher-1) {
+                B[rowptrOffset + row] = m_dt*m_b_butcher[m_s_butcher-1]*DOF_B0[row];
+            } else {
+                B[rowptrOffset + row] = DOF_B0[row];
             }
+            V[rowptrOffset + row] = DOF_V0[row];
             
-            // Copy data from HYPRE vector b into double array w
-            HYPRE_IJVectorGetValues(bij, spatialDOFs, u0_indices, w);
+            // Add coupling to u0 into RHS vector
+            if (blockInd[indOnProc] == 0) B[rowptrOffset + row] += DOF_w[row];
         }
         
+        if (!assembleMatrix) continue;
+        const ML_pattern &DOF_ML = ML[m_L_isTimedependent ? indOnProc : 0];
+    
+        // Global space-time column index for first DOF in current block
+        blockColOffset = spatialDOFs * m_s_butcher * blockInd[indOnProc];
     
-        std::map<int, double>::iterator it;
         /* -------------------------------------------------------- */
         /* ------ Assemble block row for a solution-type DOF ------ */
         /* -------------------------------------------------------- */
@@ -3376,109 +7331,31 @@ void SpaceTimeMatrix::RKSpaceTimeBlock(int    * &rowptr,
             // Loop over each row in spatial discretization, working from left-most column/variables to right-most
             for (int row = 0; row < spatialDOFs; row++) {
                 
-                // RHS vector and initial guess at solution
-                B[rowptrOffset + row] = m_dt*m_b_butcher[m_s_butcher-1]*B0[row];
-                V[rowptrOffset + row] = V0[row];
-                
-                
                 /* ------ Coupling to solution at previous time. No such coupling for u_1 ------ */
                 if (blockInd[indOnProc] > 0) {
-                    std::map<int, double> entries; 
-                    // Get mass-matrix data
-                    for (int j = M_rowptr[row]; j < M_rowptr[row+1]; j++) {                
-                        if (std::abs(M_data[j]) > 1e-16) {
-                            entries[M_colinds[j]] = M_data[j];
-                        }
-                    }
-    
-                    // Add spatial discretization data to mass-matrix data
+                    // -(M + dt*(a_ss - b_s)*L)
                     temp = m_A_butcher[m_s_butcher-1][m_s_butcher-1] - m_b_butcher[m_s_butcher-1];
-                    if (temp != 0.0) {
-                        temp *= m_dt;
-                        for (int j = L_rowptr[row]; j < L_rowptr[row+1]; j++) {
-                            if (std::abs(L_data[j]) > 1e-16) {
-                                entries[L_colinds[j]] += temp * L_data[j];
-                            }
-                        }
-                    }
-    
-                    // Add this data to global matrix
                     localColOffset = blockColOffset - spatialDOFs; // u_n offset by spatialDOFs from first DOF in v_{n+1}
-                    for (it = entries.begin(); it != entries.end(); it++) {
-                        colinds[dataInd] = localColOffset + it->first;
-                        data[dataInd] = -it->second;
-                        dataInd += 1;
-                    }
-                
-                // Add coupling to u0 into RHS vector
-                } else {
-                    B[rowptrOffset + row] += w[row];
+                    FillMLRow(DOF_ML, row, true, 1.0, temp != 0.0, temp * m_dt, M_data, DOF_L_data, localColOffset, -1.0, colinds, data, dataInd);
                 }
             
             
                 /* ------ Coupling to stages ------ */
                 // Loop over all stage DOFs
                 for (int i = 0; i < m_s_butcher - 1; i++) {
-                    std::map<int, double> entries2; 
-                    // Get mass-matrix data
-                    temp = m_b_butcher[i];
-                    if (temp != 0.0) {
-                        temp *= m_dt;
-                        for (int j = M_rowptr[row]; j < M_rowptr[row+1]; j++) {                
-                            if (std::abs(M_data[j]) > 1e-16) {
-                                entries2[M_colinds[j]] = temp * M_data[j];
-                            }
-                        }
-                    }
-
-                    // Add spatial discretization data to mass-matrix data
+                    // -(dt*b_i*M + dt^2*(b_i*a_ss - b_s*a_si)*L)
+                    double M_coeff = m_b_butcher[i];
                     temp = m_b_butcher[i] * m_A_butcher[m_s_butcher-1][m_s_butcher-1] - m_b_butcher[m_s_butcher-1] * m_A_butcher[m_s_butcher-1][i];
-                    if (temp != 0.0) {
-                        temp *= (m_dt * m_dt);
-                        for (int j = L_rowptr[row]; j < L_rowptr[row+1]; j++) {
-                            if (std::abs(L_data[j]) > 1e-16) {
-                                entries2[L_colinds[j]] += temp * L_data[j];
-                            }
-                        }
-                    }
-
-                    // Add this data to global matrix
                     localColOffset = blockColOffset + i*spatialDOFs; // Col indices for stage k_i
-                    for (it = entries2.begin(); it != entries2.end(); it++) {
-                        colinds[dataInd] = localColOffset + it->first;
-                        data[dataInd] = -it->second;
-                        dataInd += 1;
-                    }
+                    FillMLRow(DOF_ML, row, M_coeff != 0.0, M_coeff * m_dt, temp != 0.0, temp * (m_dt * m_dt), 
+                                M_data, DOF_L_data, localColOffset, -1.0, colinds, data, dataInd);
                 }
 
 
-                /* ------ Coupling to myself ------ */
-                std::map<int, double> entries3; 
-                // Get mass-matrix data
-                for (int j = M_rowptr[row]; j < M_rowptr[row+1]; j++) {                
-                    if (std::abs(M_data[j]) > 1e-16) {
-                        entries3[M_colinds[j]] = M_data[j];
-                    }
-                }
-
-                // Add spatial discretization data to mass-matrix data
+                /* ------ Coupling to myself: M + dt*a_ss*L ------ */
                 temp = m_A_butcher[m_s_butcher-1][m_s_butcher-1];
-                if (temp != 0.0) {
-                    temp *= m_dt;
-                    for (int j = L_rowptr[row]; j < L_rowptr[row+1]; j++) {
-                        if (std::abs(L_data[j]) > 1e-16) {
-                            entries3[L_colinds[j]] += temp * L_data[j];
-                        }
-                    }
-                }
-
-                // Add this data to global matrix
                 localColOffset = blockColOffset + (m_s_butcher-1)*spatialDOFs; // Col indices for u_{n+1}
-                for (it = entries3.begin(); it != entries3.end(); it++) {
-                    colinds[dataInd] = localColOffset + it->first;
-                    data[dataInd] = it->second;
-                    dataInd += 1;
-                }
+                FillMLRow(DOF_ML, row, true, 1.0, temp != 0.0, temp * m_dt, M_data, DOF_L_data, localColOffset, 1.0, colinds, data, dataInd);
 
                 
                 // Move to next row for current variable
@@ -3492,22 +7369,14 @@ void SpaceTimeMatrix::RKSpaceTimeBlock(int    * &rowptr,
             // Loop over each row in spatial discretization, working from left-most column/variables to right-most
             for (int row = 0; row < spatialDOFs; row++) {
                 
-                // RHS vector and initial guess at solution
-                B[rowptrOffset + row] = B0[row];
-                V[rowptrOffset + row] = V0[row];
-                
                 /* ------ Coupling to solution at previous time. No such coupling to u_0 ------ */
                 if (blockInd[indOnProc] > 0) {
                     localColOffset = blockColOffset - spatialDOFs;
-                    for (int j = L_rowptr[row]; j < L_rowptr[row+1]; j++) {
-                        colinds[dataInd] = localColOffset + L_colinds[j];
-                        data[dataInd] = L_data[j];
+                    for (int j = DOF_L_rowptr[row]; j < DOF_L_rowptr[row+1]; j++) {
+                        colinds[dataInd] = localColOffset + DOF_L_colinds[j];
+                        data[dataInd] = DOF_L_data[j];
                         dataInd += 1;
                     }
-                
-                // Add coupling to u0 into RHS vector
-                } else {
-                    B[rowptrOffset + row] += w[row];
                 }
         
                 /* ------ Coupling to previous stages, k_j ------ */
@@ -3516,10 +7385,10 @@ void SpaceTimeMatrix::RKSpaceTimeBlock(int    * &rowptr,
                     if (temp != 0.0) {
                         temp *= m_dt;
                         localColOffset = blockColOffset + j*spatialDOFs;
-                        for (int p = L_rowptr[row]; p < L_rowptr[row+1]; p++) {
-                            if (std::abs(L_data[p]) > 1e-16) {
-                                colinds[dataInd] = localColOffset + L_colinds[p];
-                                data[dataInd] = temp * L_data[p];
+                        for (int p = DOF_L_rowptr[row]; p < DOF_L_rowptr[row+1]; p++) {
+                            if (std::abs(DOF_L_data[p]) > 1e-16) {
+                                colinds[dataInd] = localColOffset + DOF_L_colinds[p];
+                                data[dataInd] = temp * DOF_L_data[p];
                                 dataInd += 1;
                             }
                         }
@@ -3527,47 +7396,25 @@ void SpaceTimeMatrix::RKSpaceTimeBlock(int    * &rowptr,
                 }
                 
 
-                /* ------ Coupling to myself ------ */
-                std::map<int, double> entries; 
-                // Get mass-matrix data
-                for (int j = M_rowptr[row]; j < M_rowptr[row+1]; j++) {                
-                    if (std::abs(M_data[j]) > 1e-16) {
-                        entries[M_colinds[j]] = M_data[j];
-                    }
-                }
-    
-                // Add spatial discretization data to mass-matrix data
+                /* ------ Coupling to myself: M + dt*a_ii*L ------ */
                 temp = m_A_butcher[localInd[indOnProc]][localInd[indOnProc]];
-                if (temp != 0.0) {
-                    temp *= m_dt;
-                    for (int j = L_rowptr[row]; j < L_rowptr[row+1]; j++) {
-                        if (std::abs(L_data[j]) > 1e-16) {
-                            entries[L_colinds[j]] += temp * L_data[j];
-                        }
-                    }
-                }
-    
-                // Add this data to global matrix
                 localColOffset = blockColOffset + localInd[indOnProc]*spatialDOFs;
-                for (it = entries.begin(); it != entries.end(); it++) {
-                    colinds[dataInd] = localColOffset + it->first;
-                    data[dataInd] = it->second;
-                    dataInd += 1;
-                }
+                FillMLRow(DOF_ML, row, true, 1.0, temp != 0.0, temp * m_dt, M_data, DOF_L_data, localColOffset, 1.0, colinds, data, dataInd);
     
                 // Move to next row for current variable
                 rowptr[rowptrOffset + row+1] = dataInd;
             }
         }
-        // Move to next DOF on process
-        rowptrOffset += spatialDOFs;
     }
     // Finished assembling component of global space-time matrix
     
-    // Check that sufficient data was allocated
-    if (dataInd > onProcNnz) {
-        std::cout << "WARNING: Space-time RK matrix has more nonzeros than allocated on process " << m_globRank << " of " << m_numProc << ".\n";
-    }
+    // Spatial discretizations no longer in use may now be evicted from cache
+    m_cache_pinned = false;
+    EvictSpatialDiscretizationCache(0.0);
+    
+    // Report memory allocated for space-time matrix relative to that used, and use of cache
+    if (assembleMatrix) ReportCSRAllocation(onProcNnz, rowptr[onProcSize]);
+    ReportSpatialDiscretizationCache();
     
     /* --- Clean up --- */
     // Data from eliminating u0
@@ -3577,18 +7424,13 @@ void SpaceTimeMatrix::RKSpaceTimeBlock(int    * &rowptr,
     if (bij)        HYPRE_IJVectorDestroy(bij);
     if (Lij)        HYPRE_IJMatrixDestroy(Lij);
     if (Mij)        HYPRE_IJMatrixDestroy(Mij);
-    if (w)          delete[] w;
+    for (size_t i = 0; i < w.size(); i++) {
+        if (w[i]) delete[] w[i];
+    }
     
     delete[] localInd;
     delete[] blockInd;
-    delete[] L_rowptr;
-    delete[] L_colinds;
-    delete[] L_data;
-    delete[] M_rowptr;
-    delete[] M_colinds;
-    delete[] M_data;
-    delete[] B0;
-    delete[] V0;
+    // NOTE: Mass matrix arrays are owned by the spatial discretization and must not be deleted here
 }
 
 
@@ -3603,6 +7445,8 @@ void SpaceTimeMatrix::RKSpaceTimeBlock(int    * &rowptr,
 NOTEs: 
     -m_t0 is assumed to be 0, and so the spatial discretization is evaluated at
         time t0 + (n+s)*dt == (n+s)*dt.
+    -If assembleMatrix == false, only the RHS vector and initial guess are computed,
+        and the CSR arrays are NULL.
 */
 void SpaceTimeMatrix::BDFSpaceTimeBlock(int    * &rowptr, 
                                         int    * &colinds, 
@@ -3611,23 +7455,27 @@ void SpaceTimeMatrix::BDFSpaceTimeBlock(int    * &rowptr,
                                         double * &V, 
                                         int      &localMinRow, 
                                         int      &localMaxRow, 
-                                        int      &spatialDOFs) 
+                                        int      &spatialDOFs,
+                                        bool      assembleMatrix) 
 {
     int globalInd = m_DOFInd; // Index of temporal DOF on process
     
     /* --- Get spatial discretization at time required temporal DOF on process --- */
-    int      L_nnzOnProc;
-    int    * L_rowptr;
-    int    * L_colinds;
-    double * L_data;
-    bool     getV0 = true; // Get initial guess at solution from getSpatialDiscretizationL
+    CSR_buffer    L_buffer = {};
+    Vector_buffer V_buffer = {};
+    bool          getV0 = true; // Get initial guess at solution from getSpatialDiscretizationL
+    double        discStart = MPI_Wtime();
     getSpatialDiscretizationG(m_spatialComm, B, localMinRow, localMaxRow, spatialDOFs, 
                                 m_t0 + (globalInd+m_s_multi)*m_dt);
-    getSpatialDiscretizationL(m_spatialComm, L_rowptr, L_colinds, L_data, 
-                                V, getV0, localMinRow, localMaxRow, spatialDOFs, 
+    getSpatialDiscretizationL(m_spatialComm, L_buffer, V_buffer, getV0, 
+                                localMinRow, localMaxRow, spatialDOFs, 
                                 m_t0 + (globalInd+m_s_multi)*m_dt, m_bsize);
-    int onProcSize = localMaxRow - localMinRow + 1; // Number of rows on process
-    L_nnzOnProc    = L_rowptr[onProcSize] - L_rowptr[0];   
+    m_phase_time[TIMER_SPATIAL_DISC] += MPI_Wtime() - discStart;
+    int onProcSize     = localMaxRow - localMinRow + 1; // Number of rows on process
+    int    * L_rowptr  = L_buffer.rowptr;
+    int    * L_colinds = L_buffer.colinds;
+    double * L_data    = L_buffer.data;
+    V                  = TakeBuffer(V_buffer, onProcSize); // V is handed over to caller
     
     /* --- Get mass matrix ---*/
     int      M_nnzOnProc;
@@ -3638,27 +7486,26 @@ void SpaceTimeMatrix::BDFSpaceTimeBlock(int    * &rowptr,
     if (!m_M_exists) setIdentityMassLocalRange(localMinRow, localMaxRow); 
     getMassMatrix(M_rowptr, M_colinds, M_data);
     M_nnzOnProc = M_rowptr[onProcSize] - M_rowptr[0];
+    
+    /* --- Get merged sparsity pattern of M and L --- */
+    ML_pattern ML;
+    if (assembleMatrix) GetMLPattern(ML, onProcSize, M_rowptr, M_colinds, M_data, L_rowptr, L_colinds, L_data);
 
 
-    /* --- Get total NNZ estimate on process --- */
-    //  -Doesn't assume sparsity of M and L overlap: Estimate will be an upperbound.
-    int onProcNnz = 0;
-    // Coupling to myself
-    onProcNnz += M_nnzOnProc;
-    onProcNnz += L_nnzOnProc;
+    /* --- Get total NNZ on process --- */
+    int onProcNnz = assembleMatrix ? BDFBlockRowNnz(ML, globalInd, M_nnzOnProc) : 0;
     
-    // Coupling to DOFs at s previous times
-    if (globalInd > m_s_multi - 1) {
-        onProcNnz += m_s_multi * M_nnzOnProc;
-    } else { // Or n times if n < s
-        onProcNnz += globalInd * M_nnzOnProc;
+    if (assembleMatrix) {
+        rowptr    = new int[onProcSize + 1];
+        rowptr[0] = 0; 
+        colinds   = new int[onProcNnz];
+        data      = new double[onProcNnz];
+    } else {
+        rowptr    = NULL;
+        colinds   = NULL;
+        data      = NULL;
     }
     
-    rowptr    = new int[onProcSize + 1];
-    rowptr[0] = 0; 
-    colinds   = new int[onProcNnz];
-    data      = new double[onProcNnz];
-    
     int dataInd      = 0;
     int colOffset    = 0;  // Global index of first column for DOF that we're coupling to
     double temp      = 0.0;
@@ -3667,21 +7514,19 @@ void SpaceTimeMatrix::BDFSpaceTimeBlock(int    * &rowptr,
     /* ------------------------------------------------ */
     /* ------ Build block row for DOF on process ------ */
     /* ------------------------------------------------ */
-    std::map<int, double>::iterator it;
-
-    // Loop over all rows of spatial discretization on process
+    // RHS vector
     for (int row = 0; row < onProcSize; row++) {
         B[row] *= m_dt*m_b_multi[0]; // PDE source term. NOTE: Only b_s is stored for BDF schemes 
-    
-        // Number of previous DOFs current DOF couples to
-        int s_effective = m_s_multi;
         
-        // First s DOFs only couple to the n times before them rather than all s
-        if (globalInd <= m_s_multi - 1) {
-            s_effective = globalInd;
-            // Add precomputed w[n] vector holding all necessary starting-value information
-            B[row] += m_w_multi[globalInd][row];
-        }
+        // First s DOFs: Add precomputed w[n] vector holding all necessary starting-value information
+        if (globalInd <= m_s_multi - 1) B[row] += m_w_multi[globalInd][row];
+    }
+    
+    // Loop over all rows of spatial discretization on process
+    for (int row = 0; assembleMatrix && row < onProcSize; row++) {
+        // Number of previous DOFs current DOF couples to. First s DOFs only couple 
+        // to the n times before them rather than all s
+        int s_effective = (globalInd <= m_s_multi - 1) ? globalInd : m_s_multi;
         
         // Global index of furthest DOF current DOF couples back to
         colOffset = (globalInd - s_effective) * spatialDOFs;
@@ -3697,46 +7542,23 @@ void SpaceTimeMatrix::BDFSpaceTimeBlock(int    * &rowptr,
             colOffset += spatialDOFs;
         }
     
-        /* ------ Block-diagonal component ------ */
-        std::map<int, double> entries; 
-        // Get mass-matrix data
-        for (int j = M_rowptr[row]; j < M_rowptr[row+1]; j++) {                
-            if (std::abs(M_data[j]) > 1e-16) {
-                entries[M_colinds[j]] = M_data[j];
-            }
-        }
-
-        // Add spatial discretization data to mass-matrix data
+        /* ------ Block-diagonal component: M + dt*b_s*L ------ */
         temp = m_dt * m_b_multi[0]; // Note only b_s is stored for BDF schemes
-        for (int j = L_rowptr[row]; j < L_rowptr[row+1]; j++) {
-            if (std::abs(L_data[j]) > 1e-16) {
-                entries[L_colinds[j]] += temp * L_data[j];
-            }
-        }
-
-        // Add this data to global matrix
-        for (it = entries.begin(); it != entries.end(); it++) {
-            colinds[dataInd] = it->first + colOffset;
-            data[dataInd]    = it->second;
-            dataInd         += 1;
-        }
+        FillMLRow(ML, row, true, 1.0, true, temp, M_data, L_data, colOffset, 1.0, colinds, data, dataInd);
 
         // Move to next row of spatial discretization for current DOF
         rowptr[row+1] = dataInd;
     }
     
-    // Check sufficient data was allocated
+    // Check that exact count of nonzeros was correct and report memory allocated relative to that used
     if (dataInd > onProcNnz) {
         std::cout << "WARNING: Space-time BDF matrix has more nonzeros than allocated on process " << m_globRank << " of " << m_numProc << ".\n";
     }
+    if (assembleMatrix) ReportCSRAllocation(onProcNnz, dataInd);
     
     // Clean up.
-    delete[] L_rowptr;
-    delete[] L_colinds;
-    delete[] L_data;
-    delete[] M_rowptr;
-    delete[] M_colinds;
-    delete[] M_data;
+    FreeBuffer(L_buffer);
+    // NOTE: Mass matrix arrays are owned by the spatial discretization and must not be deleted here
     
     // Information for initializing space-time RHS vector no longer needed.
     for (int i = 0; i < m_w_multi.size(); i++) {
@@ -3753,6 +7575,10 @@ void SpaceTimeMatrix::BDFSpaceTimeBlock(int    * &rowptr,
         solution at the new time.
     
     Uses spatial parallelism.
+
+NOTES:
+    -If assembleMatrix == false, only the RHS vector and initial guess are computed,
+        and the CSR arrays are NULL.
 */
 void SpaceTimeMatrix::RKSpaceTimeBlock(int    * &rowptr, 
                                        int    * &colinds, 
@@ -3761,7 +7587,8 @@ void SpaceTimeMatrix::RKSpaceTimeBlock(int    * &rowptr,
                                        double * &V, 
                                        int      &localMinRow, 
                                        int      &localMaxRow, 
-                                       int      &spatialDOFs)
+                                       int      &spatialDOFs,
+                                       bool      assembleMatrix)
 {
 
     int globalInd = m_DOFInd;                   // Global index of variable on process
@@ -3769,22 +7596,26 @@ void SpaceTimeMatrix::RKSpaceTimeBlock(int    * &rowptr,
     int blockInd  = globalInd / m_s_butcher;    // Block index of variable on process
     
     /* --- Get spatial discretization at time required by DOF on process --- */    
-    int      L_nnzOnProc;
-    int    * L_rowptr;
-    int    * L_colinds;
-    double * L_data;
-    bool     getV0 = true; // Get initial guess at solution from getSpatialDiscretizationL
-    double   t = m_dt*blockInd + m_dt*m_c_butcher[localInd]; // Time to evaluate spatial discretization, as required by first DOF on process. 
+    int           L_nnzOnProc;
+    CSR_buffer    L_buffer = {};
+    Vector_buffer V_buffer = {};
+    bool          getV0 = true; // Get initial guess at solution from getSpatialDiscretizationL
+    double        t = m_t0 + m_dt*blockInd + m_dt*m_c_butcher[localInd]; // Time to evaluate spatial discretization, as required by first DOF on process. 
     
+    double discStart = MPI_Wtime();
     getSpatialDiscretizationG(m_spatialComm, B, localMinRow, localMaxRow, spatialDOFs, t);
-    getSpatialDiscretizationL(m_spatialComm, L_rowptr, L_colinds, L_data, 
-                                V, getV0, localMinRow, localMaxRow, spatialDOFs, t, m_bsize);
-    int onProcSize = localMaxRow - localMinRow + 1; // Number of rows on process
-    L_nnzOnProc    = L_rowptr[onProcSize] - L_rowptr[0]; 
+    getSpatialDiscretizationL(m_spatialComm, L_buffer, V_buffer, getV0, 
+                                localMinRow, localMaxRow, spatialDOFs, t, m_bsize);
+    m_phase_time[TIMER_SPATIAL_DISC] += MPI_Wtime() - discStart;
+    int onProcSize     = localMaxRow - localMinRow + 1; // Number of rows on process
+    int    * L_rowptr  = L_buffer.rowptr;
+    int    * L_colinds = L_buffer.colinds;
+    double * L_data    = L_buffer.data;
+    L_nnzOnProc        = L_rowptr[onProcSize] - L_rowptr[0]; 
+    V                  = TakeBuffer(V_buffer, onProcSize); // V is handed over to caller
 
     
     /* --- Get mass matrix ---*/
-    int      M_nnzOnProc;
     int    * M_rowptr;
     int    * M_colinds;
     double * M_data;
@@ -3792,53 +7623,25 @@ void SpaceTimeMatrix::RKSpaceTimeBlock(int    * &rowptr,
     // Setup range of identity matrix to assemble if spatial discretization doesn't use a mass matrix
     if (!m_M_exists) setIdentityMassLocalRange(localMinRow, localMaxRow); 
     getMassMatrix(M_rowptr, M_colinds, M_data);
-    M_nnzOnProc = M_rowptr[onProcSize] - M_rowptr[0];
 
+    /* --- Get merged sparsity pattern of M and L --- */
+    ML_pattern ML;
+    if (assembleMatrix) GetMLPattern(ML, onProcSize, M_rowptr, M_colinds, M_data, L_rowptr, L_colinds, L_data);
 
-    /* ------ Get total NNZ on this processor. ------ */
-    //  -Doesn't assume sparsity of M and L overlap: This nnz count is an upperbound.
-    int onProcNnz = 0;
-    /* --- Solution-type DOF --- */
-    if (localInd == m_s_butcher-1) 
-    {
-        // Coupling to solution DOF at previous time. No such coupling for u_1
-        if (blockInd > 0) {                
-            onProcNnz += M_nnzOnProc;
-            if (m_A_butcher[m_s_butcher-1][m_s_butcher-1] - m_b_butcher[m_s_butcher-1] != 0.0) onProcNnz += L_nnzOnProc; 
-        }
-        
-        // Coupling to stage DOFs
-        for (int i = 0; i < m_s_butcher-1; i++) {
-            if (m_b_butcher[i] != 0.0) onProcNnz += M_nnzOnProc;
-            if (m_A_butcher[m_s_butcher-1][m_s_butcher-1]*m_b_butcher[i] - m_A_butcher[m_s_butcher-1][i]*m_b_butcher[m_s_butcher-1] != 0.0) onProcNnz += L_nnzOnProc;
-        }
-        
-        // Coupling to myself
-        onProcNnz += M_nnzOnProc;
-        if (m_A_butcher[m_s_butcher-1][m_s_butcher-1] != 0.0) onProcNnz += L_nnzOnProc;
-
-    }
-    /* --- Stage-type DOF --- */ 
-    else 
-    {
-        // Coupling to solution at previous time. No such coupling for first set of stages at t=0
-        if (blockInd > 0) onProcNnz += L_nnzOnProc;
 
-        // Coupling to previous stages 
-        for (int j = 0; j < localInd; j++) {
-            if (m_A_butcher[localInd][j] != 0.0) onProcNnz += L_nnzOnProc;
-        }
-        
-        // Coupling to myself
-        onProcNnz += M_nnzOnProc;
-        if (m_A_butcher[localInd][localInd] != 0.0) onProcNnz += L_nnzOnProc;
-    }
-    
+    /* ------ Get total NNZ on this processor. ------ */
+    int onProcNnz = assembleMatrix ? RKBlockRowNnz(ML, localInd, blockInd, L_nnzOnProc) : 0;
     
-    rowptr    = new int[onProcSize + 1];
-    colinds   = new int[onProcNnz];
-    data      = new double[onProcNnz];
-    rowptr[0] = 0;  
+    if (assembleMatrix) {
+        rowptr    = new int[onProcSize + 1];
+        colinds   = new int[onProcNnz];
+        data      = new double[onProcNnz];
+        rowptr[0] = 0;  
+    } else {
+        rowptr    = NULL;
+        colinds   = NULL;
+        data      = NULL;
+    }
     
     int dataInd        = 0;
     int blockColOffset = 0;    // Global space-time column index of first DOF in current block
@@ -3869,7 +7672,7 @@ void SpaceTimeMatrix::RKSpaceTimeBlock(int    * &rowptr,
     if (blockInd == 0) {
         
         // Get initial condition as HYPRE vector. 
-        getInitialCondition(m_spatialComm, u0_data, localMinRow, localMaxRow, spatialDOFs);
+        GetSpaceTimeInitialCondition(m_spatialComm, u0_data, localMinRow, localMaxRow, spatialDOFs);
         
         // Get local row indices for u0
         u0_indices = new int[onProcSize];
@@ -3907,117 +7710,49 @@ void SpaceTimeMatrix::RKSpaceTimeBlock(int    * &rowptr,
         HYPRE_IJVectorGetValues(bij, onProcSize, u0_indices, w);
     }
     
+    /* --- RHS vector --- */
+    for (int row = 0; row < onProcSize; row++) {
+        // Scale RHS vector of solution-type DOF
+        if (localInd == m_s_butcher-1) B[row] *= m_dt*m_b_butcher[m_s_butcher-1];
+        
+        // Add coupling to u0 into RHS vector
+        if (blockInd == 0) B[row] += w[row];
+    }
+    
 
-    std::map<int, double>::iterator it;
     /* -------------------------------------------------------- */
     /* ------ Assemble block row for a solution-type DOF ------ */
     /* -------------------------------------------------------- */
     if (localInd == m_s_butcher-1) {
         
         // Loop over each row of spatial discretization on process, working from left-most column/variables to right-most
-        for (int row = 0; row < onProcSize; row++) {
-            
-            // Scale RHS vector
-            B[row] *= m_dt*m_b_butcher[m_s_butcher-1];
+        for (int row = 0; assembleMatrix && row < onProcSize; row++) {
             
             /* ------ Coupling to solution at previous time. No such coupling for u_1 ------ */
             if (blockInd > 0) {
-                std::map<int, double> entries; 
-                // Get mass-matrix data
-                for (int j = M_rowptr[row]; j < M_rowptr[row+1]; j++) {                
-                    if (std::abs(M_data[j]) > 1e-16) {
-                        entries[M_colinds[j]] = M_data[j];
-                    }
-                }
-
-                // Add spatial discretization data to mass-matrix data
+                // -(M + dt*(a_ss - b_s)*L)
                 temp = m_A_butcher[m_s_butcher-1][m_s_butcher-1] - m_b_butcher[m_s_butcher-1];
-                if (temp != 0.0) {
-                    temp *= m_dt;
-                    for (int j = L_rowptr[row]; j < L_rowptr[row+1]; j++) {
-                        if (std::abs(L_data[j]) > 1e-16) {
-                            entries[L_colinds[j]] += temp * L_data[j];
-                        }
-                    }
-                }
-
-                // Add this data to global matrix
                 localColOffset = blockColOffset - spatialDOFs; // u_n offset by spatialDOFs from first DOF in v_{n+1}
-                for (it = entries.begin(); it != entries.end(); it++) {
-                    colinds[dataInd] = localColOffset + it->first;
-                    data[dataInd] = -it->second;
-                    dataInd += 1;
-                }
-            
-            // Add coupling to u0 into RHS vector
-            } else {
-                B[row] += w[row];
+                FillMLRow(ML, row, true, 1.0, temp != 0.0, temp * m_dt, M_data, L_data, localColOffset, -1.0, colinds, data, dataInd);
             }
         
         
             /* ------ Coupling to stages ------ */
             // Loop over all stage DOFs
             for (int i = 0; i < m_s_butcher - 1; i++) {
-                std::map<int, double> entries2; 
-                // Get mass-matrix data
-                temp = m_b_butcher[i];
-                if (temp != 0.0) {
-                    temp *= m_dt;
-                    for (int j = M_rowptr[row]; j < M_rowptr[row+1]; j++) {                
-                        if (std::abs(M_data[j]) > 1e-16) {
-                            entries2[M_colinds[j]] = temp * M_data[j];
-                        }
-                    }
-                }
-
-                // Add spatial discretization data to mass-matrix data
+                // -(dt*b_i*M + dt^2*(b_i*a_ss - b_s*a_si)*L)
+                double M_coeff = m_b_butcher[i];
                 temp = m_b_butcher[i] * m_A_butcher[m_s_butcher-1][m_s_butcher-1] - m_b_butcher[m_s_butcher-1] * m_A_butcher[m_s_butcher-1][i];
-                if (temp != 0.0) {
-                    temp *= (m_dt * m_dt);
-                    for (int j = L_rowptr[row]; j < L_rowptr[row+1]; j++) {
-                        if (std::abs(L_data[j]) > 1e-16) {
-                            entries2[L_colinds[j]] += temp * L_data[j];
-                        }
-                    }
-                }
-
-                // Add this data to global matrix
                 localColOffset = blockColOffset + i*spatialDOFs; // Col indices for stage k_i
-                for (it = entries2.begin(); it != entries2.end(); it++) {
-                    colinds[dataInd] = localColOffset + it->first;
-                    data[dataInd] = -it->second;
-                    dataInd += 1;
-                }
+                FillMLRow(ML, row, M_coeff != 0.0, M_coeff * m_dt, temp != 0.0, temp * (m_dt * m_dt), 
+                            M_data, L_data, localColOffset, -1.0, colinds, data, dataInd);
             }
 
 
-            /* ------ Coupling to myself ------ */
-            std::map<int, double> entries3; 
-            // Get mass-matrix data
-            for (int j = M_rowptr[row]; j < M_rowptr[row+1]; j++) {                
-                if (std::abs(M_data[j]) > 1e-16) {
-                    entries3[M_colinds[j]] = M_data[j];
-                }
-            }
-
-            // Add spatial discretization data to mass-matrix data
+            /* ------ Coupling to myself: M + dt*a_ss*L ------ */
             temp = m_A_butcher[m_s_butcher-1][m_s_butcher-1];
-            if (temp != 0.0) {
-                temp *= m_dt;
-                for (int j = L_rowptr[row]; j < L_rowptr[row+1]; j++) {
-                    if (std::abs(L_data[j]) > 1e-16) {
-                        entries3[L_colinds[j]] += temp * L_data[j];
-                    }
-                }
-            }
-
-            // Add this data to global matrix
             localColOffset = blockColOffset + (m_s_butcher-1)*spatialDOFs; // Col indices for u_{n+1}
-            for (it = entries3.begin(); it != entries3.end(); it++) {
-                colinds[dataInd] = localColOffset + it->first;
-                data[dataInd] = it->second;
-                dataInd += 1;
-            }
+            FillMLRow(ML, row, true, 1.0, temp != 0.0, temp * m_dt, M_data, L_data, localColOffset, 1.0, colinds, data, dataInd);
 
             
             // Move to next row for current variable
@@ -4029,7 +7764,7 @@ void SpaceTimeMatrix::RKSpaceTimeBlock(int    * &rowptr,
     /* ----------------------------------------------------- */
     } else {
         // Loop over each row of spatial discretization on process, working from left-most column/variables to right-most
-        for (int row = 0; row < onProcSize; row++) {
+        for (int row = 0; assembleMatrix && row < onProcSize; row++) {
             
             /* ------ Coupling to solution at previous time. No such coupling to u_0 ------ */
             if (blockInd > 0) {
@@ -4039,10 +7774,6 @@ void SpaceTimeMatrix::RKSpaceTimeBlock(int    * &rowptr,
                     data[dataInd] = L_data[j];
                     dataInd += 1;
                 }
-            
-            // Add coupling to u0 into RHS vector
-            } else {
-                B[row] += w[row];
             }
     
             /* ------ Coupling to previous stages, k_j ------ */
@@ -4062,33 +7793,10 @@ void SpaceTimeMatrix::RKSpaceTimeBlock(int    * &rowptr,
             }
             
 
-            /* ------ Coupling to myself ------ */
-            std::map<int, double> entries; 
-            // Get mass-matrix data
-            for (int j = M_rowptr[row]; j < M_rowptr[row+1]; j++) {                
-                if (std::abs(M_data[j]) > 1e-16) {
-                    entries[M_colinds[j]] = M_data[j];
-                }
-            }
-
-            // Add spatial discretization data to mass-matrix data
+            /* ------ Coupling to myself: M + dt*a_ii*L ------ */
             temp = m_A_butcher[localInd][localInd];
-            if (temp != 0.0) {
-                temp *= m_dt;
-                for (int j = L_rowptr[row]; j < L_rowptr[row+1]; j++) {
-                    if (std::abs(L_data[j]) > 1e-16) {
-                        entries[L_colinds[j]] += temp * L_data[j];
-                    }
-                }
-            }
-
-            // Add this data to global matrix
             localColOffset = blockColOffset + localInd*spatialDOFs;
-            for (it = entries.begin(); it != entries.end(); it++) {
-                colinds[dataInd] = localColOffset + it->first;
-                data[dataInd] = it->second;
-                dataInd += 1;
-            }
+            FillMLRow(ML, row, true, 1.0, temp != 0.0, temp * m_dt, M_data, L_data, localColOffset, 1.0, colinds, data, dataInd);
 
             // Move to next row for DOF
             rowptr[row+1] = dataInd;
@@ -4096,10 +7804,11 @@ void SpaceTimeMatrix::RKSpaceTimeBlock(int    * &rowptr,
     }
     // Finished assembling component of global space-time matrix
     
-    // Check that sufficient data was allocated
+    // Check that exact count of nonzeros was correct and report memory allocated relative to that used
     if (dataInd > onProcNnz) {
         std::cout << "WARNING: Space-time RK matrix has more nonzeros than allocated on process " << m_globRank << " of " << m_numProc << ".\n";
     }
+    if (assembleMatrix) ReportCSRAllocation(onProcNnz, dataInd);
     
     /* --- Clean up --- */
     // Data from eliminating u0
@@ -4111,12 +7820,8 @@ void SpaceTimeMatrix::RKSpaceTimeBlock(int    * &rowptr,
     if (Mij)        HYPRE_IJMatrixDestroy(Mij);
     if (w)          delete[] w;
     
-    delete[] L_rowptr;
-    delete[] L_colinds;
-    delete[] L_data;
-    delete[] M_rowptr;
-    delete[] M_colinds;
-    delete[] M_data;
+    FreeBuffer(L_buffer);
+    // NOTE: Mass matrix arrays are owned by the spatial discretization and must not be deleted here
 }
 
 
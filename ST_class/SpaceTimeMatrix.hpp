@@ -3,11 +3,13 @@
 #include <map>
 #include <vector>
 #include <string>
+#include <thread>
 #include <iostream>
 #include "HYPRE_IJ_mv.h"
 #include "HYPRE_parcsr_ls.h"
 #include "_hypre_parcsr_mv.h"
 #include "_hypre_parcsr_ls.h"
+#include "_hypre_IJ_mv.h"
 #include "HYPRE_krylov.h"
 #define SPACETIMEMATRIX
 
@@ -54,8 +56,192 @@ struct Solver_parameters {
     bool   lump_mass;           /* Lump mass matrix so that it's diagonal */
     
     int    multi_init;          /* Technique for initializing multistep solution. 0 == RK integration; 1 == User provided exact solution */
+    
+    bool   matrix_free;         /* Apply space-time matrix without assembling it when no preconditioner needs it */
+    bool   kron_storage;        /* Store time-invariant space-time matrix in Kronecker form, expanding block rows into hypre matrix on demand */
+    
+    double rebuildTol;          /* Time-stepping: Rebuild solver once iterations (or convergence rate) degrade by more than this factor relative to first solve after last rebuild. 0 == use rebuildRate */
+    
+    int    initial_guess;       /* Time-stepping: Initial guess for linear solves. 0 == RHS of system; 1 == previous stage (DIRK) or step (BDF); 2 == linear extrapolation from previous steps; 3 == quadratic extrapolation from previous steps */
+    
+    double dt_rtol;             /* RK time-stepping: Relative local error tolerance for adaptive time steps. 0 (and dt_atol == 0) == constant time step */
+    double dt_atol;             /* RK time-stepping: Absolute local error tolerance for adaptive time steps */
+    
+    int    mass_solver;         /* Solver for non-lumped mass matrix (not scaled by block inverse). 0 == CG; 1 == Jacobi-preconditioned CG; 2 == block-Jacobi-preconditioned CG; 3 == Chebyshev iteration with Jacobi; 4 == Chebyshev iteration with block Jacobi */
+    int    mass_cheby_iters;    /* Number of Chebyshev iterations per mass matrix solve. 0 == enough to reduce error by tol in theory */
+};
+
+/* Struct containing the merged sparsity pattern of a mass matrix M and spatial 
+    discretization L. Every slot (i.e., unique column of a row of M union L) records 
+    which entries of M and L contribute to it, so that block rows of the form 
+    alpha*M + beta*L can be filled numerically without searching for overlaps. */
+struct ML_pattern {
+    std::vector<int> rowptr;    /* Row pointer of merged pattern */
+    std::vector<int> colinds;   /* Column indices of merged pattern, sorted within each row */
+    std::vector<int> M_ind;     /* Index into M_colinds/M_data stored in each slot; -1 if slot has no M entry */
+    std::vector<int> L_ptr;     /* Pointer into L_ind for each slot */
+    std::vector<int> L_ind;     /* Indices into L_colinds/L_data summed into each slot */
+    int              M_slots;   /* Number of slots holding an M entry */
+    int              L_slots;   /* Number of slots holding an L entry */
+};
+
+/* Structs describing CSR matrix and vector storage passed from a spatial discretization 
+    to the space-time solver. If owned, the storage was allocated with new[] and is handed 
+    over, so the receiver must delete[] it (see FreeBuffer). Otherwise it is lent: it still 
+    belongs to the spatial discretization, and must remain valid and unchanged for as long 
+    as the spatial discretization exists, so that the receiver may wrap it without copying. */
+struct CSR_buffer {
+    int    * rowptr;
+    int    * colinds;
+    double * data;
+    bool     owned;         /* Receiver is responsible for deleting storage */
+};
+struct Vector_buffer {
+    double * data;
+    bool     owned;         /* Receiver is responsible for deleting storage */
 };
 
+/* Struct containing a spatial discretization (L and U0, or G) evaluated at a given time, 
+    as stored in the cache of spatial discretizations */
+struct SpatialDisc_cacheEntry {
+    double        t;            /* Time spatial discretization was evaluated at */
+    int           spatialDOFs;  /* Number of spatial DOFs */
+    int           bsize;        /* Block size of L */
+    CSR_buffer    L;            /* Spatial discretization */
+    Vector_buffer U0;           /* Initial guess at solution */
+    Vector_buffer G;            /* PDE source term */
+    double        bytes;        /* Memory owned by entry */
+    long          lastUse;      /* Value of use counter when entry was last used */
+};
+
+/* Struct containing the space-time matrix in Kronecker-product form, 
+        A = T_M \otimes M + T_L \otimes L,
+    for time-independent M and L, where T_M and T_L are (sparse) temporal coefficient 
+    matrices. The rows of T_M and T_L for the temporal DOFs on process are stored as 
+    couplings of the form (c_M*M + c_L*L) to another temporal DOF. Block rows of A are 
+    only expanded on demand. No spatial parallelism. The DOFs on other processes that 
+    are coupled to form a halo. */
+struct Kronecker_operator {
+    int                 spatialDOFs;
+    ML_pattern          ML;             /* Merged sparsity pattern of M and L */
+    std::vector<int>    M_rowptr;
+    std::vector<int>    M_colinds;
+    std::vector<double> M_data;
+    std::vector<int>    L_rowptr;
+    std::vector<int>    L_colinds;
+    std::vector<double> L_data;
+    std::vector<int>    coupling_ptr;   /* Pointer into coupling arrays for each DOF on process */
+    std::vector<int>    coupling_DOF;   /* Global index of temporal DOF coupled to */
+    std::vector<double> coupling_M;     /* Coefficient of M in coupling */
+    std::vector<double> coupling_L;     /* Coefficient of L in coupling */
+    int                 haloDOF0;       /* Global index of first temporal DOF in halo */
+    std::vector<double> halo;           /* Values at temporal DOFs in halo */
+    std::vector<int>    send_rank;      /* Processes that DOFs on process are sent to... */
+    std::vector<int>    send_DOF0;      /* ...the global index of the first DOF sent... */
+    std::vector<int>    send_nDOF;      /* ...and the number of DOFs sent */
+    std::vector<int>    recv_rank;      /* Processes that halo DOFs are received from... */
+    std::vector<int>    recv_DOF0;      /* ...the global index of the first DOF received... */
+    std::vector<int>    recv_nDOF;      /* ...and the number of DOFs received */
+};
+
+#define CHECKPOINT_MAGIC 0x53544350 /* "STCP" */
+
+/* DIRK matrix M/(dt*a_ii) + L for one value of dt*a_ii, and the solver set up for it */
+struct DIRK_system {
+    double              scaling;    /* 1/(dt*a_ii) */
+    HYPRE_ParCSRMatrix  A;
+    HYPRE_IJMatrix      Aij;
+    HYPRE_Solver        amg;        /* AMG solver (or GMRES preconditioner); NULL until first solve */
+    HYPRE_Solver        gmres;      /* GMRES solver if used; NULL until first solve */
+    HYPRE_ParCSRMatrix  A_s;        /* A scaled by inverse of its block diagonal if used; NULL until first solve */
+    double              bytes;      /* Memory of matrix and solver on this process */
+    long                lastUse;    /* Value of use counter when last used */
+};
+
+/* Diagonal block of the space-time matrix (the spatial system of one temporal DOF), and 
+    the AMG solver set up for it, shared by all DOFs on process with the same block */
+struct BlockFS_system {
+    std::vector<int>    rowptr;
+    std::vector<int>    colinds;
+    std::vector<double> data;
+    HYPRE_ParCSRMatrix  A;          /* Block on MPI_COMM_SELF */
+    HYPRE_IJMatrix      Aij;
+    HYPRE_Solver        amg;        /* NULL until set up */
+    bool                used;       /* Diagonal block of some DOF on process */
+};
+
+/* Block forward-substitution preconditioner for a space-time matrix that is block lower 
+    triangular in time: Temporal DOFs are swept in order, solving with each diagonal block 
+    approximately with AMG. Each process holds consecutive DOFs, so the sweep is pipelined 
+    across processes. No spatial parallelism. */
+struct BlockFS_preconditioner {
+    int                         spatialDOFs;
+    int                         nBlocks;        /* Number of temporal DOFs on process */
+    std::vector<BlockFS_system> systems;        /* Distinct diagonal blocks */
+    std::vector<int>            blockSystem;    /* Index into systems of each DOF's diagonal block */
+    HYPRE_ParVector             r;              /* RHS and solution of a block solve */
+    HYPRE_IJVector              rij;
+    HYPRE_ParVector             z;
+    HYPRE_IJVector              zij;
+    int                         numLowerCols;   /* Off-process columns of earlier DOFs: the first numLowerCols of col_map_offd */
+    std::vector<double>         lowerValues;    /* Values of solution at these columns */
+    std::vector<int>            recv_rank;      /* Processes values at these columns are received from... */
+    std::vector<int>            recv_ptr;       /* ...and pointer into columns received from each */
+    std::vector<int>            send_rank;      /* Processes (later) values on process are sent to... */
+    std::vector<int>            send_ptr;       /* ...pointer into send_rows for each... */
+    std::vector<int>            send_rows;      /* ...and local rows sent */
+    std::vector<double>         send_values;
+};
+
+/* Header of a checkpoint file written by one process during sequential time-stepping. 
+    It is followed by the rows ilower,...,iupper of each of the numVectors vectors saved. */
+struct Checkpoint_header {
+    int    magic;       /* Identifies file as a checkpoint */
+    int    timeDisc;    /* Time-integration scheme */
+    int    nt;
+    double dt;
+    int    step;        /* Number of time steps taken */
+    double t;           /* Time of most recent solution */
+    double dt_next;     /* Step size of next step (may differ from dt with adaptive time-stepping) */
+    int    numVectors;  /* Number of vectors saved */
+    int    globalSize;  /* Global size of each vector */
+    int    ilower;      /* Range of rows saved by this process */
+    int    iupper;
+    int    numFiles;    /* Number of processes that wrote the checkpoint */
+};
+
+/* Copy of the rows of a solution snapshot owned by one process, written to file by a 
+    background thread while time-stepping continues */
+struct Snapshot_buffer {
+    double      * data;     /* Rows ilower,...,iupper of solution */
+    int           capacity; /* Number of doubles allocated for data */
+    int           ilower;
+    int           iupper;
+    std::string   filename; /* File that data is written to */
+    std::thread   writer;   /* Thread writing data to file (joinable until write has finished) */
+};
+
+/* Struct containing a ring buffer of the most recent solutions of a linear system that 
+    is solved once per time step (e.g., for the ith DIRK stage, or for the BDF solution), 
+    from which an initial guess at its next solution is extrapolated */
+struct Solution_history {
+    std::vector<HYPRE_ParVector> x;     /* Stored solutions */
+    std::vector<HYPRE_IJVector>  xij;
+    int                          head;  /* Index of most recently stored solution */
+    int                          count; /* Number of solutions stored, at most x.size() */
+};
+
+/* Phases of the code whose wall time is measured, indexing m_phase_time. Phases may be 
+    nested (e.g., spatial discretizations are evaluated during space-time assembly) */
+#define TIMER_SPATIAL_DISC      0   /* Evaluating spatial discretizations L, G (and U0) */
+#define TIMER_ST_ASSEMBLY       1   /* Building space-time matrix, RHS and initial guess */
+#define TIMER_IJ_ASSEMBLY       2   /* Building HYPRE matrices and vectors from CRS data */
+#define TIMER_SOLVER_SETUP      3   /* Setup of AMG and GMRES solvers */
+#define TIMER_SOLVE             4   /* AMG and GMRES solves */
+#define TIMER_MASS_SOLVE        5   /* Mass-matrix solves, including solver setup */
+#define TIMER_STARTING_VALUES   6   /* Computing multistep starting values */
+#define NUM_TIMERS              7
+
 
 class SpaceTimeMatrix
 {
@@ -90,6 +276,10 @@ private:
     std::vector<std::vector<double>> m_A_butcher; /* Coefficients in RK Butcher tableaux */
     std::vector<double>              m_b_butcher; /* Coefficients in RK Butcher tableaux */
     std::vector<double>              m_c_butcher; /* Coefficients in RK Butcher tableaux */
+    std::vector<double>              m_bhat_butcher; /* Weights of embedded RK solution; empty if scheme has no embedded pair */
+    int                              m_bhat_order;   /* Order of embedded RK solution */
+    int                              m_accepted_steps; /* Adaptive RK time-stepping: Number of accepted steps */
+    int                              m_rejected_steps; /* Adaptive RK time-stepping: Number of rejected steps */
 
     bool                m_multi;   /* Multistep time integration */
     bool                m_AB;      /* Adams--Bashforth time integration */
@@ -113,6 +303,11 @@ private:
     HYPRE_IJMatrix      m_invMij; 
     HYPRE_ParCSRMatrix  m_A;
     HYPRE_IJMatrix      m_Aij;
+    HYPRE_ParCSRMatrix  m_A_s;                  /* m_binv_A scaled by inverse of its block diagonal (if binv_scale) */
+    HYPRE_ParCSRMatrix  m_binv_A;               /* Matrix m_A_s was computed from (its block inverses are stored in it) */
+    bool                m_matrixFree;           /* Space-time matrix is applied matrix-free rather than assembled into m_A */
+    Kronecker_operator  m_kron;                 /* Space-time matrix in Kronecker-product form */
+    BlockFS_preconditioner m_blockFS;           /* Block forward-substitution preconditioner (gmres_preconditioner == 3) */
     HYPRE_ParVector     m_b;
     HYPRE_IJVector      m_bij;
     HYPRE_ParVector     m_x;
@@ -127,6 +322,36 @@ private:
     double              m_convergence_factor;   /* Average convergence factor during solve */
     double              m_res_norm;             /* Residual norm after solve */
     int                 m_hypre_ierr;           /* Generic error flag for HYPRE functions */
+    bool                m_solverRebuilt;        /* Solver was (re)built for most recent solve */
+    double              m_setup_time;           /* Wall time of solver setup in most recent solve (0 if not rebuilt) */
+    double              m_solve_time;           /* Wall time of most recent solve */
+    std::vector<int>    m_step_iters;           /* Iterations of each linear solve during time-stepping */
+    int                 m_solve_count;          /* Number of AMG/GMRES solves */
+    int                 m_total_iters;          /* Total iterations of AMG/GMRES solves */
+    double              m_max_res_norm;         /* Largest final residual norm of AMG/GMRES solves */
+    
+    /* --- Wall time of phases of the code (indexed by TIMER_*) --- */
+    double  m_phase_time[NUM_TIMERS];   /* Time spent in each phase on this process */
+    double  m_phase_min[NUM_TIMERS];    /* Minimum, maximum and average of m_phase_time over all */
+    double  m_phase_max[NUM_TIMERS];    /*  processes, as of the end of the last call to Solve */
+    double  m_phase_avg[NUM_TIMERS];
+    
+    /* --- Adaptive solver rebuild during time-stepping --- */
+    bool    m_rebuild_due;              /* Convergence has degraded enough to rebuild solver at next opportunity */
+    int     m_rebuild_baseIters;        /* Iterations of first solve after last rebuild */
+    double  m_rebuild_baseRate;         /* Convergence rate, -log(convergence factor), of first solve after last rebuild */
+    double  m_rebuild_baseSolveTime;    /* Wall time of first solve after last rebuild */
+    double  m_rebuild_setupTime;        /* Wall time of last rebuild */
+    double  m_rebuild_staleTime;        /* Solve time in excess of baseline since last rebuild */
+    
+    /* --- Preconditioned CG and Chebyshev solves with the mass matrix (mass_solver > 0) --- */
+    std::vector<double>          m_massPrecond;     /* Inverse of (block) diagonal of M; blocks stored consecutively, row-wise */
+    int                          m_massBsize;       /* Block size of m_massPrecond (1 == Jacobi) */
+    double                       m_massEigMin;      /* Bounds on eigenvalues of preconditioned M for Chebyshev iteration */
+    double                       m_massEigMax;
+    int                          m_massChebyIters;  /* Iterations of a Chebyshev solve */
+    std::vector<HYPRE_ParVector> m_massWork;        /* Work vectors of Chebyshev iteration and eigenvalue estimate */
+    std::vector<HYPRE_IJVector>  m_massWork_ij;
     
     
     /* --- Identity-mass-matrix related --- */
@@ -135,6 +360,65 @@ private:
     bool m_rebuildMass;
     
     int     m_bsize;                /* DG specific variable... */
+    
+    /* --- Cache of spatial discretizations evaluated at different times --- */
+    std::vector<SpatialDisc_cacheEntry> m_L_cache;  /* Cached L and U0 */
+    std::vector<SpatialDisc_cacheEntry> m_G_cache;  /* Cached G */
+    double  m_cache_budget;         /* Memory budget of cache (bytes) */
+    long    m_cache_useCount;       /* Counter used to order cache entries by most recent use */
+    int     m_cache_hits;           /* Number of requests served from cache */
+    int     m_cache_misses;         /* Number of requests requiring a new spatial discretization */
+    bool    m_cache_pinned;         /* Suspend eviction while cached data of several times are in use */
+    
+    /* --- Cache of DIRK matrices and their solvers, one per distinct dt*a_ii (time-independent L only) --- */
+    std::vector<DIRK_system> m_DIRK_cache;
+    double  m_DIRK_budget;          /* Memory budget of cache (bytes) */
+    long    m_DIRK_useCount;        /* Counter used to order cache entries by most recent use */
+    int     m_DIRK_hits;            /* Number of solves with a cached matrix */
+    int     m_DIRK_misses;          /* Number of solves requiring a new matrix */
+    double  m_DIRK_maxBytes;        /* Largest memory of cache on this process */
+    
+    /* --- Pool of transient buffers, recycled across stages and steps of time-stepping --- */
+    bool    m_pool_active;          /* Allocate buffers from pool (only while evaluating spatial discretization for time-stepping) */
+    std::map<int, std::vector<int *> >    m_pool_int;       /* Free int buffers, keyed by size class */
+    std::map<int, std::vector<double *> > m_pool_double;    /* Free double buffers, keyed by size class */
+    std::map<void *, int>                 m_pool_sizeClass; /* Size class of buffers handed out by pool */
+    long    m_pool_requests;        /* Number of buffers requested from pool */
+    long    m_pool_hits;            /* Number of requests served with a recycled buffer */
+    double  m_pool_bytes;           /* Bytes allocated from the system by pool */
+    
+    /* --- Checkpointing of sequential time-stepping --- */
+    std::string m_checkpoint_prefix;    /* Checkpoints are files <prefix>.<slot>.<rank>; <prefix>.latest names the most recent slot */
+    int     m_checkpoint_rate;      /* Write a checkpoint every this many time steps; 0 == never */
+    bool    m_restart;              /* Resume time-stepping from most recent checkpoint */
+    int     m_checkpoint_count;     /* Number of checkpoints written */
+    int     m_step0;                /* Multistep: Number of time steps taken before time-stepping resumed from checkpoint */
+    
+    /* --- Output of solution snapshots during sequential time-stepping --- */
+    std::string     m_snapshot_prefix;      /* Snapshot after n steps is written to <prefix>.<n>.<rank> */
+    int             m_snapshot_rate;        /* Write snapshot every this many time steps; 0 == never */
+    Snapshot_buffer m_snapshot_buffer[2];   /* Double buffer: One snapshot is copied while the previous one is written */
+    int             m_snapshot_count;       /* Number of snapshots written */
+    std::vector<std::pair<int, double> > m_snapshot_times;  /* Step and time of each snapshot */
+    double          m_snapshot_copy_time;   /* Wall time spent copying solution into buffers */
+    double          m_snapshot_wait_time;   /* Wall time spent waiting for a buffer to be written before reusing it */
+    
+    /* --- Space-time system solved in consecutive windows of nt time steps --- */
+    int      m_num_windows;         /* Number of windows [0, T] is split into */
+    double * m_window_u0;           /* Initial condition of current window (rows of it on process); NULL for first window */
+    int      m_window_u0_size;
+    
+    /* --- Space-time systems for a batch of initial conditions, sharing one matrix and solver setup --- */
+    std::vector<double *> m_batch_u0;           /* Initial conditions (rows of them on process) */
+    int                   m_batch_u0_size;
+    std::vector<double *> m_batch_b;            /* Local rows of RHS vector and solution of each system */
+    std::vector<double *> m_batch_x;
+    std::vector<int>      m_batch_iters;        /* Iterations of each solve... */
+    std::vector<double>   m_batch_res_norm;     /* ...final relative residual norm reported by solver... */
+    std::vector<double>   m_batch_true_res_norm;/* ...true relative residual norm, ||b - A*x||/||b|| (-1 if matrix-free)... */
+    std::vector<double>   m_batch_solve_time;   /* ...and wall time of solve */
+    double                m_batch_setup_time;   /* Wall time of assembly and solver setup for first system */
+    double                m_batch_time;         /* Wall time of whole batch */
 
     // TODO : variables to remove    
     int     m_Np_x;     /* TODO : Remove. Replace with protected variable "m_spatialCommSize" */
@@ -152,12 +436,137 @@ private:
     bool SetMultiRKPairing();
     void SetMultistepStartValues();
     void SetMultistepSpaceTimeRHSValues();
-    void GetMatrix_ntLE1();
-    void GetMatrix_ntGT1();
+    void GetMatrix_ntLE1(bool getMatrix=true, bool refresh=false);
+    void GetMatrix_ntGT1(bool getMatrix=true, bool refresh=false);
     void SetBoomerAMGOptions(int printLevel=3, int maxiter=250, double tol=1e-8);
+    void CreateBoomerAMG(HYPRE_Solver &solver, int printLevel, int maxiter, double tol);
     void SetGMRESOptions();
     void SetPCGOptions();
 
+    // Symbolic and numeric phases of assembling alpha*M + beta*L couplings
+    void GetMLPattern(ML_pattern &pattern, 
+                      int         numRows, 
+                      int       * M_rowptr, 
+                      int       * M_colinds, 
+                      double    * M_data, 
+                      int       * L_rowptr, 
+                      int       * L_colinds, 
+                      double    * L_data);
+    
+    void FillMLRow(const ML_pattern &pattern, 
+                   int               row, 
+                   bool              useM,
+                   double            M_coeff,
+                   bool              useL,
+                   double            L_coeff,
+                   double          * M_data, 
+                   double          * L_data, 
+                   int               colOffset,
+                   double            sign,
+                   int             * colinds, 
+                   double          * data, 
+                   int              &dataInd);
+    
+    // Spatial discretizations through the cache. Returned arrays are owned by the cache.
+    void GetCachedSpatialDiscretizationL(int    * &L_rowptr, 
+                                         int    * &L_colinds, 
+                                         double * &L_data,
+                                         double * &U0, 
+                                         int      &spatialDOFs,
+                                         double    t);
+    void GetCachedSpatialDiscretizationG(double * &G, 
+                                         int      &spatialDOFs, 
+                                         double    t);
+    void EvictSpatialDiscretizationCache(double bytesNeeded);                                     
+    void ClearSpatialDiscretizationCache();
+    void ReportSpatialDiscretizationCache();
+    
+    int  GetCachedDIRKSystem(double scaling, double t, int ilower, int iupper, int * M_rowptr, 
+                                int * M_colinds, double * M_scaled_data);
+    void StoreCachedDIRKSolver(int systemInd);
+    void ClearDIRKCache();
+    void ReportDIRKCache();
+    double ParCSRMatrixBytes(HYPRE_ParCSRMatrix A);
+    
+    // Release storage passed from spatial discretization, deleting it only if owned
+    void FreeBuffer(CSR_buffer    &A);
+    void FreeBuffer(Vector_buffer &x);
+    double * TakeBuffer(Vector_buffer &x, int size);
+    void ClearBufferPool();
+    void ReportBufferPool();
+    
+    bool CheckpointDue(int step) { return (m_checkpoint_rate > 0 && step % m_checkpoint_rate == 0); }
+    void WriteCheckpoint(const std::vector<HYPRE_ParVector> &x, int step, double t, double dt_next);
+    bool ReadCheckpoint(const std::vector<HYPRE_ParVector> &x, int &step, double &t, double &dt_next);
+    bool ReadMultistepCheckpoint();
+    
+    bool SnapshotDue(int step) { return (m_snapshot_rate > 0 && step % m_snapshot_rate == 0); }
+    void WriteSnapshot(HYPRE_ParVector u, int step, double t);
+    void FinishSnapshots();
+    
+    void WindowedSpaceTimeSolve();
+    void BatchSpaceTimeSolve();
+    void BlockResidualNorms(HYPRE_ParCSRMatrix A, const std::vector<double *> &X, 
+                            const std::vector<double *> &B, std::vector<double> &res_norm);
+    void SetNextWindowInitialCondition();
+    void GetSpaceTimeInitialCondition(double * &u0, int &spatialDOFs);
+    void GetSpaceTimeInitialCondition(MPI_Comm spatialComm, double * &u0, 
+                                        int &localMinRow, int &localMaxRow, int &spatialDOFs);
+    
+    // Exact nnz counts of space-time block rows based on merged M/L pattern
+    int MLCouplingNnz(const ML_pattern &pattern, 
+                      bool              useM, 
+                      bool              useL);
+    int RKBlockRowNnz(const ML_pattern &pattern, 
+                      int               localInd, 
+                      int               blockInd, 
+                      int               L_nnz);
+    int BDFBlockRowNnz(const ML_pattern &pattern, 
+                       int               globalInd, 
+                       int               M_nnz);
+    void ReportCSRAllocation(int allocatedNnz, 
+                             int usedNnz);
+    
+    // Space-time matrix in Kronecker-product form, and its matrix-free application in GMRES
+    bool UseMatrixFreeOperator();
+    bool UseKroneckerStorage();
+    void SetKroneckerOperator(int      spatialDOFs,
+                               int    * M_rowptr, 
+                               int    * M_colinds, 
+                               double * M_data, 
+                               int    * L_rowptr, 
+                               int    * L_colinds, 
+                               double * L_data);
+    void MatrixFreeMatvec(double          alpha, 
+                          HYPRE_ParVector x, 
+                          double          beta, 
+                          HYPRE_ParVector y);
+    void GetKroneckerBlockRow(int       indOnProc, 
+                              int    * &rowptr, 
+                              int    * &colinds, 
+                              double * &data);
+    void MaterializeKroneckerMatrix(int  ilower, 
+                                    int  iupper,
+                                    bool refresh);
+    void MatrixFreeGMRESCreate();
+    static HYPRE_Int MatrixFreeCommInfo(void *A, HYPRE_Int *my_id, HYPRE_Int *num_procs);
+    static void *    MatrixFreeMatvecCreate(void *A, void *x);
+    static HYPRE_Int MatrixFreeMatvecCompute(void *matvec_data, HYPRE_Complex alpha, void *A, 
+                                             void *x, HYPRE_Complex beta, void *y);
+    static HYPRE_Int MatrixFreeMatvecDestroy(void *matvec_data);
+    
+    // Block forward-substitution preconditioner for GMRES
+    bool UseBlockForwardSubstitution();
+    void SetupBlockForwardSubstitution(HYPRE_ParCSRMatrix A);
+    void ApplyBlockForwardSubstitution(HYPRE_ParCSRMatrix A, 
+                                       HYPRE_ParVector    b, 
+                                       HYPRE_ParVector    x);
+    void ClearBlockForwardSubstitution();
+    static HYPRE_Int BlockForwardSubstitutionSetup(HYPRE_Solver solver, HYPRE_ParCSRMatrix A, 
+                                                   HYPRE_ParVector b, HYPRE_ParVector x);
+    static HYPRE_Int BlockForwardSubstitutionSolve(HYPRE_Solver solver, HYPRE_ParCSRMatrix A, 
+                                                   HYPRE_ParVector b, HYPRE_ParVector x);
+
 
     // Not using spatial parallelism
     void RKSpaceTimeBlock(int    * &rowptr, 
@@ -165,14 +574,18 @@ private:
                           double * &data, 
                           double * &B, 
                           double * &V, 
-                          int      &onProcSize);
+                          int      &onProcSize,
+                          bool      assembleMatrix,
+                          bool      storeKronecker);
               
     void BDFSpaceTimeBlock(int    * &rowptr, 
                            int    * &colinds, 
                            double * &data, 
                            double * &B, 
                            double * &V, 
-                           int      &onProcSize);
+                           int      &onProcSize,
+                           bool      assembleMatrix,
+                           bool      storeKronecker);
 
     // Using spatial parallelism
     void RKSpaceTimeBlock(int    * &rowptr, 
@@ -182,7 +595,8 @@ private:
                           double * &V, 
                           int      &localMinRow, 
                           int      &localMaxRow, 
-                          int      &spatialDOFs);
+                          int      &spatialDOFs,
+                          bool      assembleMatrix);
               
     void BDFSpaceTimeBlock(int    * &rowptr, 
                            int    * &colinds, 
@@ -191,7 +605,8 @@ private:
                            double * &V, 
                            int      &localMinRow, 
                            int      &localMaxRow, 
-                           int      &spatialDOFs);
+                           int      &spatialDOFs,
+                           bool      assembleMatrix);
                            
     //  TODO : remove these functions...  
     // -----------------------------------------        
@@ -275,6 +690,10 @@ private:
     void AMTimeSteppingSolve();     /* General purpose Adams--Moulton solver */
     void BDFTimeSteppingSolve();    /* General purpose BDF solver */
     
+    bool   AdaptiveTimeStepping();
+    double EmbeddedErrorNorm(HYPRE_ParVector e, HYPRE_ParVector u);
+    double StepSizeFactor(double err, bool rejected);
+    
     void DestroyHypreMemberVariables();
     
     void GetHypreInitialCondition(HYPRE_ParVector &u0, 
@@ -284,6 +703,19 @@ private:
                                 HYPRE_IJVector               &u0ij, 
                                 std::vector<HYPRE_ParVector> &z, 
                                 std::vector<HYPRE_IJVector>  &zij); 
+    
+    void InitializeSolutionHistory(HYPRE_ParVector  &u0, 
+                                   HYPRE_IJVector   &u0ij, 
+                                   int               depth, 
+                                   Solution_history &history);
+    void PushSolutionHistory(HYPRE_ParVector x, Solution_history &history);
+    bool ExtrapolateSolutionHistory(const Solution_history &history, HYPRE_ParVector x);
+    void DestroySolutionHistory(Solution_history &history);
+    
+    void LinearCombination(double                              alpha0, 
+                           HYPRE_ParVector                     y, 
+                           const std::vector<double>          &alpha, 
+                           const std::vector<HYPRE_ParVector> &x);
                                     
     void GetHypreSpatialDiscretizationG(HYPRE_ParVector &g,
                                         HYPRE_IJVector  &gij,
@@ -302,6 +734,42 @@ private:
                                    double             * A_data, 
                                    int                  ilower, 
                                    int                  iupper);         
+    
+    void CreateHypreMatrix(HYPRE_ParCSRMatrix     &A,
+                           MPI_Comm                A_comm,
+                           int                     ilower, 
+                           int                     iupper, 
+                           int                     diag_nnz, 
+                           int                     offd_nnz, 
+                           const std::vector<int> &offd_cols);
+    
+    void FillHypreMatrixRows(HYPRE_ParCSRMatrix     &A,
+                             const std::vector<int> &offd_cols,
+                             int                   * A_rowptr, 
+                             int                   * A_colinds, 
+                             double                * A_data, 
+                             int                     ilower, 
+                             int                     iupper);
+    
+    void FinalizeHypreMatrix(HYPRE_ParCSRMatrix  &A,
+                             HYPRE_IJMatrix      &Aij,
+                             MPI_Comm             A_comm,
+                             int                  ilower, 
+                             int                  iupper);
+    
+    bool SetHypreMatrixValuesFromCRSData(HYPRE_ParCSRMatrix  &A,
+                                         int                * A_rowptr, 
+                                         int                * A_colinds, 
+                                         double             * A_data, 
+                                         int                  ilower, 
+                                         int                  iupper);
+    
+    void AddHypreMatrixValuesFromCRSData(HYPRE_ParCSRMatrix  &A,
+                                         int                * A_rowptr, 
+                                         int                * A_colinds, 
+                                         double             * A_data, 
+                                         int                  ilower, 
+                                         int                  iupper);
                     
     void GetHypreVectorFromData(HYPRE_ParVector  &x, 
                                 HYPRE_IJVector   &xij,
@@ -309,6 +777,10 @@ private:
                                 double          * x_data, 
                                 int               ilower, 
                                 int               iupper);                                      
+    
+    void SetHypreVectorValuesFromData(HYPRE_ParVector &x, 
+                                      double        * x_data, 
+                                      int             onProcSize);
                     
                                             
     void SetHypreMassMatrix(int  ilower, 
@@ -318,8 +790,20 @@ private:
                                int  iupper);                                             
     
     void SolveAMG();
+    void UpdateAdaptiveRebuild();
     void SolveGMRES();
     void SolveMassSystem();
+    void SetupMassPreconditioner(HYPRE_ParCSRMatrix M);
+    void ApplyMassPreconditioner(HYPRE_ParVector r, HYPRE_ParVector z);
+    void SetupMassChebyshev();
+    void SolveMassChebyshev();
+    void ClearMassSolver();
+    static HYPRE_Int MassPreconditionerSetup(HYPRE_Solver solver, HYPRE_ParCSRMatrix A, HYPRE_ParVector b, HYPRE_ParVector x);
+    static HYPRE_Int MassPreconditionerSolve(HYPRE_Solver solver, HYPRE_ParCSRMatrix A, HYPRE_ParVector b, HYPRE_ParVector x);
+    void AccumulateSolveStats();
+    void GetBinvScaledSystem(HYPRE_ParVector &b_s);
+    void ClearBinvScaling();
+    void ReduceTimers();
     
     void BuildSpaceTimeMatrix();
     
@@ -343,6 +827,40 @@ protected:
     
     double   m_hmin;
     double   m_hmax;
+    
+    // Spatial discretization handing over or lending its storage; see CSR_buffer. 
+    // Default implementations call the raw-pointer versions and hand over their arrays.
+    virtual void getSpatialDiscretizationG(const MPI_Comm &spatialComm, 
+                                           Vector_buffer &G, 
+                                           int           &localMinRow, 
+                                           int           &localMaxRow,
+                                           int           &spatialDOFs, 
+                                           double         t);                                   
+    virtual void getSpatialDiscretizationL(const MPI_Comm &spatialComm, 
+                                           CSR_buffer    &L, 
+                                           Vector_buffer &U0, 
+                                           bool           getU0, 
+                                           int           &localMinRow, 
+                                           int           &localMaxRow, 
+                                           int           &spatialDOFs,
+                                           double         t, 
+                                           int           &bsize);                                            
+    virtual void getSpatialDiscretizationG(Vector_buffer &G, 
+                                           int           &spatialDOFs, 
+                                           double         t);
+    virtual void getSpatialDiscretizationL(CSR_buffer    &L, 
+                                           Vector_buffer &U0, 
+                                           bool           getU0, 
+                                           int           &spatialDOFs,
+                                           double         t, 
+                                           int           &bsize);                                            
+    
+    // Transient buffers allocated with new[]. While time-stepping, they come from a pool 
+    // and are recycled by ReleaseBuffer; otherwise ReleaseBuffer just deletes them.
+    void AllocBuffer(int    * &x, int size);
+    void AllocBuffer(double * &x, int size);
+    void ReleaseBuffer(int    * &x);
+    void ReleaseBuffer(double * &x);
 
 public:
     SpaceTimeMatrix(MPI_Comm globComm, bool pit, bool M_exists, int timeDisc, int numTimeSteps, double dt);
@@ -350,6 +868,10 @@ public:
 
 
     void Solve(); /* General solver! */
+    
+    void RefreshSpaceTimeMatrix();  /* Rewrite values of existing space-time system, keeping its structure */
+    void RefreshSpaceTimeRHS();     /* Rewrite values of RHS (and initial guess) only */
+    void SetTimeStep(double dt) { m_dt = dt; }
 
     void SetAMG();
     void SetAIR();
@@ -358,6 +880,14 @@ public:
     
     void SetSolverParametersDefaults();
     void SetSolverParameters(Solver_parameters &solver_params); 
+    
+    void SetSpatialDiscretizationCacheSize(double megabytes);
+    void SetDIRKCacheSize(double megabytes);
+    void SetCheckpointing(std::string prefix, int rate, bool restart);
+    void SetSnapshotOutput(std::string prefix, int rate);
+    void SetTimeWindows(int numWindows);
+    void SetBatchInitialConditions(const std::vector<double *> &u0, int onProcSize);
+    void GetInitialConditionRows(double * &u0, int &onProcSize);
         
     
     bool GetDiscretizationError(double &e2norm);
@@ -368,5 +898,7 @@ public:
     void SaveMatrix(const char* filename) { if (m_Aij) HYPRE_IJMatrixPrint(m_Aij, filename); else std::cout << "WARNING: m_Aij == NULL, cannot be printed!\n"; }
     void SaveRHS(std::string filename)    { if (m_bij) HYPRE_IJVectorPrint(m_bij, filename.c_str()); else std::cout << "WARNING: m_bij == NULL, cannot be printed!\n";  }
     void SaveX(std::string filename)      { if (m_xij) HYPRE_IJVectorPrint(m_xij, filename.c_str()); else std::cout << "WARNING: m_xij == NULL, cannot be printed!\n";  }
+    void SaveBatchX(std::string filename);
     void SaveSolInfo(std::string filename, std::map<std::string, std::string> additionalInfo);
+    void SavePerformanceRecord(std::string filename, std::map<std::string, std::string> additionalInfo);
 };
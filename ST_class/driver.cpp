@@ -38,6 +38,10 @@ mpirun -np 4 ./driver -pit 1 -s 3 -d 2 -nt 60 -t 122 -o 2 -l 6 -p 2 -gmres 1 -pp
     mpirun -np 4 ./driver -pit 1 -s 3 -d 1 -t 32 -nt 61 -o 2 -l 6 -p 2 -gmres 0 -tol 1e-5 -FD 101 -save 2 
     mpirun -np 4 ./driver -pit 1 -s 3 -d 1 -t 32 -nt 121 -o 2 -l 7 -p 2 -gmres 0 -tol 1e-5 -FD 101 -save 2 
     mpirun -np 4 ./driver -pit 1 -s 3 -d 1 -t 32 -nt 241 -o 2 -l 8 -p 2 -gmres 0 -tol 1e-5 -FD 101 -save 2 
+
+#---Since the space-time matrix is lower triangular in time, GMRES preconditioned by block forward
+    substitution (AMG on each time step's block) is an alternative, e.g.,
+    mpirun -np 4 ./driver -pit 1 -s 3 -d 1 -t 32 -nt 61 -o 2 -l 6 -p 2 -gmres 1 -pre 3 -tol 1e-5 -FD 101 -save 2 
 */
 
 
@@ -81,11 +85,32 @@ int main(int argc, char *argv[])
     int precon_printLevel = 1;
     
     int rebuildRate  = 0; 
+    double rebuildTol = 0.0;
+    int initial_guess = 0;
+    double dt_rtol   = 0.0;
+    double dt_atol   = 0.0;
     
     int binv_scale   = 0;
     int lump_mass    = 1;
     
     int multi_init   = 0; 
+    
+    int matrix_free  = 0;
+    int kron_storage = 0;
+    
+    int mass_solver  = 0;
+    int mass_cheby_iters = 0;
+    
+    double cacheSize = 256; // Memory budget (MB) for cache of spatial discretizations
+    double DIRKcacheSize = 256; // Memory budget (MB) for cache of DIRK matrices and solvers
+    
+    int checkpointRate = 0;                      // Time steps between checkpoints (0 == never)
+    const char * checkpointFile = "checkpoint";  // Prefix of checkpoint files
+    int restart        = 0;                      // Resume from most recent checkpoint
+    int timeWindow     = 0;                      // Space-time: Time steps per window (0 == all nt at once)
+    int numRHS         = 1;                      // Space-time: Number of initial conditions solved for in a batch
+    int snapshotRate   = 0;                      // Time steps between solution snapshots (0 == never)
+    const char * snapshotFile = "data/snapshot"; // Prefix of snapshot files
 
     /* --- Spatial discretization parameters --- */
     int spatialDisc  = 3;
@@ -100,7 +125,8 @@ int main(int argc, char *argv[])
     // Initialize solver options struct with default parameters */
     Solver_parameters solver = {tol, maxiter, printLevel, bool(use_gmres), gmres_preconditioner, 
                                     AMGiters, precon_printLevel, rebuildRate, bool(binv_scale), bool(lump_mass), 
-                                    multi_init};
+                                    multi_init, bool(matrix_free), bool(kron_storage), rebuildTol, 
+                                    initial_guess, dt_rtol, dt_atol, mass_solver, mass_cheby_iters};
 
 
 
@@ -147,19 +173,53 @@ int main(int argc, char *argv[])
     args.AddOption(&use_gmres, "-gmres", "--use-gmres",
                   "Boolean to use GMRES as solver (default with AMG preconditioning).");
     args.AddOption(&(solver.gmres_preconditioner), "-pre", "gmres-preconditioner",
-                  "Type of preconditioning for GMRES.");                     
+                  "Type of preconditioning for GMRES: 1 == AMG, 2 == on-proc triangular solve, 3 == block forward substitution in time.");
     args.AddOption(&AMGiters, "-amgi", "--amg-iters",
                   "Number of BoomerAMG iterations to precondition one GMRES step.");       
     args.AddOption(&(solver.precon_printLevel), "-ppre", "--preconditioner-print-level",
                   "Print level of preconditioner when using one.");
     args.AddOption(&(solver.rebuildRate), "-rebuild", "--rebuild-rate",
                    "Frequency at which AMG solver is rebuilt during time stepping (-1=never rebuild, 0=rebuild every opportunity, x>0=after x time steps");              
+    args.AddOption(&(solver.rebuildTol), "-rebuildtol", "--rebuild-tolerance",
+                   "Time stepping: Rebuild AMG solver once iterations grow by this factor over those after the last rebuild (0=use rebuild rate instead).");              
+    args.AddOption(&(solver.initial_guess), "-guess", "--initial-guess",
+                   "Time stepping: Initial guess for linear solves (0=RHS, 1=previous stage/step, 2=linear extrapolation, 3=quadratic extrapolation from previous steps).");              
+    args.AddOption(&(solver.dt_rtol), "-dtrtol", "--dt-rel-tolerance",
+                   "RK time stepping: Relative local error tolerance for adaptive time steps (0 and dt absolute tolerance 0=constant time step dt).");              
+    args.AddOption(&(solver.dt_atol), "-dtatol", "--dt-abs-tolerance",
+                   "RK time stepping: Absolute local error tolerance for adaptive time steps.");              
     args.AddOption(&lump_mass, "-lump", "--lump-mass",
                   "Lump mass matrix to be diagonal.");  
     args.AddOption(&binv_scale, "-binv", "--scale-binv",
                   "Scale linear system by inverse of mass diagonal blocks."); 
+    args.AddOption(&(solver.mass_solver), "-msolve", "--mass-solver",
+                  "Solver for non-lumped mass matrix (0=CG, 1=Jacobi PCG, 2=block-Jacobi PCG, 3=Jacobi Chebyshev, 4=block-Jacobi Chebyshev).");
+    args.AddOption(&(solver.mass_cheby_iters), "-mcheby", "--mass-cheby-iters",
+                  "Chebyshev iterations per mass matrix solve (0=enough to reach solver tolerance in theory).");
     args.AddOption(&(solver.multi_init), "-minit", "--multi-init",
                   "Technique for initializing multistep starting values.");                
+    args.AddOption(&matrix_free, "-mf", "--matrix-free",
+                  "Apply space-time matrix in GMRES without assembling it (if no preconditioner needs it).");
+    args.AddOption(&kron_storage, "-kron", "--kronecker-storage",
+                  "Store time-invariant space-time matrix in Kronecker form, expanding it into hypre matrix one block row at a time.");
+    args.AddOption(&cacheSize, "-cache", "--disc-cache-size",
+                  "Memory budget (MB) for caching spatial discretizations during space-time assembly.");
+    args.AddOption(&DIRKcacheSize, "-dirkcache", "--dirk-cache-size",
+                  "Sequential DIRK time-stepping: Memory budget (MB) per process for caching DIRK matrices and AMG solvers for each dt*a_ii.");
+    args.AddOption(&checkpointRate, "-ckpt", "--checkpoint-rate",
+                  "Sequential time-stepping: Write checkpoint every this many time steps (0 == never).");
+    args.AddOption(&checkpointFile, "-ckptfile", "--checkpoint-file",
+                  "Sequential time-stepping: Prefix of checkpoint files.");
+    args.AddOption(&restart, "-restart", "--restart",
+                  "Sequential time-stepping: Resume from most recent checkpoint (if any).");
+    args.AddOption(&timeWindow, "-window", "--time-window",
+                  "Space-time: Solve in consecutive windows of this many time steps (0 == all nt at once).");
+    args.AddOption(&numRHS, "-nrhs", "--num-rhs",
+                  "Space-time (FD): Solve for an ensemble of this many initial conditions, u0 scaled by 1, 1.1, ..., sharing one matrix and solver setup.");
+    args.AddOption(&snapshotRate, "-snap", "--snapshot-rate",
+                  "Sequential time-stepping: Write solution every this many time steps (0 == never).");
+    args.AddOption(&snapshotFile, "-snapfile", "--snapshot-file",
+                  "Sequential time-stepping: Prefix of solution snapshot files.");
                   
     /* Spatial discretization */
     args.AddOption(&spatialDisc, "-s", "--spatial-disc",
@@ -213,6 +273,8 @@ int main(int argc, char *argv[])
     solver.use_gmres  = bool(use_gmres);
     solver.binv_scale = bool(binv_scale);
     solver.lump_mass  = bool(lump_mass);
+    solver.matrix_free = bool(matrix_free);
+    solver.kron_storage = bool(kron_storage);
     
     AMG.prerelax = std::string(temp_prerelax);
     AMG.postrelax = std::string(temp_postrelax);
@@ -230,6 +292,18 @@ int main(int argc, char *argv[])
     }
 
     pit = bool(pit); // Cast to boolean
+    
+    // Space-time system is built for one window of nt/numWindows time steps at a time
+    int numWindows = 1;
+    if (pit && timeWindow > 0) {
+        if (nt % timeWindow != 0) {
+            if (rank == 0) std::cout << "Error: time window (" << timeWindow << ") does not divide number of time steps (" << nt << ")\n";
+            MPI_Finalize();
+            return 1;
+        }
+        numWindows = nt / timeWindow;
+        nt         = timeWindow;
+    }
 
     if (dt < 0) dt = 1.0/numTimeSteps;
 
@@ -245,6 +319,7 @@ int main(int argc, char *argv[])
             
         STmatrix.SetAMGParameters(AMG);
         STmatrix.SetSolverParameters(solver);                 
+        STmatrix.SetTimeWindows(numWindows);
         STmatrix.Solve();                            
         
         STmatrix.PrintMeshData();
@@ -260,6 +335,7 @@ int main(int argc, char *argv[])
         
         STmatrix.SetAMGParameters(AMG);
         STmatrix.SetSolverParameters(solver);
+        STmatrix.SetTimeWindows(numWindows);
         STmatrix.Solve();
 
         STmatrix.PrintMeshData();
@@ -306,6 +382,16 @@ int main(int argc, char *argv[])
         // TODO: 
         //--- Work out what sensible CFLs look like for multistep schemes!  ------
         
+        // Adams--Bashforth (explicit): Shrink forward Euler's limit by the length of the
+        // scheme's real stability interval relative to forward Euler's (2, 1, 6/11, 3/10)
+        } else if (timeDisc >= 10 && timeDisc < 20) {
+            double ABinterval[4] = {1.0, 1.0/2.0, 3.0/11.0, 3.0/20.0};
+            CFLlim = ABinterval[timeDisc % 10 - 1];
+            CFL_fraction = 0.85;
+            
+            usingMultistep = true;
+            smulti = timeDisc % 10;
+        
         // BDF (implicit)
         } else if  (timeDisc >= 30 && timeDisc < 40) {
             CFLlim = 0.8;
@@ -374,6 +460,26 @@ int main(int argc, char *argv[])
         // Set parameters
         STmatrix.SetAMGParameters(AMG);
         STmatrix.SetSolverParameters(solver);
+        STmatrix.SetSpatialDiscretizationCacheSize(cacheSize);
+        STmatrix.SetDIRKCacheSize(DIRKcacheSize);
+        STmatrix.SetCheckpointing(checkpointFile, checkpointRate, restart);
+        STmatrix.SetSnapshotOutput(snapshotFile, snapshotRate);
+        STmatrix.SetTimeWindows(numWindows);
+        
+        // Batch of initial conditions: The PDE's, scaled by 1, 1.1, 1.2, ...
+        if (pit && numRHS > 1) {
+            double * u0;
+            int      onProcSize;
+            STmatrix.GetInitialConditionRows(u0, onProcSize);
+            std::vector<double *> u0_batch(numRHS);
+            for (int j = 0; j < numRHS; j++) {
+                u0_batch[j] = new double[onProcSize];
+                for (int i = 0; i < onProcSize; i++) u0_batch[j][i] = (1.0 + 0.1*j) * u0[i];
+            }
+            STmatrix.SetBatchInitialConditions(u0_batch, onProcSize);
+            for (int j = 0; j < numRHS; j++) delete[] u0_batch[j];
+            delete[] u0;
+        }
         
         //STmatrix.SetAIRHyperbolic();
         //STmatrix.SetAIR();
@@ -392,6 +498,7 @@ int main(int argc, char *argv[])
             }
             
             if (saveLevel >= 2) STmatrix.SaveX(filename);
+            if (saveLevel >= 2 && pit && numRHS > 1) STmatrix.SaveBatchX(filename);
             if (saveLevel >= 3) STmatrix.SaveMatrix("A");
             if (saveLevel >= 3) STmatrix.SaveRHS("b");
             